@@ -0,0 +1,179 @@
+#ifndef HECTOR_TIMEIT_ACCUMULATOR_H
+#define HECTOR_TIMEIT_ACCUMULATOR_H
+
+#include "hector_timeit/timer.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * Lightweight alternative to a Timer that only accumulates the count, sum, minimum, maximum and sum of squares of the
+ *  runs in 32 bytes without any heap allocations. Hence, two accumulators fit into a cache line and they can be
+ *  embedded in hot data structures, e.g., one per joint or map tile. See AccumulatorBlock for timing code and
+ *  ShardedAccumulatorArray for accumulators that are used by multiple threads.
+ *
+ * The minimum and maximum are limited to 2^48 - 1 nanoseconds (about 78 hours) and an accumulator counts up to
+ *  2^32 - 1 runs, further runs are ignored. Percentiles can not be computed from these statistics.
+ */
+class RunAccumulator
+{
+public:
+  static constexpr uint64_t MaxTime = (uint64_t( 1 ) << 48) - 1;
+  static constexpr uint32_t MaxCount = 0xFFFFFFFF;
+
+  RunAccumulator() : min_( 0 ), count_low_( 0 ), max_( 0 ), count_high_( 0 ) { }
+
+  /*!
+   * Adds a run.
+   * @param time The time of the run in nanoseconds. Runs with a negative time are invalid and ignored.
+   */
+  inline void add( long time )
+  {
+    uint32_t count = this->count();
+    if ( time < 0 || count == MaxCount ) return;
+    uint64_t clamped = static_cast<uint64_t>(time) < MaxTime ? static_cast<uint64_t>(time) : MaxTime;
+    if ( count == 0 || clamped < min_ ) min_ = clamped;
+    if ( clamped > max_ ) max_ = clamped;
+    setCount( count + 1 );
+    sum_ += time;
+    sum_squares_ += static_cast<double>(time) * time;
+  }
+
+  //! Adds the runs of other, e.g., to combine the accumulators of multiple threads.
+  void merge( const RunAccumulator &other );
+
+  void clear() { *this = RunAccumulator(); }
+
+  uint32_t count() const { return (static_cast<uint32_t>(count_high_) << 16) | count_low_; }
+
+  //! @return The sum of the runs in nanoseconds.
+  long long sum() const { return sum_; }
+
+  long min() const { return static_cast<long>(min_); }
+
+  long max() const { return static_cast<long>(max_); }
+
+  double mean() const;
+
+  //! @return The sample variance of the runs.
+  double variance() const;
+
+  //! @return The statistics in the format used by the Timer.
+  RunStatistics statistics() const;
+
+  /*!
+   * Formats the runs as the table printed by Timer::toString(). The percentile columns are printed as "-".
+   * @param name The name printed in the header of the table.
+   * @param print_time_unit The unit. If Default, the unit is chosen depending on the magnitude of the times.
+   */
+  std::string toString( const std::string &name, TimerBase::TimeUnit print_time_unit = TimerBase::Default ) const;
+
+private:
+  inline void setCount( uint32_t count )
+  {
+    count_low_ = count & 0xFFFF;
+    count_high_ = count >> 16;
+  }
+
+  int64_t sum_ = 0;
+  double sum_squares_ = 0;
+  // The count is split into the upper bits of the minimum and maximum to fit into 32 bytes
+  uint64_t min_ : 48;
+  uint64_t count_low_ : 16;
+  uint64_t max_ : 48;
+  uint64_t count_high_ : 16;
+};
+
+static_assert( sizeof( RunAccumulator ) <= 32, "A RunAccumulator should fit into 32 bytes." );
+
+/*!
+ * Reads the clock on construction and adds the elapsed time to the given accumulator on destruction.
+ * Only reads the clock twice, i.e., does not compensate the clock overhead or measure the cpu time like a Timer.
+ */
+template<typename ClockT>
+struct BasicAccumulatorBlock
+{
+  explicit BasicAccumulatorBlock( RunAccumulator &accumulator ) : accumulator_( accumulator ), start_( ClockT::now()) { }
+
+  ~BasicAccumulatorBlock()
+  {
+    accumulator_.add( std::chrono::duration_cast<std::chrono::nanoseconds>( ClockT::now() - start_ ).count());
+  }
+
+  RunAccumulator &accumulator_;
+  typename ClockT::time_point start_;
+};
+
+typedef BasicAccumulatorBlock<WallClock> AccumulatorBlock;
+
+/*!
+ * A fixed number of accumulators, e.g., one per joint, that is shared between multiple threads.
+ * Like the ShardedTimer, every thread records into its own array of accumulators (shard). Each shard starts at a cache
+ *  line and is padded to a multiple of the cache line size, so threads never write to the same cache line. Reading the
+ *  results merges the shards and should only be done when the recording threads are not recording at the same time.
+ */
+class ShardedAccumulatorArray
+{
+public:
+  static constexpr size_t CacheLineSize = 64;
+
+  /*!
+   * @param name The name of the array. The accumulator at index i is printed as "name[i]".
+   * @param size The number of accumulators in each shard.
+   * @param print_time_unit The time unit used for printing. If Default the time unit is automatically chosen.
+   */
+  ShardedAccumulatorArray( std::string name, size_t size, TimerBase::TimeUnit print_time_unit = TimerBase::Default );
+
+  const std::string &name() const { return name_; }
+
+  size_t size() const { return size_; }
+
+  /*!
+   * Returns the accumulators of the calling thread. The shard is created and registered on the first call from a
+   *  thread. Since this requires a lock, the returned pointer should be cached by the caller, e.g., in a thread_local
+   *  variable.
+   * @return The first of size() accumulators that should only be used by the calling thread.
+   */
+  RunAccumulator *localShard();
+
+  //! @return The number of threads that recorded into this array.
+  size_t shardCount() const;
+
+  //! @return The accumulator at the given index merged over all shards.
+  RunAccumulator merged( size_t index ) const;
+
+  //! Clears the accumulators of all shards.
+  void clear();
+
+  //! @return The table of the accumulator at the given index merged over all shards. See RunAccumulator::toString.
+  std::string toString( size_t index ) const;
+
+  //! @return The tables of all accumulators with at least one run separated by new lines.
+  std::string toString() const;
+
+private:
+  struct Shard
+  {
+    std::thread::id thread_id;
+    std::unique_ptr<char[]> memory;
+    RunAccumulator *accumulators;
+  };
+
+  mutable std::mutex shards_mutex_;
+  std::vector<Shard> shards_;
+  std::string name_;
+  size_t size_;
+  TimerBase::TimeUnit print_time_unit_;
+};
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ShardedAccumulatorArray &array );
+
+#endif //HECTOR_TIMEIT_ACCUMULATOR_H
@@ -0,0 +1,79 @@
+#ifndef HECTOR_TIMEIT_ALLOCATION_TRACKER_H
+#define HECTOR_TIMEIT_ALLOCATION_TRACKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace hector_timeit
+{
+
+/*!
+ * The number of heap allocations and the requested bytes.
+ */
+struct AllocationCounts
+{
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+
+  AllocationCounts &operator+=( const AllocationCounts &other )
+  {
+    count += other.count;
+    bytes += other.bytes;
+    return *this;
+  }
+};
+
+/*!
+ * Attributes heap allocations to the innermost running timer of the calling thread.
+ * Every running timer installs its counts as the current counts of its thread on start and restores the previous counts
+ *  on stop, so allocations are only counted for the innermost timer. The allocations are recorded by the
+ *  hector_timeit_alloc_hooks library, which interposes malloc, calloc, realloc and the aligned allocation functions
+ *  (operator new uses malloc) and enables the tracker when it is loaded. Link it or load it using LD_PRELOAD.
+ * While the tracker is disabled, timers only check an atomic flag.
+ */
+class AllocationTracker
+{
+public:
+  static inline bool enabled() { return enabled_.load( std::memory_order_relaxed ); }
+
+  /*!
+   * Enables the tracker. Called by the hooks library when it is loaded. Only timers started afterwards count
+   *  allocations.
+   */
+  static void setEnabled( bool value ) { enabled_.store( value, std::memory_order_relaxed ); }
+
+  /*!
+   * Adds an allocation to the current counts of the calling thread, if any. Must not allocate.
+   */
+  static inline void record( size_t bytes )
+  {
+    AllocationCounts *counts = current_;
+    if ( counts == nullptr ) return;
+    ++counts->count;
+    counts->bytes += bytes;
+  }
+
+  /*!
+   * @return The counts that allocations of the calling thread are currently attributed to or nullptr.
+   */
+  static inline AllocationCounts *current() { return current_; }
+
+  /*!
+   * Sets the counts that allocations of the calling thread are attributed to.
+   * @return The previous counts.
+   */
+  static inline AllocationCounts *exchangeCurrent( AllocationCounts *counts )
+  {
+    AllocationCounts *previous = current_;
+    current_ = counts;
+    return previous;
+  }
+
+private:
+  static std::atomic<bool> enabled_;
+  static thread_local AllocationCounts *current_;
+};
+}
+
+#endif //HECTOR_TIMEIT_ALLOCATION_TRACKER_H
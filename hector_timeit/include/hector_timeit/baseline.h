@@ -0,0 +1,138 @@
+#ifndef HECTOR_TIMEIT_BASELINE_H
+#define HECTOR_TIMEIT_BASELINE_H
+
+#include "hector_timeit/timer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * The run time distribution of a timer that can be saved to a file and compared against later runs to detect
+ *  performance regressions.
+ *
+ * File format (all fixed size integers are little endian):
+ *  Header: magic "HTBASE\0\0", uint32 version, varint name length, name bytes, varint number of distinct run times.
+ *  Per distinct run time in ascending order: varint difference to the previous run time, varint number of runs.
+ *  Varints are unsigned LEB128 as in the trace file. Since the differences are small, a run takes about 2 bytes or less.
+ */
+class Baseline
+{
+public:
+  static constexpr uint32_t Version = 1;
+
+  Baseline() = default;
+
+  /*!
+   * @param name The name of the baseline, e.g., the timer name.
+   * @param run_times The run times in nanoseconds. Invalid runs (-1) are ignored.
+   */
+  Baseline( std::string name, const std::vector<long> &run_times );
+
+  /*!
+   * Creates a baseline from the finished runs of the given timer.
+   * If the timer stores its runs in a histogram, every run is represented by the center of its bucket, hence, the
+   *  distribution is only as precise as the histogram.
+   */
+  static Baseline fromTimer( const TimerBase &timer );
+
+  const std::string &name() const { return name_; }
+
+  /*!
+   * @return The valid run times in ascending order.
+   */
+  const std::vector<long> &runTimes() const { return run_times_; }
+
+  size_t size() const { return run_times_.size(); }
+
+  bool empty() const { return run_times_.empty(); }
+
+  /*!
+   * Creates or truncates the file and writes the baseline.
+   * @return True if successful, false otherwise.
+   */
+  bool save( const std::string &path ) const;
+
+  /*!
+   * Reads a baseline written by save.
+   * @param error Set to a description of the problem if reading fails.
+   * @return True if the file was read successfully, false otherwise.
+   */
+  static bool load( const std::string &path, Baseline &baseline, std::string &error );
+
+private:
+  std::string name_;
+  std::vector<long> run_times_;
+};
+
+struct ComparisonOptions
+{
+  //! The significance level of the Mann-Whitney U test.
+  double alpha = 0.05;
+  //! A slowdown of the median by more than this fraction is a regression if it is significant, e.g., 0.05 for 5%.
+  double threshold = 0.05;
+  //! The level of the bootstrap confidence interval of the relative change.
+  double confidence = 0.95;
+  size_t bootstrap_resamples = 1000;
+  //! The bootstrap resamples at most this many runs of each distribution to bound the time of the comparison.
+  size_t max_bootstrap_runs = 10000;
+};
+
+/*!
+ * The result of comparing runs against a baseline.
+ */
+struct Comparison
+{
+  std::string name;
+  size_t baseline_count = 0;
+  size_t current_count = 0;
+  long baseline_median = 0;
+  long current_median = 0;
+  //! The Mann-Whitney U statistic of the current runs.
+  double u = 0;
+  //! The standardized U statistic including the tie correction. Positive if the current runs tend to be slower.
+  double z = 0;
+  //! The two-sided p-value using the normal approximation of U.
+  double p_value = 1;
+  //! The relative change of the median, e.g., 0.1 if the current runs are 10% slower.
+  double relative_change = 0;
+  //! The bootstrap confidence interval of the relative change of the median.
+  double ci_lower = 0;
+  double ci_upper = 0;
+  double confidence = 0;
+  double alpha = 0;
+  double threshold = 0;
+
+  //! @return Whether the distributions differ significantly.
+  bool significant() const { return p_value < alpha; }
+
+  //! @return Whether the current runs are significantly slower by more than the threshold.
+  bool regression() const { return significant() && relative_change > threshold; }
+
+  //! @return True unless the comparison detected a regression.
+  bool passed() const { return !regression(); }
+
+  std::string toString() const;
+};
+
+/*!
+ * Compares the run times against the baseline using the Mann-Whitney U test which, unlike a t-test, makes no
+ *  assumption on the distribution of the run times and is robust against outliers.
+ * @param run_times The current run times in nanoseconds. Invalid runs (-1) are ignored.
+ */
+Comparison compare( const Baseline &baseline, const std::vector<long> &run_times,
+                    const ComparisonOptions &options = ComparisonOptions());
+
+/*!
+ * Compares the finished runs of the timer against the baseline. See Baseline::fromTimer.
+ */
+Comparison compare( const Baseline &baseline, const TimerBase &timer,
+                    const ComparisonOptions &options = ComparisonOptions());
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::Comparison &comparison );
+
+#endif //HECTOR_TIMEIT_BASELINE_H
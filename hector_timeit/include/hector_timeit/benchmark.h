@@ -0,0 +1,222 @@
+#ifndef HECTOR_TIMEIT_BENCHMARK_H
+#define HECTOR_TIMEIT_BENCHMARK_H
+
+#include "hector_timeit/run_statistics.h"
+#include "hector_timeit/timer.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * Prevents the compiler from optimizing away the computation of the given value, e.g., the result of benchmarked code.
+ */
+template<typename T>
+inline void doNotOptimize( const T &value )
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __asm__ __volatile__( "" : : "r,m"( value ) : "memory" );
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+struct BenchmarkOptions
+{
+  //! The time in nanoseconds the code is executed before sampling starts.
+  long warmup_time = 100000000;
+  /*!
+   * The minimum time of a sample in nanoseconds. The number of iterations per sample (batch size) is chosen such that
+   *  each sample takes at least this long. If 0, 1000 times the resolution or read overhead of the clock is used,
+   *  whichever is larger.
+   */
+  long min_sample_time = 0;
+  size_t min_samples = 10;
+  size_t max_samples = 100000;
+  /*!
+   * Sampling stops once the half width of the confidence interval of the mean relative to the mean is below this
+   *  target.
+   */
+  double target_relative_error = 0.01;
+  //! Sampling stops once the total time including the warmup exceeds this budget in nanoseconds.
+  long time_budget = 5000000000;
+  //! The level of the bootstrap confidence interval.
+  double confidence = 0.95;
+  size_t bootstrap_resamples = 1000;
+};
+
+struct BenchmarkResult
+{
+  enum StopReason
+  {
+    TargetErrorReached,
+    TimeBudgetExhausted,
+    MaxSamplesReached
+  };
+
+  /*!
+   * Outliers are classified using Tukey's fences, i.e., samples outside of [Q1 - 1.5 IQR, Q3 + 1.5 IQR] are mild and
+   *  outside of [Q1 - 3 IQR, Q3 + 3 IQR] are severe outliers.
+   */
+  enum Outlier
+  {
+    NoOutlier,
+    LowMild,
+    LowSevere,
+    HighMild,
+    HighSevere
+  };
+
+  std::string name;
+  //! The time per iteration of each sample in nanoseconds.
+  std::vector<double> samples;
+  //! The outlier classification of each sample.
+  std::vector<Outlier> outliers;
+  //! The number of iterations per sample.
+  size_t batch_size = 0;
+  //! The statistics of the time per iteration in nanoseconds.
+  double mean = 0;
+  double median = 0;
+  double stddev = 0;
+  //! The bootstrap confidence interval of the mean.
+  double ci_lower = 0;
+  double ci_upper = 0;
+  double confidence = 0;
+  StopReason stop_reason = TargetErrorReached;
+
+  /*!
+   * @return The half width of the confidence interval relative to the mean.
+   */
+  double relativeError() const;
+
+  /*!
+   * @return The number of samples with the given classification.
+   */
+  size_t outlierCount( Outlier type ) const;
+
+  std::string toString( TimerBase::TimeUnit print_time_unit = TimerBase::Default ) const;
+};
+
+struct ScalingOptions
+{
+  //! The maximum number of threads. If 0, the hardware concurrency is used.
+  unsigned max_threads = 0;
+  //! If true, thread i is pinned to core i modulo the number of cores. Only supported on Linux.
+  bool pin_threads = false;
+};
+
+struct ScalingStep
+{
+  unsigned threads = 0;
+  //! The time from releasing the threads until the last thread finished in nanoseconds.
+  long wall_time = 0;
+  //! The merged statistics of the runs of all threads.
+  RunStatistics run_stats;
+  RunPercentiles run_percentiles;
+  //! The statistics of the runs of each thread.
+  std::vector<RunStatistics> thread_stats;
+  //! Whether all threads were pinned successfully.
+  bool pinned = false;
+
+  //! @return The runs per second of all threads combined.
+  double throughput() const;
+};
+
+struct ScalingResult
+{
+  std::string name;
+  //! The number of runs per thread.
+  long count = 0;
+  std::vector<ScalingStep> steps;
+
+  /*!
+   * @return The throughput of the given step relative to the throughput of the single threaded step.
+   */
+  double speedup( const ScalingStep &step ) const;
+
+  /*!
+   * @return The speedup of the given step divided by its number of threads. 1 means perfect scaling.
+   */
+  double efficiency( const ScalingStep &step ) const;
+
+  std::string toString( TimerBase::TimeUnit print_time_unit = TimerBase::Default ) const;
+};
+
+/*!
+ * Runs code repeatedly to measure the time of a single iteration.
+ * After a warmup, the code is run in batches of iterations that take long enough for the resolution and overhead of the
+ *  clock to be negligible. Each batch is a sample of the time per iteration. Sampling continues until the bootstrap
+ *  confidence interval of the mean is narrow enough or the time budget or the maximum number of samples is reached.
+ */
+class Benchmark
+{
+public:
+  /*!
+   * @param name The name of the benchmark used for printing.
+   * @param function The benchmarked code. Use doNotOptimize on results that are otherwise unused.
+   * @param options The options, see BenchmarkOptions.
+   */
+  template<typename Function>
+  static BenchmarkResult run( const std::string &name, Function function,
+                              const BenchmarkOptions &options = BenchmarkOptions())
+  {
+    // The loop is compiled with the function inlined, so only one indirect call is made per batch
+    return runBatches( name, [ &function ]( size_t iterations )
+    {
+      for ( size_t i = 0; i < iterations; ++i ) function();
+    }, options );
+  }
+
+  /*!
+   * @param batch Runs the benchmarked code the given number of times.
+   */
+  static BenchmarkResult runBatches( const std::string &name, const std::function<void( size_t )> &batch,
+                                     const BenchmarkOptions &options = BenchmarkOptions());
+
+  /*!
+   * Runs the code count times on each of 1, 2, 4, ..., N threads to measure how it scales with the number of cores.
+   * The threads are started together from a barrier and each thread times its runs with its own Timer, hence, the
+   *  measurement does not add shared state between the threads.
+   * @param function The code of a run. Called concurrently by all threads, hence, it has to be thread-safe.
+   * @param count The number of runs per thread, i.e., every thread does the same work.
+   */
+  template<typename Function>
+  static ScalingResult runScaling( const std::string &name, Function function, long count,
+                                   const ScalingOptions &options = ScalingOptions())
+  {
+    return runScalingThreads( name, [ &function ]( Timer &timer, long count )
+    {
+      for ( long i = 0; i < count; ++i )
+      {
+        timer.start();
+        function();
+        timer.stop();
+        timer.reset( true );
+      }
+    }, count, options );
+  }
+
+  /*!
+   * @param thread_function Times count runs with the given timer. Called once by each thread.
+   */
+  static ScalingResult runScalingThreads( const std::string &name,
+                                          const std::function<void( Timer &, long )> &thread_function, long count,
+                                          const ScalingOptions &options = ScalingOptions());
+
+  /*!
+   * @return The resolution of the WallClock, i.e., the smallest non-zero difference between two reads, or the median
+   *  cost of a read measured over back-to-back reads in nanoseconds, whichever is larger.
+   */
+  static long clockGranularity();
+};
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::BenchmarkResult &result );
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ScalingResult &result );
+
+#endif //HECTOR_TIMEIT_BENCHMARK_H
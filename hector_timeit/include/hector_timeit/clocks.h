@@ -0,0 +1,201 @@
+#ifndef HECTOR_TIMEIT_CLOCKS_H
+#define HECTOR_TIMEIT_CLOCKS_H
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+
+#ifdef __unix__
+
+#include <unistd.h>
+#include <time.h>
+
+#endif
+
+#if defined(__x86_64__)
+#define HECTOR_TIMEIT_HAS_TSC 1
+#include <x86intrin.h>
+#endif
+
+namespace hector_timeit
+{
+namespace detail
+{
+struct TscCalibration
+{
+  //! Whether the CPU has an invariant (constant and nonstop) TSC that can be used for timing.
+  bool usable = false;
+  unsigned long long tsc_base = 0;
+  //! CLOCK_MONOTONIC time in nanoseconds at tsc_base.
+  long long nanoseconds_base = 0;
+  //! Nanoseconds per tick as fixed point number with 32 fractional bits.
+  unsigned long long multiplier = 0;
+  double ticks_per_nanosecond = 0;
+
+  /*!
+   * Checks whether the TSC is invariant and measures its frequency against CLOCK_MONOTONIC.
+   * Takes about 20ms.
+   */
+  static TscCalibration calibrate();
+};
+
+inline const TscCalibration &tscCalibration()
+{
+  static const TscCalibration calibration = TscCalibration::calibrate();
+  return calibration;
+}
+}
+
+/*!
+ * Clock that reads the time stamp counter (TSC) which is considerably cheaper than a clock_gettime call.
+ * The counter is read using rdtscp followed by an lfence to prevent the read from being reordered with the timed code.
+ * The TSC frequency is calibrated once against CLOCK_MONOTONIC and the ticks are converted to nanoseconds on the same
+ *  epoch. The calibration takes about 20ms and is done eagerly by WallClock::setSource, the Tracer and timers using the
+ *  TscClock, so it doesn't delay the first measurement. Other users should call calibrate() before the first reading.
+ * If the CPU does not have an invariant TSC or isn't x86_64, the clock falls back to std::chrono::steady_clock.
+ *
+ * Satisfies the requirements of a std::chrono clock.
+ */
+class TscClock
+{
+public:
+  typedef std::chrono::nanoseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<TscClock, duration> time_point;
+  static constexpr bool is_steady = true;
+
+  static inline time_point now() noexcept
+  {
+#ifdef HECTOR_TIMEIT_HAS_TSC
+    const detail::TscCalibration &calibration = detail::tscCalibration();
+    if ( calibration.usable )
+    {
+      unsigned int aux;
+      unsigned long long ticks = __rdtscp( &aux );
+      _mm_lfence();
+      __int128 delta = static_cast<long long>(ticks - calibration.tsc_base);
+      long long nanoseconds = static_cast<long long>((delta * calibration.multiplier) >> 32);
+      return time_point( duration( calibration.nanoseconds_base + nanoseconds ));
+    }
+#endif
+    return time_point( std::chrono::duration_cast<duration>(
+      std::chrono::steady_clock::now().time_since_epoch()));
+  }
+
+  /*!
+   * Calibrates the TSC frequency if it wasn't calibrated yet. Otherwise, the first call to now() calibrates.
+   */
+  static void calibrate() { detail::tscCalibration(); }
+
+  /*!
+   * @return True if the TSC is used, false if the clock falls back to std::chrono::steady_clock.
+   */
+  static bool usesTsc() { return detail::tscCalibration().usable; }
+
+  /*!
+   * @return The calibrated TSC frequency in Hz or 0 if the TSC is not used.
+   */
+  static double frequency() { return detail::tscCalibration().ticks_per_nanosecond * 1E9; }
+};
+
+/*!
+ * The wall clock used by the Timer.
+ * Uses std::chrono::high_resolution_clock by default but can be switched to the TscClock for the whole process.
+ * Since time points of the sources are not comparable, the source should be selected before any Timer is started,
+ *  e.g., at the beginning of main.
+ */
+class WallClock
+{
+public:
+  enum Source
+  {
+    HighResolutionClock = 0,
+    Tsc = 1
+  };
+
+  typedef std::chrono::nanoseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<WallClock, duration> time_point;
+  static constexpr bool is_steady = false;
+
+  static inline time_point now() noexcept
+  {
+    if ( source_.load( std::memory_order_relaxed ) == Tsc )
+      return time_point( TscClock::now().time_since_epoch());
+    return time_point( std::chrono::duration_cast<duration>(
+      std::chrono::high_resolution_clock::now().time_since_epoch()));
+  }
+
+  //! Selects the source. Calibrates the TscClock before it is used, see TscClock::calibrate.
+  static void setSource( Source source )
+  {
+    if ( source == Tsc ) TscClock::calibrate();
+    source_.store( source, std::memory_order_relaxed );
+  }
+
+  static Source source() { return static_cast<Source>(source_.load( std::memory_order_relaxed )); }
+
+private:
+  static std::atomic<int> source_;
+};
+
+namespace detail
+{
+//! Calibrates the given clock if it requires a calibration, so its first reading isn't delayed.
+template<typename ClockT>
+inline void calibrateClock() { }
+
+template<>
+inline void calibrateClock<TscClock>() { TscClock::calibrate(); }
+}
+
+/*!
+ * Cpu clock that measures the cpu time of the calling thread or, if not available, the process.
+ */
+struct ThreadCpuClock
+{
+  static constexpr bool enabled = true;
+
+  /*!
+   * Reads the cpu time.
+   * @param val Set to the cpu time in nanoseconds if successful.
+   * @return True if the cpu time could be obtained, false otherwise.
+   */
+  static inline bool now( long &val )
+  {
+    // This could also maybe made a parameter
+#ifdef _POSIX_THREAD_CPUTIME
+    struct timespec spec;
+    if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &spec ) == -1 )
+    {
+      return false;
+    }
+    val = spec.tv_sec * 1000L * 1000L * 1000L + spec.tv_nsec;
+#elif defined(_POSIX_CPUTIME)
+    struct timespec spec;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &spec) == -1)
+    {
+      return false;
+    }
+    val = spec.tv_sec * 1000L * 1000L * 1000L + spec.tv_nsec;
+#else
+    val = std::clock() * 1000L * 1000L * 1000L / CLOCKS_PER_SEC;
+#endif
+    return true;
+  }
+};
+
+/*!
+ * Cpu clock policy that disables the cpu time measurement.
+ */
+struct NoCpuClock
+{
+  static constexpr bool enabled = false;
+
+  static inline bool now( long & ) { return false; }
+};
+}
+
+#endif //HECTOR_TIMEIT_CLOCKS_H
@@ -0,0 +1,111 @@
+#ifndef HECTOR_TIMEIT_COMPENSATION_H
+#define HECTOR_TIMEIT_COMPENSATION_H
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * The time in nanoseconds that is subtracted from every run (pair of start and stop) to compensate the time it takes to
+ *  read the clocks.
+ */
+struct ClockOverhead
+{
+  //! Subtracted from the wall time.
+  long wall = 0;
+  //! Subtracted from the cpu time.
+  long cpu = 0;
+};
+
+namespace detail
+{
+/*!
+ * Measures the overhead by timing an empty section with the same sequence of clock reads as a BasicTimer without
+ *  double sampling, i.e., wall and cpu clock on start and cpu and wall clock on stop.
+ * The median over all samples is used which is robust against preemptions and cache misses.
+ */
+template<typename WallClockT, typename CpuClockT>
+ClockOverhead calibrateClockOverhead( int samples )
+{
+  std::vector<long> wall_samples;
+  std::vector<long> cpu_samples;
+  wall_samples.reserve( samples );
+  cpu_samples.reserve( samples );
+  // Warm up the clocks, e.g., a lazily calibrated TscClock or the vDSO page
+  WallClockT::now();
+  long cpu_start = 0;
+  CpuClockT::now( cpu_start );
+  for ( int i = 0; i < samples; ++i )
+  {
+    long cpu_end = 0;
+    typename WallClockT::time_point wall_start = WallClockT::now();
+    bool cpu_valid = CpuClockT::enabled && CpuClockT::now( cpu_start );
+    if ( cpu_valid ) cpu_valid = CpuClockT::now( cpu_end );
+    typename WallClockT::time_point wall_end = WallClockT::now();
+    wall_samples.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( wall_end - wall_start ).count());
+    if ( cpu_valid ) cpu_samples.push_back( cpu_end - cpu_start );
+  }
+  ClockOverhead result;
+  std::nth_element( wall_samples.begin(), wall_samples.begin() + wall_samples.size() / 2, wall_samples.end());
+  result.wall = wall_samples[wall_samples.size() / 2];
+  if ( !cpu_samples.empty())
+  {
+    std::nth_element( cpu_samples.begin(), cpu_samples.begin() + cpu_samples.size() / 2, cpu_samples.end());
+    result.cpu = cpu_samples[cpu_samples.size() / 2];
+  }
+  return result;
+}
+}
+
+/*!
+ * Compensates the time it takes to read the clocks by reading every clock twice on start and stop.
+ * See BasicTimer::start() for a documentation of the algorithm.
+ */
+struct DoubleSamplingCompensation
+{
+  static constexpr bool double_sampling = true;
+
+  template<typename WallClockT, typename CpuClockT>
+  static ClockOverhead overhead() { return ClockOverhead(); }
+};
+
+/*!
+ * Reads every clock only once on start and stop. This is the cheapest policy but the measured time includes the time
+ *  it takes to read the clocks.
+ */
+struct NoCompensation
+{
+  static constexpr bool double_sampling = false;
+
+  template<typename WallClockT, typename CpuClockT>
+  static ClockOverhead overhead() { return ClockOverhead(); }
+};
+
+/*!
+ * Reads every clock only once on start and stop and subtracts a constant overhead from every run.
+ * The overhead is calibrated once per process and combination of clocks on the first construction of a timer using
+ *  the median over Samples empty runs (takes well below a millisecond).
+ * Hence, it is as cheap as NoCompensation on start and stop but unlike the DoubleSamplingCompensation the compensation
+ *  is only correct on average.
+ *
+ * The WallClock source should be selected before the first timer is constructed since the overhead of the source at
+ *  the time of the calibration is used.
+ */
+struct CalibratedCompensation
+{
+  static constexpr bool double_sampling = false;
+  static constexpr int Samples = 1001;
+
+  template<typename WallClockT, typename CpuClockT>
+  static ClockOverhead overhead()
+  {
+    static const ClockOverhead overhead = detail::calibrateClockOverhead<WallClockT, CpuClockT>( Samples );
+    return overhead;
+  }
+};
+}
+
+#endif //HECTOR_TIMEIT_COMPENSATION_H
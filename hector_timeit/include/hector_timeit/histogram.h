@@ -0,0 +1,132 @@
+#ifndef HECTOR_TIMEIT_HISTOGRAM_H
+#define HECTOR_TIMEIT_HISTOGRAM_H
+
+#include "hector_timeit/run_statistics.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * Log-linear histogram (similar to HdrHistogram) for non-negative times in nanoseconds.
+ * Values below 2^significant_bits are stored exactly. Above, each power of two is split into
+ *  2^(significant_bits - 1) linear buckets which bounds the relative error of a bucket to 2^(1 - significant_bits).
+ * The buckets are allocated on construction, hence, recording a value is O(1) and never allocates.
+ * Count, sum, min and max are kept exactly.
+ *
+ * Negative values mark invalid runs (see RunStatistics) and are only counted.
+ */
+class Histogram
+{
+public:
+  static constexpr int DefaultSignificantBits = 7;
+
+  /*!
+   * Constructs an empty histogram without buckets. It can not record values and only serves as a placeholder.
+   */
+  Histogram() = default;
+
+  /*!
+   * @param significant_bits Controls the precision. Has to be in the range [2, 16]. The relative error of a recorded
+   *  value is at most 2^(1 - significant_bits), e.g., less than 1.6% for the default of 7 bits.
+   */
+  explicit Histogram( int significant_bits );
+
+  inline void record( long value )
+  {
+    if ( value < 0 )
+    {
+      ++invalid_count_;
+      return;
+    }
+    ++buckets_[bucketIndex( value )];
+    if ( count_ == 0 )
+    {
+      min_ = max_ = shift_ = value;
+    }
+    else if ( value < min_ ) min_ = value;
+    else if ( value > max_ ) max_ = value;
+    ++count_;
+    sum_ += value;
+    // Shifting by the first value avoids catastrophic cancellation when computing the variance
+    double shifted = value - shift_;
+    shifted_sum_ += shifted;
+    shifted_sum_squares_ += shifted * shifted;
+  }
+
+  /*!
+   * Merges the values recorded in other into this histogram. Both histograms need the same number of significant bits.
+   */
+  void merge( const Histogram &other );
+
+  /*!
+   * Removes all recorded values. Does not free the buckets.
+   */
+  void clear();
+
+  bool valid() const { return !buckets_.empty(); }
+
+  int significantBits() const { return significant_bits_; }
+
+  size_t count() const { return count_; }
+
+  size_t invalidCount() const { return invalid_count_; }
+
+  long long sum() const { return sum_; }
+
+  long min() const { return min_; }
+
+  long max() const { return max_; }
+
+  /*!
+   * @return The statistics of the recorded values. Mean and variance are computed from the exact values.
+   */
+  RunStatistics statistics() const;
+
+  /*!
+   * @param percentile The percentile in the range [0, 100].
+   * @return The value at the given percentile (see RunPercentiles) or -1 if no valid values were recorded.
+   *  Values in the linear range are exact, others are the center of their bucket clamped to the recorded min and max.
+   */
+  long valueAtPercentile( double percentile ) const;
+
+  size_t bucketCount() const { return buckets_.size(); }
+
+  size_t bucketValueCount( size_t index ) const { return buckets_[index]; }
+
+  inline size_t bucketIndex( long value ) const
+  {
+    unsigned long long v = value;
+    if ( v < linear_bucket_count_ ) return v;
+    int exponent = 64 - __builtin_clzll( v ) - significant_bits_;
+    return (static_cast<size_t>(exponent) << (significant_bits_ - 1)) + (v >> exponent);
+  }
+
+  /*!
+   * @return The smallest value that is recorded in the bucket with the given index.
+   */
+  long bucketLowerBound( size_t index ) const;
+
+  /*!
+   * @return The largest value that is recorded in the bucket with the given index.
+   */
+  long bucketUpperBound( size_t index ) const;
+
+private:
+  std::vector<size_t> buckets_;
+  unsigned long long linear_bucket_count_ = 0;
+  int significant_bits_ = 0;
+  size_t count_ = 0;
+  size_t invalid_count_ = 0;
+  long long sum_ = 0;
+  long min_ = 0;
+  long max_ = 0;
+  long shift_ = 0;
+  double shifted_sum_ = 0;
+  double shifted_sum_squares_ = 0;
+};
+}
+
+#endif //HECTOR_TIMEIT_HISTOGRAM_H
@@ -0,0 +1,97 @@
+#ifndef HECTOR_TIMEIT_LATENCY_BUDGET_H
+#define HECTOR_TIMEIT_LATENCY_BUDGET_H
+
+#include "hector_timeit/name_registry.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace hector_timeit
+{
+
+/*!
+ * A run of a timer that took longer than the latency budget of the timer. See TimerBase::setLatencyBudget.
+ */
+struct BudgetViolation
+{
+  //! The name of the timer, see NameRegistry.
+  NameId name;
+  //! The elapsed time of the run in nanoseconds when the budget was exceeded.
+  long duration;
+  //! The budget in nanoseconds.
+  long budget;
+  //! The id of the thread that timed the run.
+  long thread_id;
+  //! The time of the stop that exceeded the budget in nanoseconds since the epoch of the system clock.
+  long long timestamp;
+};
+
+typedef std::function<void( const BudgetViolation & )> BudgetCallback;
+
+/*!
+ * Bounded lock-free multi-producer multi-consumer queue of budget violations.
+ * Timers without a callback push their violations into the instance() queue, e.g., to log them from a low priority
+ *  thread instead of the control loop. Each slot has a sequence number that tells producers and consumers whether the
+ *  slot is free or filled, hence, pushing and popping only needs a compare and swap of the position and never blocks.
+ * If the queue is full, the violation is dropped and counted, see dropped().
+ */
+class BudgetViolationQueue
+{
+public:
+  static constexpr size_t DefaultCapacity = 1024;
+
+  //! The queue used by timers without a budget callback.
+  static BudgetViolationQueue &instance();
+
+  /*!
+   * @param capacity The maximum number of queued violations. Rounded up to the next power of two.
+   */
+  explicit BudgetViolationQueue( size_t capacity = DefaultCapacity );
+
+  BudgetViolationQueue( const BudgetViolationQueue & ) = delete;
+
+  BudgetViolationQueue &operator=( const BudgetViolationQueue & ) = delete;
+
+  /*!
+   * Adds a violation to the queue. Lock-free.
+   * @return False if the queue was full and the violation was dropped.
+   */
+  bool push( const BudgetViolation &violation );
+
+  /*!
+   * Removes the oldest violation from the queue. Lock-free.
+   * @param violation Set to the removed violation if the queue was not empty.
+   * @return False if the queue was empty.
+   */
+  bool pop( BudgetViolation &violation );
+
+  size_t capacity() const { return mask_ + 1; }
+
+  //! @return The number of violations that were dropped because the queue was full.
+  size_t dropped() const { return dropped_.load( std::memory_order_relaxed ); }
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    BudgetViolation violation;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  // The positions are written by different threads, so they are padded onto separate cache lines
+  char padding_a_[64];
+  std::atomic<size_t> push_position_{ 0 };
+  char padding_b_[64];
+  std::atomic<size_t> pop_position_{ 0 };
+  char padding_c_[64];
+  std::atomic<size_t> dropped_{ 0 };
+};
+
+//! @return The id of the calling thread as used by the BudgetViolation.
+long budgetThreadId();
+}
+
+#endif //HECTOR_TIMEIT_LATENCY_BUDGET_H
@@ -0,0 +1,126 @@
+#ifndef HECTOR_TIMEIT_LIVE_REPORTER_H
+#define HECTOR_TIMEIT_LIVE_REPORTER_H
+
+#include "hector_timeit/live_statistics.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hector_timeit
+{
+class ShardedTimerBase;
+
+class TimerBase;
+
+/*!
+ * Periodically reports the registered timers while they are running.
+ * The reporter only reads the LiveStatistics of the timers, hence, the timed threads are never paused or blocked by a
+ *  report. Every ShardedTimer, e.g., of a HECTOR_TIME_BLOCK, registers itself. Other timers can be added manually and
+ *  remove themselves on destruction.
+ */
+class LiveReporter
+{
+public:
+  typedef std::function<void( const std::string & )> Callback;
+
+  struct Entry
+  {
+    //! The address of the timer.
+    const void *key;
+    std::string name;
+    LiveSnapshot snapshot;
+    //! The bucket counts of the LiveHistogram if histograms are enabled, otherwise, empty.
+    std::vector<uint64_t> histogram;
+  };
+
+  static LiveReporter &instance();
+
+  ~LiveReporter();
+
+  /*!
+   * Adds a timer to the report. The timer is removed automatically when it is destructed.
+   */
+  void add( TimerBase &timer );
+
+  /*!
+   * Adds a sharded timer to the report. Called by the constructor of the ShardedTimer.
+   */
+  void add( ShardedTimerBase &timer );
+
+  /*!
+   * Removes the timer with the given address from the report.
+   */
+  void remove( const void *timer );
+
+  /*!
+   * @return The number of registered timers.
+   */
+  size_t size() const;
+
+  /*!
+   * @return Snapshots of all registered timers in the order they were added.
+   */
+  std::vector<Entry> snapshot() const;
+
+  /*!
+   * @return A report of all registered timers that had runs.
+   */
+  std::string toString() const;
+
+  /*!
+   * Starts a background thread that creates a report every period and passes it to the callback.
+   * In addition to the totals, the report contains the runs and the mean run time since the previous report.
+   * If the reporter is already running, it is restarted with the new period and callback.
+   * @param period The time between two reports.
+   * @param callback Receives the report. Called from the reporter thread. Default: Prints to std::cout.
+   */
+  void start( std::chrono::milliseconds period, Callback callback = Callback());
+
+  /*!
+   * Stops the background thread. Called on destruction.
+   */
+  void stop();
+
+  bool isRunning() const;
+
+  /*!
+   * Enables the LiveHistogram of all current and future timers, so the snapshots contain the histograms.
+   * Used by the SharedMemoryExporter to export tail latencies. Can not be disabled.
+   */
+  void enableHistograms();
+
+private:
+  LiveReporter() = default;
+
+  struct Source
+  {
+    const void *key;
+    std::string name;
+    std::function<LiveSnapshot()> snapshot;
+    std::function<bool( std::vector<uint64_t> & )> histogram;
+    std::function<void()> enable_histogram;
+    //! The live_registered_ flag of a TimerBase, cleared if the reporter is destructed first.
+    bool *registered;
+  };
+
+  void run( std::chrono::milliseconds period, Callback callback );
+
+  static std::string report( const std::vector<Entry> &entries, const std::vector<Entry> *previous );
+
+  mutable std::mutex mutex_;
+  std::vector<Source> sources_;
+  bool histograms_enabled_ = false;
+
+  std::mutex thread_mutex_;
+  std::condition_variable condition_;
+  std::thread thread_;
+  bool stop_ = false;
+};
+}
+
+#endif //HECTOR_TIMEIT_LIVE_REPORTER_H
@@ -0,0 +1,182 @@
+#ifndef HECTOR_TIMEIT_LIVE_STATISTICS_H
+#define HECTOR_TIMEIT_LIVE_STATISTICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * A consistent copy of the LiveStatistics of a timer.
+ */
+struct LiveSnapshot
+{
+  //! The number of finished runs.
+  size_t count = 0;
+  //! The sum of the finished runs in nanoseconds.
+  long long sum = 0;
+  long min = 0;
+  long max = 0;
+  //! The elapsed time of the unfinished run as of the last stop in nanoseconds.
+  long current = 0;
+
+  /*!
+   * Adds the runs of other, e.g., to combine the shards of a ShardedTimer.
+   */
+  void merge( const LiveSnapshot &other );
+};
+
+/*!
+ * Coarse histogram of the runs that can be read by other threads while the timer is used, e.g., to export tail
+ *  latencies, see SharedMemoryExporter. Uses the bucket layout of the Histogram with 4 significant bits, i.e., the
+ *  relative error of a bucket is at most 12.5%. The buckets are atomics that are only written by the timing thread,
+ *  hence, recording is a relaxed load and store without a lock prefix.
+ */
+class LiveHistogram
+{
+public:
+  static constexpr int SignificantBits = 4;
+  static constexpr size_t BucketCount = (64 - SignificantBits + 2) << (SignificantBits - 1);
+
+  LiveHistogram();
+
+  //! Records a run. Must only be called by the writing thread.
+  inline void record( long time )
+  {
+    std::atomic<uint32_t> &bucket = buckets_[bucketIndex( time )];
+    bucket.store( bucket.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+  }
+
+  //! Removes all runs. Must only be called by the writing thread.
+  void clear();
+
+  /*!
+   * Adds the bucket counts to the given counts. Can be called from any thread.
+   * @param counts Resized to BucketCount if it is smaller.
+   */
+  void addTo( std::vector<uint64_t> &counts ) const;
+
+  static inline size_t bucketIndex( long time )
+  {
+    unsigned long long v = time < 0 ? 0 : static_cast<unsigned long long>(time);
+    if ( v < (1ULL << SignificantBits)) return v;
+    int exponent = 64 - __builtin_clzll( v ) - SignificantBits;
+    return (static_cast<size_t>(exponent) << (SignificantBits - 1)) + (v >> exponent);
+  }
+
+  //! @return The center of the bucket with the given index.
+  static long bucketValue( size_t index );
+
+  /*!
+   * @param counts Bucket counts as returned by addTo, e.g., the difference of two reads for the runs in between.
+   * @param percentile The percentile in the range [0, 100].
+   * @return The center of the bucket containing the given percentile or -1 if the counts are empty.
+   */
+  static long percentile( const std::vector<uint64_t> &counts, double percentile );
+
+private:
+  std::atomic<uint32_t> buckets_[BucketCount];
+};
+
+/*!
+ * Run statistics of a timer that can be read by other threads while the timer is used.
+ * Protected by a sequence lock: The single writer (the thread using the timer) increments the sequence before and after
+ *  updating the values, and readers retry if the sequence was odd or changed while they read the values.
+ * Hence, the writer never waits for readers and updating costs a few stores to a cache line that is usually owned by
+ *  the writing thread.
+ */
+class LiveStatistics
+{
+public:
+  LiveStatistics() = default;
+
+  //! Copies the statistics but not the histogram.
+  LiveStatistics( const LiveStatistics &other ) { set( other.snapshot()); }
+
+  ~LiveStatistics();
+
+  LiveStatistics &operator=( const LiveStatistics &other )
+  {
+    if ( this != &other ) set( other.snapshot());
+    return *this;
+  }
+
+  /*!
+   * Adds a finished run. Must only be called by the writing thread.
+   */
+  inline void addRun( long time )
+  {
+    beginWrite();
+    size_t count = count_.load( std::memory_order_relaxed );
+    if ( count == 0 || time < min_.load( std::memory_order_relaxed )) min_.store( time, std::memory_order_relaxed );
+    if ( count == 0 || time > max_.load( std::memory_order_relaxed )) max_.store( time, std::memory_order_relaxed );
+    count_.store( count + 1, std::memory_order_relaxed );
+    sum_.store( sum_.load( std::memory_order_relaxed ) + time, std::memory_order_relaxed );
+    current_.store( 0, std::memory_order_relaxed );
+    endWrite();
+    LiveHistogram *histogram = histogram_.load( std::memory_order_acquire );
+    if ( histogram != nullptr ) histogram->record( time );
+  }
+
+  /*!
+   * Updates the elapsed time of the unfinished run. Must only be called by the writing thread.
+   */
+  inline void setCurrent( long time )
+  {
+    beginWrite();
+    current_.store( time, std::memory_order_relaxed );
+    endWrite();
+  }
+
+  /*!
+   * Removes all runs. Must only be called by the writing thread.
+   */
+  void clear();
+
+  /*!
+   * Starts recording the runs in a LiveHistogram. Can be called from any thread. Since the histogram is only allocated
+   *  when it is enabled, timers that are not exported only pay for a null check per run.
+   */
+  void enableHistogram();
+
+  /*!
+   * Adds the bucket counts of the histogram to the given counts. Can be called from any thread.
+   * @return False if the histogram is not enabled.
+   */
+  bool histogram( std::vector<uint64_t> &counts ) const;
+
+  /*!
+   * Reads a consistent copy of the statistics. Can be called from any thread and spins while a write is in progress.
+   */
+  LiveSnapshot snapshot() const;
+
+private:
+  inline void beginWrite()
+  {
+    unsigned sequence = sequence_.load( std::memory_order_relaxed );
+    sequence_.store( sequence + 1, std::memory_order_relaxed );
+    // Orders the odd sequence before the stores of the values
+    std::atomic_thread_fence( std::memory_order_release );
+  }
+
+  inline void endWrite()
+  {
+    sequence_.store( sequence_.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+  }
+
+  void set( const LiveSnapshot &snapshot );
+
+  std::atomic<unsigned> sequence_{ 0 };
+  std::atomic<size_t> count_{ 0 };
+  std::atomic<long long> sum_{ 0 };
+  std::atomic<long> min_{ 0 };
+  std::atomic<long> max_{ 0 };
+  std::atomic<long> current_{ 0 };
+  std::atomic<LiveHistogram *> histogram_{ nullptr };
+};
+}
+
+#endif //HECTOR_TIMEIT_LIVE_STATISTICS_H
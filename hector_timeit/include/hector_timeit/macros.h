@@ -6,26 +6,149 @@
 #define HECTOR_TIMEIT_MACROS_H
 
 #include "hector_timeit/timer.h"
+#include "hector_timeit/benchmark.h"
+#include "hector_timeit/live_reporter.h"
+#include "hector_timeit/scope_profiler.h"
+#include "hector_timeit/sharded_timer.h"
+
+/* ******************************************************************** */
+/* ****************** Compile-time levels and categories ************** */
+/* ******************************************************************** */
+#define HECTOR_TIMEIT_LEVEL_NONE 0
+#define HECTOR_TIMEIT_LEVEL_ESSENTIAL 1
+#define HECTOR_TIMEIT_LEVEL_DEFAULT 2
+#define HECTOR_TIMEIT_LEVEL_VERBOSE 3
+
+/*!
+ * @define HECTOR_TIMEIT_LEVEL
+ * @brief The highest level of instrumentation that is compiled. Define it before including any hector_timeit header,
+ *  e.g., using add_definitions(-DHECTOR_TIMEIT_LEVEL=0) in the CMakeLists.txt.
+ *
+ * HECTOR_TIMEIT_LEVEL_NONE (0): The block, section and scope macros expand to nothing.
+ * HECTOR_TIMEIT_LEVEL_ESSENTIAL (1): Only the block, section and scope macros without a level and those marked as
+ *  ESSENTIAL using HECTOR_TIMEIT_AT_LEVEL are compiled.
+ * HECTOR_TIMEIT_LEVEL_DEFAULT (2): Additionally, instrumentation marked as DEFAULT is compiled.
+ * HECTOR_TIMEIT_LEVEL_VERBOSE (3): Everything is compiled. @b Default
+ *
+ * The macros that time and print a single statement, e.g., HECTOR_TIME, are not affected.
+ */
+#ifndef HECTOR_TIMEIT_LEVEL
+#define HECTOR_TIMEIT_LEVEL HECTOR_TIMEIT_LEVEL_VERBOSE
+#endif
+
+#if HECTOR_TIMEIT_LEVEL >= HECTOR_TIMEIT_LEVEL_ESSENTIAL
+#define _HECTOR_TIMEIT_LEVEL_ESSENTIAL(...) __VA_ARGS__
+#else
+#define _HECTOR_TIMEIT_LEVEL_ESSENTIAL(...)
+#endif
+#if HECTOR_TIMEIT_LEVEL >= HECTOR_TIMEIT_LEVEL_DEFAULT
+#define _HECTOR_TIMEIT_LEVEL_DEFAULT(...) __VA_ARGS__
+#else
+#define _HECTOR_TIMEIT_LEVEL_DEFAULT(...)
+#endif
+#if HECTOR_TIMEIT_LEVEL >= HECTOR_TIMEIT_LEVEL_VERBOSE
+#define _HECTOR_TIMEIT_LEVEL_VERBOSE(...) __VA_ARGS__
+#else
+#define _HECTOR_TIMEIT_LEVEL_VERBOSE(...)
+#endif
+
+/*!
+ * @define HECTOR_TIMEIT_AT_LEVEL
+ * @brief Compiles the given instrumentation only if HECTOR_TIMEIT_LEVEL is at least the given level.
+ *
+ * @b Usage: HECTOR_TIMEIT_AT_LEVEL(Level, Instrumentation)
+ *
+ * @b Example: HECTOR_TIMEIT_AT_LEVEL(VERBOSE, HECTOR_TIME_BLOCK(InnerLoop));
+ *
+ * All macros of a section have to be wrapped with the same level.
+ *
+ * @param Level One of: ESSENTIAL, DEFAULT, VERBOSE.
+ * @param Instrumentation The macro invocations or code that are removed if the level is disabled.
+ */
+#define HECTOR_TIMEIT_AT_LEVEL(level, ...) _HECTOR_TIMEIT_LEVEL_##level(__VA_ARGS__)
+
+// Evaluates to 1 if the argument is a macro defined as 1 or as nothing and to 0 otherwise.
+// The same technique as IS_ENABLED in the Linux kernel.
+#define _HECTOR_TIMEIT_PLACEHOLDER_ 0,
+#define _HECTOR_TIMEIT_PLACEHOLDER_1 0,
+#define _HECTOR_TIMEIT_IS_SET(value) _HECTOR_TIMEIT_IS_SET_(value)
+#define _HECTOR_TIMEIT_IS_SET_(value) _HECTOR_TIMEIT_IS_SET__(_HECTOR_TIMEIT_PLACEHOLDER_##value)
+#define _HECTOR_TIMEIT_IS_SET__(arg_or_junk) _HECTOR_TIMEIT_SECOND_ARG(arg_or_junk 1, 0, 0)
+#define _HECTOR_TIMEIT_SECOND_ARG(ignored, value, ...) value
+#define _HECTOR_TIMEIT_UNLESS(condition, ...) _HECTOR_TIMEIT_UNLESS_(condition, __VA_ARGS__)
+#define _HECTOR_TIMEIT_UNLESS_(condition, ...) _HECTOR_TIMEIT_UNLESS_##condition(__VA_ARGS__)
+#define _HECTOR_TIMEIT_UNLESS_0(...) __VA_ARGS__
+#define _HECTOR_TIMEIT_UNLESS_1(...)
+
+/*!
+ * @define HECTOR_TIMEIT_IN_CATEGORY
+ * @brief Compiles the given instrumentation unless its category is disabled.
+ *
+ * @b Usage: HECTOR_TIMEIT_IN_CATEGORY(Category, Instrumentation)
+ *
+ * A category is disabled by defining HECTOR_TIMEIT_DISABLE_&lt;Category&gt; as nothing or 1, e.g., using
+ *  add_definitions(-DHECTOR_TIMEIT_DISABLE_Planning). The definition is checked where the macro is used.
+ *
+ * @b Example: HECTOR_TIMEIT_IN_CATEGORY(Planning, HECTOR_TIME_BLOCK(PathSearch));
+ *
+ * Can be combined with levels: HECTOR_TIMEIT_AT_LEVEL(VERBOSE, HECTOR_TIMEIT_IN_CATEGORY(Planning, ...)).
+ * All macros of a section have to be wrapped with the same category.
+ *
+ * @param Category The name of the category. Valid characters: "a-zA-Z0-9_"
+ * @param Instrumentation The macro invocations or code that are removed if the category is disabled.
+ */
+#define HECTOR_TIMEIT_IN_CATEGORY(category, ...)\
+  _HECTOR_TIMEIT_UNLESS(_HECTOR_TIMEIT_IS_SET(HECTOR_TIMEIT_DISABLE_##category), __VA_ARGS__)
+
+/*!
+ * @define HECTOR_TIMEIT_STRINGIFY
+ * @brief Converts the expansion of the arguments to a string literal. Disabled instrumentation yields "".
+ */
+#define HECTOR_TIMEIT_STRINGIFY(...) _HECTOR_TIMEIT_STRINGIFY(__VA_ARGS__)
+#define _HECTOR_TIMEIT_STRINGIFY(...) #__VA_ARGS__
 
 /* ******************************************************************** */
 /* ********************* Default name definitions ********************* */
 /* ******************************************************************** */
-#define _HECTOR_TIMEIT_ANONYMOUS_NAME_STR(name, line) \
-std::string( "anonymous timer at " ) + ([] () {\
-  std::string file_name = name;\
-  std::size_t pos = file_name.find_last_of("/\\");\
-  if (pos == std::string::npos) return file_name;\
-  return file_name.substr(pos+1);\
-})() + std::string( ":"#line )
-#define _HECTOR_TIMEIT_ANONYMOUS_NAME_STR_EXPAND(name, line) _HECTOR_TIMEIT_ANONYMOUS_NAME_STR(name, line)
-#define HECTOR_TIMEIT_ANONYMOUS_NAME _HECTOR_TIMEIT_ANONYMOUS_NAME_STR_EXPAND(__FILE__, __LINE__)
+/*!
+ * @define HECTOR_TIMEIT_STATIC_NAME
+ * @brief A static NameDescriptor for the given name which is interned once, so timers created with it don't allocate.
+ *
+ * @b Usage: Timer timer( HECTOR_TIMEIT_STATIC_NAME("Name") );
+ *
+ * @param Name A string literal.
+ */
+#define HECTOR_TIMEIT_STATIC_NAME(name) \
+([] () -> const ::hector_timeit::NameDescriptor & {\
+  static const ::hector_timeit::NameDescriptor descriptor( name );\
+  return descriptor;\
+})()
+
+// The name as it is passed to the timer. String literals are interned once per call site, other names on every call.
+#define _HECTOR_TIMEIT_CALL_SITE_NAME(name) \
+([] () -> ::hector_timeit::detail::CallSiteName & {\
+  static ::hector_timeit::detail::CallSiteName call_site;\
+  return call_site;\
+})()( name )
+
+/*!
+ * @define HECTOR_TIMEIT_ANONYMOUS_NAME
+ * @brief A static NameDescriptor named "anonymous timer at <file>:<line>".
+ * The file name is extracted from __FILE__ at compile time.
+ */
+#define HECTOR_TIMEIT_ANONYMOUS_NAME \
+([] () -> const ::hector_timeit::NameDescriptor & {\
+  static const ::hector_timeit::NameDescriptor descriptor( "anonymous timer at ",\
+                                                           ::hector_timeit::detail::basename( __FILE__ ), __LINE__ );\
+  return descriptor;\
+})()
 
 
 /* ******************************************************************** */
 /* *************** Time for console and ros definitions *************** */
 /* ******************************************************************** */
 #define _HECTOR_TIME(code, name, stream) \
-stream << ::hector_timeit::Timer::time(std::function<void(void)>([&] () { code; }))->toString( name ) << std::endl
+stream << ::hector_timeit::Timer::time([&] () { code; }).toString( name ) << std::endl
 
 #define _HECTOR_TIME_CONSOLE_ANONYMOUS(code) _HECTOR_TIME(code, HECTOR_TIMEIT_ANONYMOUS_NAME, std::cout)
 #define _HECTOR_TIME_CONSOLE(code, name) _HECTOR_TIME(code, name, std::cout)
@@ -52,7 +175,7 @@ stream << ::hector_timeit::Timer::time(std::function<void(void)>([&] () { code;
 _HECTOR_TIME_GET_MACRO(__VA_ARGS__, _HECTOR_TIME, _HECTOR_TIME_CONSOLE, _HECTOR_TIME_CONSOLE_ANONYMOUS)(__VA_ARGS__)
 
 #define _HECTOR_TIME_ROS(code, name, level) \
-ROS_##level("%s", ::hector_timeit::Timer::time(std::function<void(void)>([&] () { code; }))->toString( name ).c_str())
+ROS_##level("%s", ::hector_timeit::Timer::time([&] () { code; }).toString( name ).c_str())
 
 #define _HECTOR_TIME_ROS_INFO(code, name) _HECTOR_TIME_ROS(code, name, INFO)
 #define _HECTOR_TIME_ROS_INFO_LINE(code) _HECTOR_TIME_ROS(code, HECTOR_TIMEIT_ANONYMOUS_NAME, INFO)
@@ -82,9 +205,9 @@ _HECTOR_TIME_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_ROS, _HECTOR_TIME_ROS_INFO,
 /* ******************************************************************** */
 /* *********** Time N times for console and ros definitions *********** */
 /* ******************************************************************** */
-#define _HECTOR_TIMEN(code, count, timer_name, stream) \
+#define _HECTOR_TIMEN_WITH(timer_type, code, count, timer_name, stream) \
 do {\
-::hector_timeit::Timer hector_timeit_timer_4SFD78SFA8( timer_name, ::hector_timeit::Timer::Default, false );\
+timer_type hector_timeit_timer_4SFD78SFA8( timer_name, ::hector_timeit::TimerBase::Default, false );\
 bool used_break_4SFD78SFA8 = false;\
 for ( long i = 0; i < count; ++i ) \
 {\
@@ -103,8 +226,10 @@ if (used_break_4SFD78SFA8)\
 stream << hector_timeit_timer_4SFD78SFA8.toString() << std::endl;\
 } while (false)
 
+#define _HECTOR_TIMEN(code, count, timer_name, stream) _HECTOR_TIMEN_WITH(::hector_timeit::Timer, code, count, timer_name, stream)
 #define _HECTOR_TIMEN_CONSOLE_ANONYMOUS(code, count) _HECTOR_TIMEN(code, count, HECTOR_TIMEIT_ANONYMOUS_NAME, std::cout)
-#define _HECTOR_TIMEN_CONSOLE(code, count, name) _HECTOR_TIMEN(code, count, name, std::cout)
+#define _HECTOR_TIMEN_NAMED(code, count, name, stream) _HECTOR_TIMEN(code, count, _HECTOR_TIMEIT_CALL_SITE_NAME(name), stream)
+#define _HECTOR_TIMEN_CONSOLE(code, count, name) _HECTOR_TIMEN_NAMED(code, count, name, std::cout)
 #define _HECTOR_TIMEN_GET_MACRO(_1, _2, _3, _4, name, ...) name
 /*!
  * @define HECTOR_TIMEN
@@ -128,11 +253,64 @@ stream << hector_timeit_timer_4SFD78SFA8.toString() << std::endl;\
  * @param Stream (Optional) The stream to which the output is streamed. @b Default: std::cout
  */
 #define HECTOR_TIMEN(...) \
-_HECTOR_TIMEN_GET_MACRO(__VA_ARGS__, _HECTOR_TIMEN, _HECTOR_TIMEN_CONSOLE, _HECTOR_TIMEN_CONSOLE_ANONYMOUS)(__VA_ARGS__)
+_HECTOR_TIMEN_GET_MACRO(__VA_ARGS__, _HECTOR_TIMEN_NAMED, _HECTOR_TIMEN_CONSOLE, _HECTOR_TIMEN_CONSOLE_ANONYMOUS)(__VA_ARGS__)
+
+#define _HECTOR_TIMEN_COUNTERS(code, count, timer_name, stream) _HECTOR_TIMEN_WITH(::hector_timeit::CountingTimer, code, count, timer_name, stream)
+#define _HECTOR_TIMEN_COUNTERS_CONSOLE_ANONYMOUS(code, count) _HECTOR_TIMEN_COUNTERS(code, count, HECTOR_TIMEIT_ANONYMOUS_NAME, std::cout)
+#define _HECTOR_TIMEN_COUNTERS_NAMED(code, count, name, stream) _HECTOR_TIMEN_COUNTERS(code, count, _HECTOR_TIMEIT_CALL_SITE_NAME(name), stream)
+#define _HECTOR_TIMEN_COUNTERS_CONSOLE(code, count, name) _HECTOR_TIMEN_COUNTERS_NAMED(code, count, name, std::cout)
+/*!
+ * @define HECTOR_TIMEN_COUNTERS
+ * @brief Same as HECTOR_TIMEN but also measures the hardware performance counters using the CountingTimer.
+ *
+ * @b Usage: HECTOR_TIMEN_COUNTERS(Code, Count[, Name[, Stream]])
+ *
+ * If the kernel allows counting, the table has an additional row with the instructions per cycle and the cycles,
+ *  instructions, L1 data cache misses, last level cache misses and branch misses per run. Otherwise, the output is the
+ *  same as the output of HECTOR_TIMEN.
+ */
+#define HECTOR_TIMEN_COUNTERS(...) \
+_HECTOR_TIMEN_GET_MACRO(__VA_ARGS__, _HECTOR_TIMEN_COUNTERS_NAMED, _HECTOR_TIMEN_COUNTERS_CONSOLE, _HECTOR_TIMEN_COUNTERS_CONSOLE_ANONYMOUS)(__VA_ARGS__)
+
+#define _HECTOR_TIMEN_PARALLEL(code, count, timer_name, stream) \
+do {\
+stream << ::hector_timeit::Benchmark::runScaling( timer_name, [&]() { code; }, count ) << std::endl;\
+} while (false)
+#define _HECTOR_TIMEN_PARALLEL_CONSOLE_ANONYMOUS(code, count) _HECTOR_TIMEN_PARALLEL(code, count, HECTOR_TIMEIT_ANONYMOUS_NAME, std::cout)
+#define _HECTOR_TIMEN_PARALLEL_NAMED(code, count, name, stream) _HECTOR_TIMEN_PARALLEL(code, count, name, stream)
+#define _HECTOR_TIMEN_PARALLEL_CONSOLE(code, count, name) _HECTOR_TIMEN_PARALLEL_NAMED(code, count, name, std::cout)
+/*!
+ * @define HECTOR_TIMEN_PARALLEL
+ * @brief Times the execution of the given code N times on each of 1, 2, 4, ..., (number of cores) threads and outputs
+ *  how it scales.
+ *
+ * @b Usage: HECTOR_TIMEN_PARALLEL(Code, Count[, Name[, Stream]])
+ *
+ * The threads of each step are started together from a barrier and every thread executes the code Count times timing
+ *  each run with its own timer. Use hector_timeit::Benchmark::runScaling to limit the threads or pin them to cores.
+ *
+ * @b Example @b 1: HECTOR_TIMEN_PARALLEL(updateMap(), 1000, "MapUpdate");
+ *
+ * @b Output:
+ * @code
+ * [Scaling: MapUpdate] 1000 run(s) per thread took:
+ * Threads       Throughput         Average             p99         Longest     Speedup  Efficiency
+ *       1         48078.5/s        20.799us        24.113us        81.402us       1.00x      100.0%
+ *       2         91302.4/s        21.901us        27.562us       102.113us       1.90x       95.0%
+ *       4        153846.2/s        25.997us        41.035us       187.610us       3.20x       80.0%
+ * @endcode
+ *
+ * @param Code The code that is timed. Is executed concurrently by multiple threads, hence, it has to be thread-safe.
+ * @param Count How many times the code should be executed by each thread.
+ * @param Name (Optional) The name for the output string. @b Default: Generated using filename and line number
+ * @param Stream (Optional) The stream to which the output is streamed. @b Default: std::cout
+ */
+#define HECTOR_TIMEN_PARALLEL(...) \
+_HECTOR_TIMEN_GET_MACRO(__VA_ARGS__, _HECTOR_TIMEN_PARALLEL_NAMED, _HECTOR_TIMEN_PARALLEL_CONSOLE, _HECTOR_TIMEN_PARALLEL_CONSOLE_ANONYMOUS)(__VA_ARGS__)
 
 #define _HECTOR_TIMEN_ROS(code, count, timer_name, level) \
 do {\
-::hector_timeit::Timer hector_timeit_timer_4SFD78SFA8( timer_name, ::hector_timeit::Timer::Default, false );\
+::hector_timeit::Timer hector_timeit_timer_4SFD78SFA8( timer_name, ::hector_timeit::TimerBase::Default, false );\
 bool used_break_4SFD78SFA8;\
 for ( long i = 0; i < count; ++i ) \
 {\
@@ -151,7 +329,8 @@ if (used_break_4SFD78SFA8)\
 ROS_##level("%s", hector_timeit_timer_4SFD78SFA8.toString().c_str());\
 } while (false)
 
-#define _HECTOR_TIMEN_ROS_INFO(code, count, name) _HECTOR_TIMEN_ROS(code, count, name, INFO)
+#define _HECTOR_TIMEN_ROS_NAMED(code, count, name, level) _HECTOR_TIMEN_ROS(code, count, _HECTOR_TIMEIT_CALL_SITE_NAME(name), level)
+#define _HECTOR_TIMEN_ROS_INFO(code, count, name) _HECTOR_TIMEN_ROS_NAMED(code, count, name, INFO)
 #define _HECTOR_TIMEN_ROS_INFO_LINE(code, count) _HECTOR_TIMEN_ROS(code, count, HECTOR_TIMEIT_ANONYMOUS_NAME, INFO)
 #define _HECTOR_TIMEN_ROS_GET_MACRO(_1, _2, _3, _4, name, ...) name
 /*!
@@ -176,7 +355,43 @@ ROS_##level("%s", hector_timeit_timer_4SFD78SFA8.toString().c_str());\
  * @param Level (Optional) The level of the output which can be one of the following: DEBUG, INFO, WARN, ERROR. @b Default: INFO
  */
 #define HECTOR_TIMEN_ROS(...) \
-_HECTOR_TIMEN_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIMEN_ROS, _HECTOR_TIMEN_ROS_INFO, _HECTOR_TIMEN_ROS_INFO_LINE)(__VA_ARGS__)
+_HECTOR_TIMEN_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIMEN_ROS_NAMED, _HECTOR_TIMEN_ROS_INFO, _HECTOR_TIMEN_ROS_INFO_LINE)(__VA_ARGS__)
+
+/* ******************************************************************** */
+/* **************** Benchmark for console definitions ***************** */
+/* ******************************************************************** */
+#define _HECTOR_BENCHMARK(code, benchmark_name, stream) \
+do {\
+stream << ::hector_timeit::Benchmark::run( benchmark_name, [&]() { code; } ) << std::endl;\
+} while (false)
+#define _HECTOR_BENCHMARK_CONSOLE(code, name) _HECTOR_BENCHMARK(code, name, std::cout)
+#define _HECTOR_BENCHMARK_CONSOLE_ANONYMOUS(code) _HECTOR_BENCHMARK(code, HECTOR_TIMEIT_ANONYMOUS_NAME, std::cout)
+#define _HECTOR_BENCHMARK_GET_MACRO(_1, _2, _3, name, ...) name
+/*!
+ * @define HECTOR_BENCHMARK
+ * @brief Benchmarks the given code and outputs the time per iteration with a confidence interval to the given stream.
+ *
+ * @b Usage: HECTOR_BENCHMARK(Code[, Name[, Stream]])
+ *
+ * Unlike HECTOR_TIMEN, the number of iterations is chosen automatically: After a warmup, the code is executed in
+ *  batches that are long enough for the clock overhead to be negligible until the confidence interval of the mean is
+ *  within 1% or the time budget of 5s is exhausted. Use hector_timeit::Benchmark::run for other options.
+ *
+ * @b Example @b 1: HECTOR_BENCHMARK(hector_timeit::doNotOptimize(someFunction()), "SomeFunction");
+ *
+ * @b Output:
+ * @code
+ * [Benchmark: SomeFunction] 52 sample(s) of 4096 iteration(s) (target error reached)
+ * Per iteration: 245.212ns [244.008ns, 246.431ns] (95% CI, +- 0.5%), median: 244.531ns, stddev: 4.475ns
+ * Outliers: 3 (5.8%): 0 low severe, 0 low mild, 2 high mild, 1 high severe
+ * @endcode
+ *
+ * @param Code The benchmarked code. Can be multiple commands separated by semicolons. Can't have side effects since it is executed multiple times.
+ * @param Name (Optional) The name of the benchmark for the output string. @b Default: Generated using filename and line number
+ * @param Stream (Optional) The stream to which the output is streamed. @b Default: std::cout
+ */
+#define HECTOR_BENCHMARK(...) \
+_HECTOR_BENCHMARK_GET_MACRO(__VA_ARGS__, _HECTOR_BENCHMARK, _HECTOR_BENCHMARK_CONSOLE, _HECTOR_BENCHMARK_CONSOLE_ANONYMOUS)(__VA_ARGS__)
 
 /* ******************************************************************** */
 /* ********* Time and return for console and ros definitions ********** */
@@ -199,9 +414,9 @@ struct argument_type<T( U )>
 }
 
 #define _HECTOR_TIME_AND_RETURN(return_type, code, name, stream) ([&] () {\
-auto timer_result = ::hector_timeit::Timer::time(std::function<::hector_timeit::macros::argument_type<void(return_type)>::type (void)>([&] () -> ::hector_timeit::macros::argument_type<void(return_type)>::type { return code; }));\
-stream << timer_result->toString( name ) << std::endl;\
-return timer_result->result;\
+auto timer_result = ::hector_timeit::Timer::time([&] () -> ::hector_timeit::macros::argument_type<void(return_type)>::type { return code; });\
+stream << timer_result.toString( name ) << std::endl;\
+return std::forward<decltype(timer_result.result)>(timer_result.result);\
 })()
 
 #define _HECTOR_TIME_AND_RETURN_CONSOLE_ANONYMOUS(return_type, code) _HECTOR_TIME_AND_RETURN(return_type, code, HECTOR_TIMEIT_ANONYMOUS_NAME, std::cout)
@@ -227,9 +442,9 @@ return timer_result->result;\
 _HECTOR_TIME_AND_RETURN_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_AND_RETURN, _HECTOR_TIME_AND_RETURN_CONSOLE, _HECTOR_TIME_AND_RETURN_CONSOLE_ANONYMOUS)(__VA_ARGS__)
 
 #define _HECTOR_TIME_AND_RETURN_ROS(return_type, code, name, level) ([&] () {\
-auto timer_result = ::hector_timeit::Timer::time(std::function<::hector_timeit::macros::argument_type<void(return_type)>::type (void)>([&] () -> ::hector_timeit::macros::argument_type<void(return_type)>::type  { return code; }));\
-ROS_##level( "%s", timer_result->toString( name ).c_str());\
-return timer_result->result;\
+auto timer_result = ::hector_timeit::Timer::time([&] () -> ::hector_timeit::macros::argument_type<void(return_type)>::type { return code; });\
+ROS_##level( "%s", timer_result.toString( name ).c_str());\
+return std::forward<decltype(timer_result.result)>(timer_result.result);\
 })()
 #define _HECTOR_TIME_AND_RETURN_ROS_INFO(return_type, code, name) _HECTOR_TIME_AND_RETURN_ROS(return_type, code, name, INFO)
 #define _HECTOR_TIME_AND_RETURN_ROS_INFO_LINE(return_type, code) _HECTOR_TIME_AND_RETURN_ROS(return_type, code, HECTOR_TIMEIT_ANONYMOUS_NAME, INFO)
@@ -256,8 +471,26 @@ _HECTOR_TIME_AND_RETURN_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_AND_RETURN_ROS,
 /* ******************************************************************** */
 /* ************************ Hector time section *********************** */
 /* ******************************************************************** */
-#define _HECTOR_TIME_SECTION(sectionname, autostart)\
-::hector_timeit::Timer __hector_timeit_timer_##sectionname(#sectionname, ::hector_timeit::Timer::Default, autostart)
+#define _HECTOR_TIME_SECTION_WITH(timer_type, sectionname, autostart)\
+timer_type __hector_timeit_timer_##sectionname(HECTOR_TIMEIT_STATIC_NAME(#sectionname), ::hector_timeit::TimerBase::Default, autostart)
+#define _HECTOR_TIME_SECTION_WITH_AUTOSTART(timer_type, sectionname) _HECTOR_TIME_SECTION_WITH(timer_type, sectionname, true)
+#define _HECTOR_TIME_SECTION_WITH_GET_MACRO(_1, _2, _3, name, ...) name
+/*!
+ * @define HECTOR_TIME_SECTION_WITH
+ * @brief Creates a timer section with the given name using the given timer type.
+ *
+ * @b Usage: HECTOR_TIME_SECTION_WITH(TimerType, Name[, Autostart])
+ *
+ * @b Example: HECTOR_TIME_SECTION_WITH(::hector_timeit::WallTimer, SomeSection);
+ *
+ * @param TimerType The BasicTimer instantiation, e.g., ::hector_timeit::WallTimer. Use a typedef if it contains commas.
+ * @param Name The name of the timer. Used for printing the result. Valid characters: "a-zA-Z0-9_"
+ * @param Autostart (Optional) Pass true to immediately start the timer, pass false to start off as paused. @b Default: true.
+ */
+#define HECTOR_TIME_SECTION_WITH(...)\
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_SECTION_WITH_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_WITH, _HECTOR_TIME_SECTION_WITH_AUTOSTART)(__VA_ARGS__))
+
+#define _HECTOR_TIME_SECTION(sectionname, autostart) _HECTOR_TIME_SECTION_WITH(::hector_timeit::Timer, sectionname, autostart)
 #define _HECTOR_TIME_SECTION_AUTOSTART(sectionname) _HECTOR_TIME_SECTION(sectionname, true)
 #define _HECTOR_TIME_SECTION_GET_MACRO(_1, _2, name, ...) name
 /*!
@@ -270,7 +503,52 @@ _HECTOR_TIME_AND_RETURN_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_AND_RETURN_ROS,
  * @param Autostart (Optional) Pass true to immediately start the timer, pass false to start off as paused. @b Default: true.
  */
 #define HECTOR_TIME_SECTION(...)\
-_HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_SECTION_AUTOSTART)(__VA_ARGS__)
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_SECTION_AUTOSTART)(__VA_ARGS__))
+
+#define _HECTOR_TIME_SECTION_SAMPLED(sectionname, period, mode)\
+::hector_timeit::Timer __hector_timeit_timer_##sectionname(HECTOR_TIMEIT_STATIC_NAME(#sectionname), ::hector_timeit::TimerBase::Default, false);\
+__hector_timeit_timer_##sectionname.setSamplePeriod(period);\
+::hector_timeit::Sampler __hector_timeit_sampler_##sectionname(period, ::hector_timeit::Sampler::mode)
+#define _HECTOR_TIME_SECTION_SAMPLED_EVERY_NTH(sectionname, period) _HECTOR_TIME_SECTION_SAMPLED(sectionname, period, EveryNth)
+#define _HECTOR_TIME_SECTION_SAMPLED_GET_MACRO(_1, _2, _3, name, ...) name
+/*!
+ * @define HECTOR_TIME_SECTION_SAMPLED
+ * @brief Creates a paused timer section with the given name whose runs are sampled.
+ *
+ * @b Usage: HECTOR_TIME_SECTION_SAMPLED(Name, Period[, Mode])
+ *
+ * Runs are timed using HECTOR_TIME_SECTION_SAMPLED_RUN which only times 1 in Period runs. The printed run count and sum
+ *  are extrapolated from the timed runs.
+ * @code
+ * HECTOR_TIME_SECTION_SAMPLED(ExampleSection, 100);
+ * for (int i = 0; i &lt; 10000; ++i)
+ * {
+ *   HECTOR_TIME_SECTION_SAMPLED_RUN(ExampleSection);
+ *   // Some code
+ * }
+ * HECTOR_TIME_SECTION_PRINT(ExampleSection);
+ * @endcode
+ *
+ * @param Name The name of the timer. Used for printing the result. Valid characters: "a-zA-Z0-9_"
+ * @param Period On average, 1 in Period runs is timed.
+ * @param Mode (Optional) How the timed runs are chosen, one of: EveryNth, Random. See Sampler::Mode.
+ *  @b Default: EveryNth
+ */
+#define HECTOR_TIME_SECTION_SAMPLED(...)\
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_SECTION_SAMPLED_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_SAMPLED, _HECTOR_TIME_SECTION_SAMPLED_EVERY_NTH)(__VA_ARGS__))
+
+/*!
+ * @define HECTOR_TIME_SECTION_SAMPLED_RUN
+ * @brief Times the rest of the enclosing block as a run of the section if the sampler of the section chooses it.
+ *
+ * @b Usage: HECTOR_TIME_SECTION_SAMPLED_RUN(Name)
+ *
+ * @param Name The name of the section. Has to be a section created with HECTOR_TIME_SECTION_SAMPLED(Name, Period).
+ */
+#define HECTOR_TIME_SECTION_SAMPLED_RUN(sectionname) \
+  _HECTOR_TIMEIT_LEVEL_ESSENTIAL(\
+    ::hector_timeit::SampledTimeBlock __hector_timeit_sampled_run_##sectionname(__hector_timeit_timer_##sectionname,\
+                                                                               __hector_timeit_sampler_##sectionname))
 
 /*!
  * @define HECTOR_TIME_SECTION_PAUSE
@@ -281,7 +559,7 @@ _HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_S
  * @param Name The name of the section. Has to be a valid section that has been started with HECTOR_TIME_SECTION(Name).
  */
 #define HECTOR_TIME_SECTION_PAUSE(sectionname) \
-  __hector_timeit_timer_##sectionname.stop()
+  _HECTOR_TIMEIT_LEVEL_ESSENTIAL(__hector_timeit_timer_##sectionname.stop())
 
 /*!
  * @define HECTOR_TIME_SECTION_RESUME
@@ -292,7 +570,7 @@ _HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_S
  * @param Name The name of the section. Has to be a valid section that has been started with HECTOR_TIME_SECTION(Name).
  */
 #define HECTOR_TIME_SECTION_RESUME(sectionname) \
-  __hector_timeit_timer_##sectionname.start()
+  _HECTOR_TIMEIT_LEVEL_ESSENTIAL(__hector_timeit_timer_##sectionname.start())
 
 /*!
  * @define HECTOR_TIME_SECTION_END
@@ -302,7 +580,7 @@ _HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_S
  *
  * @param Name The name of the section. Has to be a valid section that has been started with HECTOR_TIME_SECTION(Name).
  */
-#define HECTOR_TIME_SECTION_END(sectionname) HECTOR_TIME_SECTION_PAUSE(sectionname)
+#define HECTOR_TIME_SECTION_END(sectionname) _HECTOR_TIMEIT_LEVEL_ESSENTIAL(HECTOR_TIME_SECTION_PAUSE(sectionname))
 
 /*!
  * @define HECTOR_TIME_SECTION_END_RUN
@@ -325,9 +603,8 @@ _HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_S
  * @param Name The name of the section. Has to be a valid section that has been started with HECTOR_TIME_SECTION(Name).
  */
 #define HECTOR_TIME_SECTION_END_RUN(sectionname) \
-  HECTOR_TIME_SECTION_PAUSE(sectionname);\
-  __hector_timeit_timer_##sectionname.reset( true )\
-
+  _HECTOR_TIMEIT_LEVEL_ESSENTIAL(HECTOR_TIME_SECTION_PAUSE(sectionname);\
+  __hector_timeit_timer_##sectionname.reset( true ))
 /*!
  * @define HECTOR_TIME_SECTION_NEW_RUN
  * @brief Ends one run of the section.
@@ -351,8 +628,22 @@ _HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_S
  * @param Name The name of the section. Has to be a valid section that has been started with HECTOR_TIME_SECTION(Name).
  */
 #define HECTOR_TIME_SECTION_NEW_RUN(sectionname) \
-  __hector_timeit_timer_##sectionname.reset( true );\
-  HECTOR_TIME_SECTION_RESUME(sectionname)
+  _HECTOR_TIMEIT_LEVEL_ESSENTIAL(__hector_timeit_timer_##sectionname.reset( true );\
+  HECTOR_TIME_SECTION_RESUME(sectionname))
+
+/*!
+ * @define HECTOR_TIME_SECTION_REPORT_LIVE
+ * @brief Adds the timer of the given section to the LiveReporter.
+ *
+ * @b Usage: HECTOR_TIME_SECTION_REPORT_LIVE(Name)
+ *
+ * The section is contained in the reports of the LiveReporter until it goes out of scope. Blocks timed with
+ *  HECTOR_TIME_BLOCK are always contained.
+ *
+ * @param Name The name of the section. Has to be a valid section that has been started with HECTOR_TIME_SECTION(Name).
+ */
+#define HECTOR_TIME_SECTION_REPORT_LIVE(sectionname) \
+  _HECTOR_TIMEIT_LEVEL_ESSENTIAL(::hector_timeit::LiveReporter::instance().add( __hector_timeit_timer_##sectionname ))
 
 #define _HECTOR_TIME_SECTION_PRINT(sectionname, stream) \
   __hector_timeit_timer_##sectionname.stop();\
@@ -371,7 +662,7 @@ _HECTOR_TIME_SECTION_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION, _HECTOR_TIME_S
  * @param Stream (Optional) The stream to which the output is streamed. @b Default: std::cout
  */
 #define HECTOR_TIME_SECTION_PRINT(...) \
-_HECTOR_TIME_SECTION_PRINT_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_PRINT, _HECTOR_TIME_SECTION_PRINT_CONSOLE)(__VA_ARGS__)
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_SECTION_PRINT_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_PRINT, _HECTOR_TIME_SECTION_PRINT_CONSOLE)(__VA_ARGS__))
 
 #define _HECTOR_TIME_SECTION_END_AND_PRINT(sectionname, stream) \
   __hector_timeit_timer_##sectionname.stop();\
@@ -388,7 +679,7 @@ _HECTOR_TIME_SECTION_PRINT_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_PRINT, _H
  * @param Stream (Optional) The stream to which the output is streamed. @b Default: std::cout
  */
 #define HECTOR_TIME_SECTION_END_AND_PRINT(...) \
-_HECTOR_TIME_SECTION_END_AND_PRINT_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_END_AND_PRINT, _HECTOR_TIME_SECTION_END_AND_PRINT_CONSOLE)(__VA_ARGS__)
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_SECTION_END_AND_PRINT_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_END_AND_PRINT, _HECTOR_TIME_SECTION_END_AND_PRINT_CONSOLE)(__VA_ARGS__))
 
 
 #define _HECTOR_TIME_SECTION_PRINT_ROS(sectionname, level) \
@@ -408,7 +699,7 @@ _HECTOR_TIME_SECTION_END_AND_PRINT_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_E
  * @param Level (Optional) The level of the output which can be one of the following: DEBUG, INFO, WARN, ERROR. Default: INFO
  */
 #define HECTOR_TIME_SECTION_PRINT_ROS(...) \
-_HECTOR_TIME_SECTION_PRINT_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_PRINT_ROS, _HECTOR_TIME_SECTION_PRINT_ROS_INFO)(__VA_ARGS__)
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_SECTION_PRINT_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_PRINT_ROS, _HECTOR_TIME_SECTION_PRINT_ROS_INFO)(__VA_ARGS__))
 
 #define _HECTOR_TIME_SECTION_END_AND_PRINT_ROS(sectionname, level) \
   __hector_timeit_timer_##sectionname.stop();\
@@ -425,18 +716,31 @@ _HECTOR_TIME_SECTION_PRINT_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_PRINT
  * @param Level (Optional) The level of the output which can be one of the following: DEBUG, INFO, WARN, ERROR. Default: INFO
  */
 #define HECTOR_TIME_SECTION_END_AND_PRINT_ROS(...) \
-_HECTOR_TIME_SECTION_END_AND_PRINT_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_END_AND_PRINT_ROS, _HECTOR_TIME_SECTION_END_AND_PRINT_ROS_INFO)(__VA_ARGS__)
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_SECTION_END_AND_PRINT_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTION_END_AND_PRINT_ROS, _HECTOR_TIME_SECTION_END_AND_PRINT_ROS_INFO)(__VA_ARGS__))
 
 
 /* ******************************************************************** */
 /* *************************** Hector Block *************************** */
 /* ******************************************************************** */
+#define _HECTOR_TIME_BLOCK_WITH(timer_type, name, storage)\
+  static ::hector_timeit::BasicShardedTimer<timer_type> __block_timer_##name(#name, ::hector_timeit::TimerBase::Default,\
+                                                                             true, ::hector_timeit::TimerBase::storage);\
+  static thread_local timer_type &__block_timer_shard_##name = __block_timer_##name.localShard();\
+  ::hector_timeit::BasicTimeBlock<timer_type> __block_timer_handle_##name(__block_timer_shard_##name)
+#define _HECTOR_TIME_BLOCK_WITH_VECTOR(timer_type, name) _HECTOR_TIME_BLOCK_WITH(timer_type, name, VectorStorage)
+#define _HECTOR_TIME_BLOCK_WITH_GET_MACRO(_1, _2, _3, name, ...) name
+#define _HECTOR_TIME_BLOCK(name, storage) _HECTOR_TIME_BLOCK_WITH(::hector_timeit::Timer, name, storage)
+#define _HECTOR_TIME_BLOCK_VECTOR(name) _HECTOR_TIME_BLOCK(name, VectorStorage)
+#define _HECTOR_TIME_BLOCK_GET_MACRO(_1, _2, name, ...) name
 
 /*!
  * @define HECTOR_TIME_BLOCK
  * @brief Times a code block whenever it is executed and prints the result on application exit
  *
- * @b Usage: HECTOR_TIME_BLOCK(Name)
+ * @b Usage: HECTOR_TIME_BLOCK(Name[, Storage])
+ *
+ * The block can be executed by multiple threads at the same time. Each thread records into its own shard of a
+ *  ShardedTimer, hence, timing doesn't require any locks. The shards are merged when the result is printed.
  *
  * Example:
  * @code
@@ -447,9 +751,122 @@ _HECTOR_TIME_SECTION_END_AND_PRINT_ROS_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_SECTI
  * @endcode
  *
  * @param Name The name of the timer. Used for printing the result. Valid characters: "a-zA-Z0-9_"
+ * @param Storage (Optional) How the runs are stored, one of: VectorStorage, HistogramStorage. Use HistogramStorage
+ *  for blocks that are executed very often to keep the memory constant. @b Default: VectorStorage
+ */
+#define HECTOR_TIME_BLOCK(...)\
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_BLOCK_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_BLOCK, _HECTOR_TIME_BLOCK_VECTOR)(__VA_ARGS__))
+
+/*!
+ * @define HECTOR_TIME_BLOCK_WITH
+ * @brief Same as HECTOR_TIME_BLOCK but uses the given timer type.
+ *
+ * @b Usage: HECTOR_TIME_BLOCK_WITH(TimerType, Name[, Storage])
+ *
+ * @b Example: HECTOR_TIME_BLOCK_WITH(::hector_timeit::WallTimer, SomeExecutionBlock);
+ *
+ * @param TimerType The BasicTimer instantiation, e.g., ::hector_timeit::WallTimer. Use a typedef if it contains commas.
+ * @param Name The name of the timer. Used for printing the result. Valid characters: "a-zA-Z0-9_"
+ * @param Storage (Optional) How the runs are stored, one of: VectorStorage, HistogramStorage. @b Default: VectorStorage
+ */
+#define HECTOR_TIME_BLOCK_WITH(...)\
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_BLOCK_WITH_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_BLOCK_WITH, _HECTOR_TIME_BLOCK_WITH_VECTOR)(__VA_ARGS__))
+
+#define _HECTOR_TIME_BLOCK_BUDGET(name, budget, storage)\
+  static ::hector_timeit::ShardedTimer __block_timer_##name(#name, ::hector_timeit::TimerBase::Default,\
+                                                            true, ::hector_timeit::TimerBase::storage);\
+  static const bool __block_budget_##name = (__block_timer_##name.setLatencyBudget(budget), true);\
+  (void)__block_budget_##name;\
+  static thread_local ::hector_timeit::Timer &__block_timer_shard_##name = __block_timer_##name.localShard();\
+  ::hector_timeit::TimeBlock __block_timer_handle_##name(__block_timer_shard_##name)
+#define _HECTOR_TIME_BLOCK_BUDGET_VECTOR(name, budget) _HECTOR_TIME_BLOCK_BUDGET(name, budget, VectorStorage)
+#define _HECTOR_TIME_BLOCK_BUDGET_GET_MACRO(_1, _2, _3, name, ...) name
+
+/*!
+ * @define HECTOR_TIME_BLOCK_BUDGET
+ * @brief Same as HECTOR_TIME_BLOCK but with a latency budget. Runs that exceed the budget are counted, printed with the
+ *  result and pushed to the ::hector_timeit::BudgetViolationQueue::instance() queue.
+ *
+ * @b Usage: HECTOR_TIME_BLOCK_BUDGET(Name, Budget[, Storage])
+ *
+ * @b Example: HECTOR_TIME_BLOCK_BUDGET(ControlLoop, 1000000); // 1ms
+ *
+ * @param Name The name of the timer. Used for printing the result. Valid characters: "a-zA-Z0-9_"
+ * @param Budget The latency budget in nanoseconds.
+ * @param Storage (Optional) How the runs are stored, one of: VectorStorage, HistogramStorage. @b Default: VectorStorage
+ */
+#define HECTOR_TIME_BLOCK_BUDGET(...)\
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_BLOCK_BUDGET_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_BLOCK_BUDGET, _HECTOR_TIME_BLOCK_BUDGET_VECTOR)(__VA_ARGS__))
+
+#define _HECTOR_TIME_BLOCK_SAMPLED_WITH(timer_type, name, period, mode)\
+  static ::hector_timeit::BasicShardedTimer<timer_type> __block_timer_##name(#name, ::hector_timeit::TimerBase::Default,\
+                                                                             true, ::hector_timeit::TimerBase::HistogramStorage,\
+                                                                             period);\
+  static thread_local timer_type &__block_timer_shard_##name = __block_timer_##name.localShard();\
+  static thread_local ::hector_timeit::Sampler __block_sampler_##name(period, ::hector_timeit::Sampler::mode);\
+  ::hector_timeit::BasicSampledTimeBlock<timer_type> __block_timer_handle_##name(__block_timer_shard_##name,\
+                                                                                 __block_sampler_##name)
+#define _HECTOR_TIME_BLOCK_SAMPLED_WITH_EVERY_NTH(timer_type, name, period)\
+  _HECTOR_TIME_BLOCK_SAMPLED_WITH(timer_type, name, period, EveryNth)
+#define _HECTOR_TIME_BLOCK_SAMPLED_WITH_GET_MACRO(_1, _2, _3, _4, name, ...) name
+#define _HECTOR_TIME_BLOCK_SAMPLED(name, period, mode) _HECTOR_TIME_BLOCK_SAMPLED_WITH(::hector_timeit::Timer, name, period, mode)
+#define _HECTOR_TIME_BLOCK_SAMPLED_EVERY_NTH(name, period) _HECTOR_TIME_BLOCK_SAMPLED(name, period, EveryNth)
+#define _HECTOR_TIME_BLOCK_SAMPLED_GET_MACRO(_1, _2, _3, name, ...) name
+
+/*!
+ * @define HECTOR_TIME_BLOCK_SAMPLED
+ * @brief Same as HECTOR_TIME_BLOCK but only times 1 in Period executions of the block.
+ *
+ * @b Usage: HECTOR_TIME_BLOCK_SAMPLED(Name, Period[, Mode])
+ *
+ * Skipped executions only decrement a thread local counter. The runs are stored in a histogram, so the memory stays
+ *  constant and the block can stay instrumented in production builds. The printed run count and sum are extrapolated
+ *  from the timed executions, the other statistics are those of the timed executions.
+ *
+ * @b Example: HECTOR_TIME_BLOCK_SAMPLED(HotFunction, 100, Random);
+ *
+ * @param Name The name of the timer. Used for printing the result. Valid characters: "a-zA-Z0-9_"
+ * @param Period On average, 1 in Period executions is timed.
+ * @param Mode (Optional) How the timed executions are chosen, one of: EveryNth, Random. See Sampler::Mode.
+ *  @b Default: EveryNth
+ */
+#define HECTOR_TIME_BLOCK_SAMPLED(...)\
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_BLOCK_SAMPLED_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_BLOCK_SAMPLED, _HECTOR_TIME_BLOCK_SAMPLED_EVERY_NTH)(__VA_ARGS__))
+
+/*!
+ * @define HECTOR_TIME_BLOCK_SAMPLED_WITH
+ * @brief Same as HECTOR_TIME_BLOCK_SAMPLED but uses the given timer type.
+ *
+ * @b Usage: HECTOR_TIME_BLOCK_SAMPLED_WITH(TimerType, Name, Period[, Mode])
+ *
+ * @param TimerType The BasicTimer instantiation, e.g., ::hector_timeit::WallTimer. Use a typedef if it contains commas.
+ * @param Name The name of the timer. Used for printing the result. Valid characters: "a-zA-Z0-9_"
+ * @param Period On average, 1 in Period executions is timed.
+ * @param Mode (Optional) How the timed executions are chosen, one of: EveryNth, Random. @b Default: EveryNth
+ */
+#define HECTOR_TIME_BLOCK_SAMPLED_WITH(...)\
+_HECTOR_TIMEIT_LEVEL_ESSENTIAL(_HECTOR_TIME_BLOCK_SAMPLED_WITH_GET_MACRO(__VA_ARGS__, _HECTOR_TIME_BLOCK_SAMPLED_WITH, _HECTOR_TIME_BLOCK_SAMPLED_WITH_EVERY_NTH)(__VA_ARGS__))
+
+/*!
+ * @define HECTOR_TIME_SCOPE
+ * @brief Times the enclosing block as a scope of the ScopeProfiler.
+ * Nested scopes form a call tree per thread which reports the inclusive and self time, the number of calls and the
+ *  percentage of the parent scope. The trees of all threads are merged and printed on application exit.
+ * The name is interned once per call site and the tree of the thread is cached, hence, entering a scope only looks up
+ *  the node in a flat hash table and reads the clock.
+ *
+ * @b Usage: HECTOR_TIME_SCOPE(Name)
+ *
+ * @b Example: HECTOR_TIME_SCOPE(Update);
+ *
+ * @param Name The name of the scope. Scopes with the same name in the same parent share a node.
+ *  Valid characters: "a-zA-Z0-9_"
  */
-#define HECTOR_TIME_BLOCK(name)\
-  static ::hector_timeit::Timer __block_timer_##name(#name, ::hector_timeit::Timer::Default, false, true);\
-  ::hector_timeit::TimeBlock __block_timer_handle_##name(__block_timer_##name)
+#define HECTOR_TIME_SCOPE(name)\
+  _HECTOR_TIMEIT_LEVEL_ESSENTIAL(\
+  static const ::hector_timeit::ScopeId __scope_id_##name = ::hector_timeit::ScopeProfiler::instance().intern(#name);\
+  static thread_local ::hector_timeit::ScopeTree &__scope_tree_##name =\
+    ::hector_timeit::ScopeProfiler::instance().threadTree();\
+  ::hector_timeit::ScopeGuard __scope_guard_##name(__scope_tree_##name, __scope_id_##name))
 
 #endif //HECTOR_TIMEIT_MACROS_H
@@ -0,0 +1,151 @@
+#ifndef HECTOR_TIMEIT_NAME_REGISTRY_H
+#define HECTOR_TIMEIT_NAME_REGISTRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace hector_timeit
+{
+
+//! Interned id of a name. See NameRegistry::intern.
+typedef uint32_t NameId;
+
+/*!
+ * Process-wide registry that maps the names of timers and scopes to small integer ids, so recording code only has to
+ *  store and compare integers.
+ */
+class NameRegistry
+{
+public:
+  static constexpr NameId InvalidName = 0xFFFFFFFF;
+
+  static NameRegistry &instance();
+
+  /*!
+   * @return The id of the given name. The same name always returns the same id. Takes a lock, so cache the id.
+   */
+  NameId intern( const std::string &name );
+
+  /*!
+   * @return The name with the given id or "unknown" if the id is invalid. The reference stays valid for the lifetime of
+   *  the process since names are never removed. Lock-free.
+   */
+  const std::string &name( NameId id ) const;
+
+  /*!
+   * @return The number of interned names. The ids are in the range [0, size()).
+   */
+  size_t size() const;
+
+private:
+  NameRegistry() = default;
+
+  ~NameRegistry();
+
+  static constexpr size_t FirstChunkSize = 64;
+  //! Chunk i holds FirstChunkSize << i names, so the chunks cover all ids.
+  static constexpr size_t ChunkCount = 27;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, NameId> ids_;
+  // The names are stored in chunks that are never moved or freed while the registry exists. A chunk is allocated and
+  //  the name is constructed before size_ is published, hence, readers only need to load size_.
+  std::string *chunks_[ChunkCount] = {};
+  std::atomic<size_t> size_{ 0 };
+};
+
+namespace detail
+{
+constexpr const char *basename( const char *path, const char *last )
+{
+  return *path == '\0' ? last : basename( path + 1, (*path == '/' || *path == '\\') ? path + 1 : last );
+}
+
+//! @return The part of the path after the last path separator. Evaluated at compile time for string literals.
+constexpr const char *basename( const char *path ) { return basename( path, path ); }
+}
+
+/*!
+ * Name that is known at compile time, e.g., a string literal or the file and line of a macro.
+ * Descriptors are meant to be static, see HECTOR_TIMEIT_STATIC_NAME. Since the constructors are constexpr, a static
+ *  descriptor is initialized at compile time. The name is interned in the NameRegistry the first time its id is
+ *  requested and afterwards, the id is a single atomic load. Hence, creating a timer with a descriptor requires neither
+ *  allocations nor string operations.
+ */
+class NameDescriptor
+{
+public:
+  constexpr explicit NameDescriptor( const char *name ) : prefix_( "" ), name_( name ), line_( -1 ) { }
+
+  /*!
+   * The name is "<prefix><file>:<line>".
+   * @param prefix A string literal that is prepended.
+   * @param file The file name, usually detail::basename( __FILE__ ).
+   * @param line The line, usually __LINE__.
+   */
+  constexpr NameDescriptor( const char *prefix, const char *file, int line )
+    : prefix_( prefix ), name_( file ), line_( line ) { }
+
+  NameDescriptor( const NameDescriptor & ) = delete;
+
+  NameDescriptor &operator=( const NameDescriptor & ) = delete;
+
+  //! @return The stable id of this name in the NameRegistry.
+  inline NameId id() const
+  {
+    NameId id = id_.load( std::memory_order_acquire );
+    return id != NameRegistry::InvalidName ? id : resolve();
+  }
+
+  const std::string &name() const { return NameRegistry::instance().name( id()); }
+
+  //! Allows passing descriptors wherever a name string is expected.
+  operator const std::string &() const { return name(); }
+
+private:
+  NameId resolve() const;
+
+  const char *prefix_;
+  const char *name_;
+  int line_;
+  mutable std::atomic<NameId> id_{ NameRegistry::InvalidName };
+};
+
+namespace detail
+{
+/*!
+ * Caches the id of the name passed at a macro call site, see _HECTOR_TIMEIT_CALL_SITE_NAME.
+ * Const char arrays, i.e., string literals, are interned on the first call and afterwards, the cached id is returned.
+ * All other names, e.g., std::string expressions, may change between calls and are passed through unchanged, so the
+ *  timer interns them on every call.
+ */
+class CallSiteName
+{
+public:
+  template<size_t N>
+  NameId operator()( const char (&name)[N] )
+  {
+    NameId id = id_.load( std::memory_order_acquire );
+    if ( id != NameRegistry::InvalidName ) return id;
+    id = NameRegistry::instance().intern( name );
+    id_.store( id, std::memory_order_release );
+    return id;
+  }
+
+  //! Mutable buffers may hold a different name on every call.
+  template<size_t N>
+  const char *operator()( char (&name)[N] ) { return name; }
+
+  template<typename T>
+  const T &operator()( const T &name ) { return name; }
+
+private:
+  std::atomic<NameId> id_{ NameRegistry::InvalidName };
+};
+}
+}
+
+#endif //HECTOR_TIMEIT_NAME_REGISTRY_H
@@ -0,0 +1,116 @@
+#ifndef HECTOR_TIMEIT_PERF_COUNTERS_H
+#define HECTOR_TIMEIT_PERF_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hector_timeit
+{
+
+/*!
+ * Values of the hardware performance counters measured by the PerfCounters policy.
+ */
+struct CounterValues
+{
+  enum Counter
+  {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+    CounterCount
+  };
+
+  uint64_t values[CounterCount];
+
+  CounterValues() : values() { }
+
+  uint64_t operator[]( Counter counter ) const { return values[counter]; }
+
+  CounterValues &operator+=( const CounterValues &other )
+  {
+    for ( int i = 0; i < CounterCount; ++i ) values[i] += other.values[i];
+    return *this;
+  }
+
+  static const char *name( Counter counter );
+};
+
+/*!
+ * The hardware performance counters of the calling thread opened as one group using perf_event_open, so all counters
+ *  are scheduled at the same time. Only user space events are counted.
+ * If the kernel allows user space access to the counters (cap_user_rdpmc, usually the case if perf_event_paranoid is
+ *  at most 2), the counters are read using rdpmc without a system call. Otherwise, they are read using read().
+ * Counters that aren't supported by the CPU are not opened and stay 0.
+ */
+class PerfCounterGroup
+{
+public:
+  /*!
+   * Returns the group of the calling thread. The counters are opened on the first call from a thread.
+   */
+  static PerfCounterGroup &threadGroup();
+
+  ~PerfCounterGroup();
+
+  PerfCounterGroup( const PerfCounterGroup & ) = delete;
+
+  PerfCounterGroup &operator=( const PerfCounterGroup & ) = delete;
+
+  /*!
+   * @return Whether at least one counter could be opened. False, e.g., if perf_event_paranoid forbids counting or the
+   *  system has no performance monitoring unit as in most virtual machines.
+   */
+  bool isOpen() const { return leader_ != -1; }
+
+  /*!
+   * @return Whether the given counter is supported and opened.
+   */
+  bool isAvailable( CounterValues::Counter counter ) const { return fds_[counter] != -1; }
+
+  /*!
+   * @return Whether the counters are read using rdpmc without a system call.
+   */
+  bool usesRdpmc() const { return rdpmc_; }
+
+  /*!
+   * Reads the current values of the counters.
+   * @return True if successful, false if the counters are not open or could not be read.
+   */
+  bool read( CounterValues &values ) const;
+
+private:
+  PerfCounterGroup();
+
+  bool readSlow( CounterValues &values ) const;
+
+  int fds_[CounterValues::CounterCount];
+  void *pages_[CounterValues::CounterCount];
+  int leader_ = -1;
+  bool rdpmc_ = false;
+};
+
+/*!
+ * Counter policy of the BasicTimer that doesn't measure any counters.
+ */
+struct NoCounters
+{
+  static constexpr bool enabled = false;
+
+  static inline bool read( CounterValues & ) { return false; }
+};
+
+/*!
+ * Counter policy of the BasicTimer that measures the hardware performance counters of the calling thread.
+ * If the counters can not be opened, e.g., because the kernel forbids it, the timer only measures the time.
+ */
+struct PerfCounters
+{
+  static constexpr bool enabled = true;
+
+  static inline bool read( CounterValues &values ) { return PerfCounterGroup::threadGroup().read( values ); }
+};
+}
+
+#endif //HECTOR_TIMEIT_PERF_COUNTERS_H
@@ -0,0 +1,100 @@
+#ifndef HECTOR_TIMEIT_ROLLING_WINDOW_H
+#define HECTOR_TIMEIT_ROLLING_WINDOW_H
+
+#include "hector_timeit/run_statistics.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * Statistics of the most recent runs, either of the last N nanoseconds or of the last N runs.
+ * The window is split into a ring of intervals that each aggregate the statistics of their runs. Adding a run updates
+ *  the statistics of the current interval and the oldest interval is cleared and reused once the window moved past it,
+ *  hence, adding is O(1) and the memory is constant. The statistics of the window are merged from the intervals.
+ *
+ * Since whole intervals expire at once, the window covers between window * (intervals - 1) / intervals and window.
+ *  More intervals make the window more precise at the cost of memory and merging time.
+ */
+class RollingWindow
+{
+public:
+  enum Mode
+  {
+    //! The window covers the runs that finished in the last N nanoseconds.
+    Time = 0,
+    //! The window covers the last N runs.
+    Runs = 1
+  };
+
+  static constexpr size_t DefaultIntervals = 10;
+
+  //! Constructs a disabled window that ignores all runs.
+  RollingWindow() = default;
+
+  /*!
+   * @param mode Whether the window is measured in nanoseconds or in runs.
+   * @param window The length of the window in nanoseconds or runs depending on the mode.
+   * @param intervals The number of intervals the window is split into. Clamped to [1, window].
+   */
+  RollingWindow( Mode mode, long long window, size_t intervals = DefaultIntervals );
+
+  //! @return A window over the runs of the last seconds.
+  static RollingWindow lastSeconds( double seconds, size_t intervals = DefaultIntervals );
+
+  //! @return A window over the last runs.
+  static RollingWindow lastRuns( long long runs, size_t intervals = DefaultIntervals );
+
+  bool enabled() const { return !intervals_.empty(); }
+
+  Mode mode() const { return mode_; }
+
+  //! @return The length of the window in nanoseconds or runs depending on the mode.
+  long long window() const { return interval_length_ * static_cast<long long>(intervals_.size()); }
+
+  /*!
+   * Adds a run.
+   * @param time The time of the run in nanoseconds or -1 if the time is invalid.
+   * @param now The current time in nanoseconds of a monotonic clock. Only used in Time mode.
+   */
+  inline void add( long time, long long now )
+  {
+    if ( intervals_.empty()) return;
+    long long index = mode_ == Time ? now / interval_length_ : runs_++ / interval_length_;
+    Interval &interval = intervals_[static_cast<size_t>(index % static_cast<long long>(intervals_.size()))];
+    if ( interval.index != index )
+    {
+      interval.index = index;
+      interval.statistics = RunStatistics();
+    }
+    interval.statistics.add( time );
+    if ( index > latest_ ) latest_ = index;
+  }
+
+  /*!
+   * @param now The current time in nanoseconds of the clock passed to add. Only used in Time mode.
+   * @return The statistics of the runs in the window.
+   */
+  RunStatistics statistics( long long now ) const;
+
+  //! Removes all runs.
+  void clear();
+
+private:
+  struct Interval
+  {
+    long long index = -1;
+    RunStatistics statistics;
+  };
+
+  std::vector<Interval> intervals_;
+  long long interval_length_ = 1;
+  long long runs_ = 0;
+  long long latest_ = -1;
+  Mode mode_ = Time;
+};
+}
+
+#endif //HECTOR_TIMEIT_ROLLING_WINDOW_H
@@ -0,0 +1,84 @@
+#ifndef HECTOR_TIMEIT_RUN_STATISTICS_H
+#define HECTOR_TIMEIT_RUN_STATISTICS_H
+
+#include <cstddef>
+#include <vector>
+
+namespace hector_timeit
+{
+class Histogram;
+
+/*!
+ * Summary statistics of a set of runs as printed by the Timer.
+ * Runs with a time of -1 are invalid, e.g., because the cpu time could not be obtained, and are only counted in
+ *  total_count.
+ */
+struct RunStatistics
+{
+  //! Number of runs with a valid time.
+  size_t count = 0;
+  //! Number of runs including the ones without a valid time.
+  size_t total_count = 0;
+  long long sum = 0;
+  long min = 0;
+  long max = 0;
+  double mean = 0;
+  //! Sample variance of the valid runs.
+  double variance = 0;
+
+  static RunStatistics fromRunTimes( const std::vector<long> &run_times );
+
+  /*!
+   * Adds a single run.
+   * @param time The time of the run in nanoseconds or -1 if the time is invalid.
+   */
+  void add( long time );
+
+  /*!
+   * Merges the statistics of another set of runs into this one.
+   */
+  void merge( const RunStatistics &other );
+};
+
+/*!
+ * The tail latency percentiles printed by the Timer. Percentiles use the nearest-rank definition, i.e., the
+ *  p-th percentile is the smallest run time such that at least p percent of the valid runs are less or equal.
+ * All values are -1 if there are no valid runs.
+ */
+struct RunPercentiles
+{
+  long p50 = -1;
+  long p90 = -1;
+  long p99 = -1;
+  long p999 = -1;
+
+  /*!
+   * Computes the percentiles using selection (std::nth_element) on a copy of the valid run times.
+   */
+  static RunPercentiles fromRunTimes( const std::vector<long> &run_times );
+
+  /*!
+   * Same as fromRunTimes but removes the invalid runs from the given run times and reorders them instead of copying.
+   */
+  static RunPercentiles fromRunTimesInPlace( std::vector<long> &run_times );
+
+  /*!
+   * Computes the percentiles from the buckets of the histogram. The error is bounded by the histogram's precision.
+   */
+  static RunPercentiles fromHistogram( const Histogram &histogram );
+
+  /*!
+   * @param run_times The run times. Invalid runs (-1) are ignored.
+   * @param percentile The percentile in the range [0, 100].
+   * @return The given percentile of the valid run times or -1 if there are no valid runs.
+   */
+  static long percentile( const std::vector<long> &run_times, double percentile );
+
+  /*!
+   * @return The zero based index of the given percentile in the sorted values using the nearest-rank definition.
+   */
+  static size_t rank( size_t count, double percentile );
+};
+}
+
+#endif //HECTOR_TIMEIT_RUN_STATISTICS_H
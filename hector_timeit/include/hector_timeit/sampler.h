@@ -0,0 +1,60 @@
+#ifndef HECTOR_TIMEIT_SAMPLER_H
+#define HECTOR_TIMEIT_SAMPLER_H
+
+#include <cstdint>
+
+namespace hector_timeit
+{
+
+/*!
+ * Decides which executions of a code block are timed if only 1 in period executions should be measured.
+ * Not thread-safe, every thread needs its own sampler, e.g., a thread_local variable as used by the
+ *  HECTOR_TIME_BLOCK_SAMPLED macro. Skipping an execution only decrements a counter.
+ */
+class Sampler
+{
+public:
+  enum Mode
+  {
+    //! Times the first and then every period-th execution.
+    EveryNth,
+    /*!
+     * Times each execution with a probability of 1 / period. The gaps between the timed executions are drawn from a
+     *  geometric distribution, so the skip path stays a decrement. Use this mode if the block is executed in a pattern
+     *  that could alias with a fixed period.
+     */
+    Random
+  };
+
+  /*!
+   * @param period On average, 1 in period executions is timed. A period of 0 or 1 times every execution.
+   * @param mode How the timed executions are chosen.
+   */
+  explicit Sampler( unsigned period, Mode mode = EveryNth );
+
+  /*!
+   * @return True if the current execution should be timed.
+   */
+  inline bool sample()
+  {
+    if ( --countdown_ != 0 ) return false;
+    countdown_ = nextCountdown();
+    return true;
+  }
+
+  unsigned period() const { return period_; }
+
+  Mode mode() const { return mode_; }
+
+private:
+  unsigned nextCountdown();
+
+  unsigned countdown_;
+  unsigned period_;
+  Mode mode_;
+  double log_skip_probability_ = 0;
+  uint64_t state_;
+};
+}
+
+#endif //HECTOR_TIMEIT_SAMPLER_H
@@ -0,0 +1,237 @@
+#ifndef HECTOR_TIMEIT_SCOPE_PROFILER_H
+#define HECTOR_TIMEIT_SCOPE_PROFILER_H
+
+#include "hector_timeit/clocks.h"
+#include "hector_timeit/name_registry.h"
+#include "hector_timeit/timer.h"
+#include "hector_timeit/trace.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hector_timeit
+{
+
+//! Interned id of a scope name. Scopes share their ids with the NameRegistry.
+typedef NameId ScopeId;
+
+/*!
+ * Call tree of the scopes entered by a single thread.
+ * Every node is a scope in the context of its parent scope, hence, the same scope called from two different parents
+ *  has two nodes. The children of a node are found using an open-addressing hash table keyed by the parent node and
+ *  the interned scope id. Therefore, entering a scope never hashes or compares strings and only allocates the first
+ *  time a scope is entered from a parent.
+ *
+ * A ScopeTree must only be modified by a single thread.
+ */
+class ScopeTree
+{
+public:
+  struct Node
+  {
+    ScopeId scope;
+    uint32_t parent;
+    //! Sum of the time spent in this scope including its children in nanoseconds.
+    long long inclusive_time;
+    //! How often the scope was exited.
+    size_t count;
+  };
+
+  //! Index of the root node which has no scope and is the parent of all top level scopes.
+  static constexpr uint32_t Root = 0;
+  static constexpr uint32_t InvalidNode = 0xFFFFFFFF;
+
+  ScopeTree();
+
+  /*!
+   * Enters the given scope as child of the current scope and starts timing it.
+   */
+  inline void enter( ScopeId scope )
+  {
+    uint32_t node = findOrInsertChild( stack_.back().node, scope );
+    Tracer::record( scope, TraceEvent::Begin );
+    stack_.push_back( Frame{ node, WallClock::now() } );
+  }
+
+  /*!
+   * Stops timing the current scope, adds the time to its node and returns to the parent scope.
+   */
+  inline void exit()
+  {
+    WallClock::time_point end = WallClock::now();
+    const Frame &frame = stack_.back();
+    Node &node = nodes_[frame.node];
+    node.inclusive_time += std::chrono::duration_cast<std::chrono::nanoseconds>( end - frame.start ).count();
+    ++node.count;
+    stack_.pop_back();
+    Tracer::record( node.scope, TraceEvent::End );
+  }
+
+  /*!
+   * @return The number of currently entered scopes.
+   */
+  size_t depth() const { return stack_.size() - 1; }
+
+  /*!
+   * The nodes of the tree. The root is at index Root and every node is stored after its parent.
+   * Scopes that are currently entered are not included in the times and counts until they are exited.
+   */
+  const std::vector<Node> &nodes() const { return nodes_; }
+
+  /*!
+   * @return The index of the node of the given scope in the given parent or InvalidNode if the scope was never entered
+   *  from that parent.
+   */
+  inline uint32_t findChild( uint32_t parent, ScopeId scope ) const
+  {
+    uint64_t key = makeKey( parent, scope );
+    for ( size_t slot = hash( key ) & mask_;; slot = (slot + 1) & mask_ )
+    {
+      if ( keys_[slot] == key ) return values_[slot];
+      if ( keys_[slot] == EmptyKey ) return InvalidNode;
+    }
+  }
+
+  /*!
+   * @return The time spent in the given node excluding the time spent in its children in nanoseconds.
+   */
+  long long selfTime( uint32_t node ) const;
+
+  /*!
+   * Adds the times and counts of other to the nodes of this tree with the same path of scopes.
+   */
+  void merge( const ScopeTree &other );
+
+private:
+  struct Frame
+  {
+    uint32_t node;
+    WallClock::time_point start;
+  };
+
+  static constexpr uint64_t EmptyKey = ~0ULL;
+
+  static inline uint64_t makeKey( uint32_t parent, ScopeId scope )
+  {
+    return (static_cast<uint64_t>(parent) << 32) | scope;
+  }
+
+  static inline size_t hash( uint64_t key )
+  {
+    // Fibonacci hashing, the high bits are well mixed
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32);
+  }
+
+  inline uint32_t findOrInsertChild( uint32_t parent, ScopeId scope )
+  {
+    uint32_t node = findChild( parent, scope );
+    if ( node != InvalidNode ) return node;
+    return insertChild( parent, scope );
+  }
+
+  uint32_t insertChild( uint32_t parent, ScopeId scope );
+
+  void rehash( size_t capacity );
+
+  std::vector<Node> nodes_;
+  std::vector<Frame> stack_;
+  std::vector<uint64_t> keys_;
+  std::vector<uint32_t> values_;
+  size_t mask_ = 0;
+};
+
+/*!
+ * Process-wide registry of the scope names and the call trees of all threads.
+ * Scope names are interned once per call site, and every thread records into its own ScopeTree without any locks.
+ * The report merges the trees of all threads.
+ *
+ * Like the ShardedTimer, the trees are read without synchronization. Hence, reports should only be created when no
+ *  other thread is entering or exiting scopes, e.g., after they were joined or on application exit.
+ */
+class ScopeProfiler
+{
+public:
+  static ScopeProfiler &instance();
+
+  ~ScopeProfiler();
+
+  /*!
+   * @return The id of the given scope name. The same name always returns the same id. Takes a lock, so cache the id.
+   */
+  ScopeId intern( const std::string &name ) { return NameRegistry::instance().intern( name ); }
+
+  /*!
+   * @return The name of the scope with the given id.
+   */
+  std::string scopeName( ScopeId scope ) const { return NameRegistry::instance().name( scope ); }
+
+  /*!
+   * Returns the tree of the calling thread and registers it on the first call. Takes a lock, so cache the reference.
+   */
+  ScopeTree &threadTree();
+
+  /*!
+   * @return The number of threads that registered a tree.
+   */
+  size_t threadCount() const;
+
+  /*!
+   * @return The trees of all threads merged into a single tree.
+   */
+  ScopeTree mergedTree() const;
+
+  /*!
+   * Formats the given tree as table with one row per node in depth-first order. Children are sorted by their
+   *  inclusive time in descending order. The percentage is relative to the inclusive time of the parent or, for top
+   *  level scopes, the sum of all top level scopes.
+   */
+  std::string toString( const ScopeTree &tree, TimerBase::TimeUnit print_time_unit = TimerBase::Default ) const;
+
+  /*!
+   * @return The report of the merged trees of all threads.
+   */
+  std::string toString() const;
+
+  /*!
+   * @param value If true (default), the report is printed to std::cout on application exit if any scope was recorded.
+   */
+  void setPrintOnExit( bool value ) { print_on_exit_ = value; }
+
+private:
+  ScopeProfiler();
+
+  struct ThreadTree
+  {
+    std::thread::id thread_id;
+    std::unique_ptr<ScopeTree> tree;
+  };
+
+  mutable std::mutex mutex_;
+  std::vector<ThreadTree> trees_;
+  bool print_on_exit_ = true;
+};
+
+/*!
+ * Enters a scope on construction and exits it on destruction.
+ */
+struct ScopeGuard
+{
+  ScopeGuard( ScopeTree &tree, ScopeId scope ) : tree( tree ) { tree.enter( scope ); }
+
+  ~ScopeGuard() { tree.exit(); }
+
+  ScopeGuard( const ScopeGuard & ) = delete;
+
+  ScopeGuard &operator=( const ScopeGuard & ) = delete;
+
+  ScopeTree &tree;
+};
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ScopeProfiler &profiler );
+
+#endif //HECTOR_TIMEIT_SCOPE_PROFILER_H
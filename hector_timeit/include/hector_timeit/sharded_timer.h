@@ -0,0 +1,193 @@
+#ifndef HECTOR_TIMEIT_SHARDED_TIMER_H
+#define HECTOR_TIMEIT_SHARDED_TIMER_H
+
+#include "hector_timeit/timer.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * The part of the sharded timer that does not depend on the type of the shards, i.e., registering and merging the
+ *  shards. See BasicShardedTimer.
+ */
+class ShardedTimerBase
+{
+public:
+  ~ShardedTimerBase();
+
+  const std::string &name() const { return name_; }
+
+  /*!
+   * @return The number of threads that recorded into this timer.
+   */
+  size_t shardCount() const;
+
+  /*!
+   * @return The run times of all shards in nanoseconds. The runs of one shard are in order but the shards are not
+   *  interleaved by time.
+   */
+  std::vector<long> getRunTimes() const;
+
+  /*!
+   * @return The cpu or thread times of all shards in nanoseconds in the same order as getRunTimes().
+   */
+  std::vector<long> getCpuRunTimes() const;
+
+  /*!
+   * @return The run statistics merged over all shards.
+   */
+  RunStatistics getRunStatistics() const;
+
+  /*!
+   * @return The cpu or thread run statistics merged over all shards.
+   */
+  RunStatistics getCpuRunStatistics() const;
+
+  /*!
+   * @return The run percentiles over all shards. See TimerBase::getPercentile.
+   */
+  RunPercentiles getRunPercentiles() const;
+
+  /*!
+   * @return The cpu or thread run percentiles over all shards. See TimerBase::getPercentile.
+   */
+  RunPercentiles getCpuRunPercentiles() const;
+
+  /*!
+   * @param percentile The percentile in the range [0, 100], e.g., 99.9.
+   * @return The percentile of the run times over all shards in nanoseconds or -1 if there are no valid runs.
+   */
+  long getPercentile( double percentile ) const;
+
+  /*!
+   * @return The live statistics merged over all shards. Unlike the other getters, this method can be called while
+   *  the shards are used. See TimerBase::liveSnapshot.
+   */
+  LiveSnapshot liveSnapshot() const;
+
+  //! Enables the LiveHistogram of all current and future shards. See TimerBase::enableLiveHistogram.
+  void enableLiveHistogram();
+
+  //! Adds the LiveHistogram bucket counts of all shards to the given counts. See TimerBase::liveHistogram.
+  bool liveHistogram( std::vector<uint64_t> &counts ) const;
+
+  /*!
+   * See TimerBase::setSamplePeriod.
+   */
+  void setSamplePeriod( unsigned period ) { sample_period_ = period < 1 ? 1 : period; }
+
+  unsigned samplePeriod() const { return sample_period_; }
+
+  /*!
+   * Sets the latency budget of all current and future shards. See TimerBase::setLatencyBudget.
+   * Should be set before the threads start timing, e.g., right after the construction.
+   * @param callback (Optional) Called by the timing thread for each violation. Shared by all shards, so it has to be
+   *  thread-safe.
+   */
+  void setLatencyBudget( long budget, BudgetCallback callback = BudgetCallback());
+
+  //! @return The number of runs of all shards that exceeded the latency budget.
+  size_t budgetViolations() const;
+
+  /*!
+   * Sets the rolling window of all current and future shards. See TimerBase::setRollingWindow.
+   * Should be set before the threads start timing, e.g., right after the construction.
+   */
+  void setRollingWindow( const RollingWindow &window );
+
+  //! @return The statistics of the rolling windows merged over all shards.
+  RunStatistics getWindowStatistics() const;
+
+  std::string toString() const;
+
+protected:
+  typedef TimerBase *(*ShardFactory)( const std::string &name, TimerBase::TimeUnit print_time_unit,
+                                      TimerBase::RunStorage run_storage );
+
+  ShardedTimerBase( std::string name, TimerBase::TimeUnit print_time_unit, bool print_on_destruct,
+                    TimerBase::RunStorage run_storage, unsigned sample_period );
+
+  /*!
+   * Returns the shard of the calling thread or creates it using the factory if the thread has no shard yet.
+   */
+  TimerBase &internalLocalShard( ShardFactory factory );
+
+private:
+  Histogram mergeHistograms( bool cpu ) const;
+
+  struct Shard
+  {
+    std::thread::id thread_id;
+    std::unique_ptr<TimerBase> timer;
+  };
+
+  mutable std::mutex shards_mutex_;
+  std::vector<Shard> shards_;
+  std::string name_;
+  TimerBase::TimeUnit print_time_unit_;
+  TimerBase::RunStorage run_storage_;
+  long latency_budget_ = TimerBase::NoBudget;
+  BudgetCallback budget_callback_;
+  RollingWindow rolling_window_;
+  bool live_histogram_ = false;
+  unsigned sample_period_;
+  bool print_on_destruct_;
+};
+
+/*!
+ * Timer that is shared between multiple threads.
+ * Every thread records into its own timer (shard) which is only ever accessed by that thread. Hence, starting and
+ *  stopping does not require any locks or atomics. The shards are registered in a list and merged when the
+ *  results are read or printed.
+ *
+ * Reading the results accesses the shards without synchronization. Therefore, results should only be read when the
+ *  recording threads are not timing at the same time, e.g., after they were joined or on application exit.
+ *
+ * @tparam TimerT The type of the shards, e.g., Timer or any other BasicTimer instantiation.
+ */
+template<typename TimerT>
+class BasicShardedTimer : public ShardedTimerBase
+{
+public:
+  /*!
+   * Constructs a new ShardedTimer instance.
+   * @param name The name of the timer. Used for printing in the toString method and stream operator.
+   * @param print_time_unit The time unit used for printing. If Default the time unit is automatically chosen.
+   * @param print_on_destruct If true, prints the merged results of all shards when the ShardedTimer is destructed.
+   * @param run_storage How the shards store their runs. See TimerBase::RunStorage.
+   * @param sample_period If only 1 in sample_period executions is timed. See setSamplePeriod.
+   */
+  explicit BasicShardedTimer( std::string name, TimerBase::TimeUnit print_time_unit = TimerBase::Default,
+                              bool print_on_destruct = false,
+                              TimerBase::RunStorage run_storage = TimerBase::VectorStorage,
+                              unsigned sample_period = 1 )
+    : ShardedTimerBase( std::move( name ), print_time_unit, print_on_destruct, run_storage, sample_period ) { }
+
+  /*!
+   * Returns the shard of the calling thread. The shard is created and registered on the first call from a thread.
+   * Since this requires a lock, the returned reference should be cached by the caller, e.g., in a thread_local
+   *  variable as done by the HECTOR_TIME_BLOCK macro.
+   * @return The timer that should only be used by the calling thread.
+   */
+  TimerT &localShard() { return static_cast<TimerT &>(internalLocalShard( &createShard )); }
+
+private:
+  static TimerBase *createShard( const std::string &name, TimerBase::TimeUnit print_time_unit,
+                                 TimerBase::RunStorage run_storage )
+  {
+    return new TimerT( name, print_time_unit, false, false, run_storage );
+  }
+};
+
+typedef BasicShardedTimer<Timer> ShardedTimer;
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ShardedTimerBase &timer );
+
+#endif //HECTOR_TIMEIT_SHARDED_TIMER_H
@@ -0,0 +1,200 @@
+#ifndef HECTOR_TIMEIT_SHARED_MEMORY_H
+#define HECTOR_TIMEIT_SHARED_MEMORY_H
+
+#include "hector_timeit/live_reporter.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace hector_timeit
+{
+
+/*!
+ * Layout of the shared memory segment written by the SharedMemoryExporter. The segment starts with the header followed
+ *  by header.capacity entries. All fields have fixed sizes, so readers compiled separately agree on the layout, and
+ *  readers have to check the magic and version before reading anything else.
+ *
+ * The single writer, the exporter thread, protects the entries with a sequence lock: The sequence is odd while the
+ *  entries are updated. Readers copy the entries and retry if the sequence was odd or changed in the meantime.
+ */
+namespace shared_memory
+{
+constexpr char Magic[8] = { 'H', 'T', 'L', 'I', 'V', 'E', '\0', '\0' };
+constexpr uint32_t Version = 2;
+constexpr size_t NameLength = 96;
+constexpr uint32_t DefaultCapacity = 512;
+
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t entry_size;
+  //! The number of entries the segment has space for.
+  uint32_t capacity;
+  int64_t pid;
+  //! The export period in nanoseconds.
+  int64_t period;
+  std::atomic<uint64_t> sequence;
+  //! The number of valid entries.
+  uint32_t entry_count;
+  //! The number of registered timers. Larger than entry_count if they did not fit into the segment.
+  uint32_t timer_count;
+  //! The time of the last update in nanoseconds since the epoch of the steady clock.
+  int64_t update_time;
+};
+
+struct Entry
+{
+  //! The name of the timer, null terminated and truncated to NameLength - 1 characters.
+  char name[NameLength];
+  //! Identifies the timer while it exists since names are not unique. May be reused by a later timer.
+  uint64_t key;
+  //! The number of finished runs.
+  uint64_t count;
+  //! The sum of the finished runs in nanoseconds.
+  int64_t sum;
+  int64_t min;
+  int64_t max;
+  //! The elapsed time of the unfinished run as of its last stop.
+  int64_t current;
+  //! Percentiles of the runs since the previous update. -1 if there were none or the histogram is not available.
+  int64_t p50;
+  int64_t p90;
+  int64_t p99;
+  int64_t p999;
+};
+
+//! @return The name of the shared memory segment of the process with the given id, i.e., "/hector_timeit.<pid>".
+std::string segmentName( long pid );
+
+//! @return The size of a segment with the given capacity in bytes.
+size_t segmentSize( uint32_t capacity );
+}
+
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2, "The shared memory layout requires lock-free 64 bit atomics." );
+
+/*!
+ * Exports the timers of the LiveReporter into a POSIX shared memory segment, so tools like hector_timeit_top can watch
+ *  them from another process. A background thread copies the LiveSnapshot and LiveHistogram of every registered timer
+ *  each period, hence, the timed threads only update their LiveStatistics as usual and never communicate with other
+ *  processes. The segment is removed when the exporter is stopped.
+ *
+ * Setting the environment variable HECTOR_TIMEIT_EXPORT starts the export when the LiveReporter is first used, e.g., by
+ *  the first HECTOR_TIME_BLOCK. Its value is the period in milliseconds, "1" or an empty value use the default period.
+ */
+class SharedMemoryExporter
+{
+public:
+  static constexpr std::chrono::milliseconds DefaultPeriod{ 1000 };
+
+  static SharedMemoryExporter &instance();
+
+  ~SharedMemoryExporter();
+
+  /*!
+   * Creates the segment and starts the export thread. Enables the live histograms of all timers. If the exporter is
+   *  already running, it is restarted.
+   * @param period The time between two updates of the segment.
+   * @param capacity The maximum number of exported timers.
+   * @return False if the segment could not be created. The reason is printed to std::cerr.
+   */
+  bool start( std::chrono::milliseconds period = DefaultPeriod, uint32_t capacity = shared_memory::DefaultCapacity );
+
+  //! Stops the export thread and removes the segment. Called on destruction.
+  void stop();
+
+  bool isRunning() const;
+
+  //! @return The name of the segment, see shared_memory::segmentName.
+  std::string segmentName() const;
+
+  /*!
+   * Starts the export if the environment variable HECTOR_TIMEIT_EXPORT is set. Called by LiveReporter::instance().
+   * @return Whether the export was started.
+   */
+  static bool startFromEnvironment();
+
+private:
+  SharedMemoryExporter() = default;
+
+  void run( std::chrono::milliseconds period );
+
+  void update();
+
+  std::mutex thread_mutex_;
+  std::condition_variable condition_;
+  std::thread thread_;
+  bool stop_ = false;
+
+  shared_memory::Header *header_ = nullptr;
+  size_t size_ = 0;
+  //! The histograms of the previous update to compute the percentiles of the runs in between.
+  std::unordered_map<const void *, std::vector<uint64_t>> previous_histograms_;
+};
+
+/*!
+ * Reads the timers exported by another process. See SharedMemoryExporter.
+ */
+class SharedMemoryReader
+{
+public:
+  struct Snapshot
+  {
+    long pid = 0;
+    //! The time of the update in nanoseconds since the epoch of the steady clock.
+    long long update_time = 0;
+    long long period = 0;
+    size_t timer_count = 0;
+    std::vector<shared_memory::Entry> entries;
+  };
+
+  SharedMemoryReader() = default;
+
+  ~SharedMemoryReader();
+
+  SharedMemoryReader( const SharedMemoryReader & ) = delete;
+
+  SharedMemoryReader &operator=( const SharedMemoryReader & ) = delete;
+
+  /*!
+   * Opens the segment of the process with the given id.
+   * @param error Set to the reason if the segment could not be opened, e.g., because the process does not export its
+   *  timers or uses an incompatible version.
+   * @return Whether the segment was opened.
+   */
+  bool open( long pid, std::string &error );
+
+  void close();
+
+  bool isOpen() const { return header_ != nullptr; }
+
+  //! The number of times read retries while the exporter updates the segment before it gives up.
+  static constexpr int MaxReadAttempts = 10000;
+
+  /*!
+   * Reads a consistent copy of the entries. Retries while the exporter updates the segment.
+   * @return False if no segment is open or no consistent copy was read within MaxReadAttempts, e.g., because the
+   *  exporting process died in the middle of an update.
+   */
+  bool read( Snapshot &snapshot ) const;
+
+  /*!
+   * @return The ids of the processes that currently export their timers.
+   */
+  static std::vector<long> list();
+
+private:
+  const shared_memory::Header *header_ = nullptr;
+  size_t size_ = 0;
+};
+}
+
+#endif //HECTOR_TIMEIT_SHARED_MEMORY_H
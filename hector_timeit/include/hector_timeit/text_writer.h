@@ -0,0 +1,71 @@
+#ifndef HECTOR_TIMEIT_TEXT_WRITER_H
+#define HECTOR_TIMEIT_TEXT_WRITER_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace hector_timeit
+{
+
+/*!
+ * Writes text into a caller-provided buffer without allocating memory.
+ * If the buffer is too small, the text is truncated but size() still counts the full length, hence, the caller can
+ *  retry with a buffer of size() + 1 bytes. The buffer is always null terminated unless its capacity is 0.
+ */
+class TextWriter
+{
+public:
+  TextWriter( char *buffer, size_t capacity ) : buffer_( buffer ), capacity_( capacity )
+  {
+    if ( capacity_ != 0 ) buffer_[0] = '\0';
+  }
+
+  /*!
+   * @return The length of the text written so far including the truncated part.
+   */
+  size_t size() const { return size_; }
+
+  bool truncated() const { return size_ >= capacity_; }
+
+  const char *data() const { return buffer_; }
+
+  void write( const char *text, size_t length );
+
+  void write( const char *text ) { write( text, std::strlen( text )); }
+
+  void write( const std::string &text ) { write( text.data(), text.size()); }
+
+  void write( char c ) { write( &c, 1 ); }
+
+  void writeRepeated( char c, size_t count );
+
+  void writeInteger( long long value );
+
+  void writeUnsigned( unsigned long long value );
+
+  /*!
+   * Writes the value in fixed-point notation with the given number of decimals.
+   * The output is the same as printf( "%.*f", precision, value ) or a std::ostream with std::fixed, but common values
+   *  are formatted without the locale and format string handling. Values close to a rounding tie and values that are
+   *  too large for the fast path are formatted using snprintf.
+   * @param precision The number of decimals in the range [0, 9].
+   */
+  void writeFixed( double value, int precision );
+
+  /*!
+   * Centers the text in a field of the given width as in the tables printed by the Timer, i.e., the left padding is
+   *  rounded down. If the width is 0 or smaller than the text, the text is written without padding.
+   */
+  void writePadded( const char *text, size_t length, size_t width );
+
+  void writePadded( const char *text, size_t width ) { writePadded( text, std::strlen( text ), width ); }
+
+private:
+  char *buffer_;
+  size_t capacity_;
+  size_t size_ = 0;
+};
+}
+
+#endif //HECTOR_TIMEIT_TEXT_WRITER_H
@@ -5,27 +5,36 @@
 #ifndef HECTOR_TIMEIT_TIMER_H
 #define HECTOR_TIMEIT_TIMER_H
 
+#include "hector_timeit/allocation_tracker.h"
+#include "hector_timeit/clocks.h"
+#include "hector_timeit/compensation.h"
+#include "hector_timeit/histogram.h"
+#include "hector_timeit/latency_budget.h"
+#include "hector_timeit/live_statistics.h"
+#include "hector_timeit/perf_counters.h"
+#include "hector_timeit/rolling_window.h"
+#include "hector_timeit/run_statistics.h"
+#include "hector_timeit/sampler.h"
+#include "hector_timeit/text_writer.h"
+#include "hector_timeit/trace.h"
+
 #include <chrono>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-#ifdef __unix__
-
-#include <unistd.h>
-#include <time.h>
-
-#endif
-
 namespace hector_timeit
 {
 
 /*!
- * Timer class that can be used for simple profiling.
- * The runtime of a single method can be measured using the static time method.
- * To measure multiple runs use a Timer instance and pass true to the reset method between runs.
+ * The part of the timer that does not depend on the clocks used for measuring, i.e., storage of the runs, statistics
+ *  and printing. See BasicTimer.
  */
-class Timer
+class TimerBase
 {
 public:
   enum TimeUnit
@@ -37,6 +46,17 @@ public:
     Nanoseconds = 4
   };
 
+  enum RunStorage
+  {
+    //! Stores the time of each run. Memory grows with the number of runs.
+    VectorStorage = 0,
+    //! Records the runs in a Histogram with fixed memory. Individual run times are not available.
+    HistogramStorage = 1
+  };
+
+  //! The latency budget of timers without a budget. No run can exceed it, see setLatencyBudget.
+  static constexpr long NoBudget = std::numeric_limits<long>::max();
+
   template<typename T>
   struct TimerResult
   {
@@ -46,34 +66,467 @@ public:
 
     std::string toString( const std::string &name )
     {
-      return Timer::internalPrint( name, { time }, { cpu_time }, Timer::TimeUnit::Default );
+      return TimerBase::internalPrint( name, { time }, { cpu_time }, TimerBase::TimeUnit::Default );
     }
   };
 
-  template<typename T>
-  static std::unique_ptr<TimerResult<T>> time( const std::function<T( void )> &function );
+  static inline bool getCpuTime( long &val ) { return ThreadCpuClock::now( val ); }
+
+  virtual ~TimerBase();
+
+  //! @return The name of the timer. Looked up in the NameRegistry, so cache it if it is needed frequently.
+  const std::string &name() const { return NameRegistry::instance().name( name_id_ ); }
+
+  //! @return The id of the name of this timer in the NameRegistry.
+  NameId nameId() const { return name_id_; }
+
+  RunStorage runStorage() const { return run_storage_; }
+
+  /*!
+   * @return Whether the timer measures the cpu time. If not, the cpu run times are empty.
+   */
+  bool measuresCpuTime() const { return measures_cpu_time_; }
+
+  /*!
+   * @return Whether the timer measures hardware performance counters. See PerfCounters.
+   */
+  bool measuresCounters() const { return measures_counters_; }
+
+  /*!
+   * @return The sum of the counters over all finished runs where the counters could be read.
+   */
+  const CounterValues &getCounterTotals() const { return counter_totals_; }
+
+  /*!
+   * @return The number of finished runs that are contained in the counter totals.
+   */
+  size_t getCounterRunCount() const { return counter_runs_; }
+
+  /*!
+   * @return The heap allocations summed over all finished runs that were timed while the AllocationTracker was enabled.
+   *  Allocations of nested running timers are only attributed to the innermost timer.
+   */
+  const AllocationCounts &getAllocationTotals() const { return allocation_totals_; }
+
+  /*!
+   * @return The number of finished runs that are contained in the allocation totals.
+   */
+  size_t getAllocationRunCount() const { return allocation_runs_; }
+
+  bool isRunning() const { return running_; }
+
+  /*!
+   * Sets how many executions each recorded run represents if only 1 in period executions is timed, e.g., using a
+   *  Sampler. The statistics and percentiles are those of the recorded runs but the printed run count and sum are
+   *  extrapolated by this factor.
+   */
+  void setSamplePeriod( unsigned period ) { sample_period_ = period < 1 ? 1 : period; }
+
+  unsigned samplePeriod() const { return sample_period_; }
+
+  /*!
+   * Sets a latency budget. If the elapsed time of a run exceeds the budget on stop, the violation is counted and either
+   *  passed to the callback or, if there is none, pushed to the BudgetViolationQueue::instance() queue. Each run is
+   *  reported at most once. Checking the budget on stop is a single comparison, so budgets can stay enabled in
+   *  production. Should be set before timing since it is read without synchronization.
+   * @param budget The budget in nanoseconds.
+   * @param callback (Optional) Called by the timing thread for each violation. Should be fast since it is called on
+   *  stop, i.e., part of the timed code of enclosing timers.
+   */
+  void setLatencyBudget( long budget, BudgetCallback callback = BudgetCallback());
+
+  //! Removes the latency budget. The count of violations is kept.
+  void clearLatencyBudget();
+
+  //! @return The latency budget in nanoseconds or NoBudget if there is none.
+  long latencyBudget() const { return latency_budget_; }
+
+  //! @return The number of runs that exceeded the latency budget. Cleared by reset().
+  size_t budgetViolations() const { return budget_violations_; }
+
+  /*!
+   * Additionally keeps statistics of the most recent runs, e.g., RollingWindow::lastSeconds( 60 ), which are printed
+   *  below the lifetime statistics. Adding a run to the window is O(1) but in Time mode requires an additional clock
+   *  read per run. Clears the runs of the previous window. Pass RollingWindow() to disable the window.
+   */
+  void setRollingWindow( const RollingWindow &window );
+
+  const RollingWindow &rollingWindow() const { return rolling_window_; }
+
+  //! @return The statistics of the runs in the rolling window. Empty if no window is set.
+  RunStatistics getWindowStatistics() const { return rolling_window_.statistics( windowTime()); }
+
+  /*!
+   * Reads the count, sum, minimum and maximum of the finished runs and the elapsed time of the current run as of the
+   *  last stop. Unlike the other getters, this method can be called from any thread while the timer is used.
+   * See LiveReporter.
+   */
+  LiveSnapshot liveSnapshot() const { return live_statistics_.snapshot(); }
+
+  //! Starts recording the runs in a LiveHistogram for liveHistogram. Can be called from any thread.
+  void enableLiveHistogram() { live_statistics_.enableHistogram(); }
+
+  /*!
+   * Adds the bucket counts of the LiveHistogram to the given counts. Can be called from any thread.
+   * @return False if the histogram was not enabled using enableLiveHistogram.
+   */
+  bool liveHistogram( std::vector<uint64_t> &counts ) const { return live_statistics_.histogram( counts ); }
+
+  /*!
+   * Returns the elapsed time since the timer or run was started excluding the time where it was paused using the stop
+   *  method.
+   * Does not use any logic to account for the timing function call.
+   * @return The elapsed time in nanoseconds.
+   */
+  virtual long getElapsedTime() const = 0;
+
+  /*!
+   * Returns the elapsed cpu or thread time (depending on what is available) since the timer or run was started
+   *  excluding the time where it was paused using the stop method.
+   * Does not use any logic to account for the timing function call.
+   * @return The elapsed cpu or thread time in nanoseconds or -1 if it is not available.
+   */
+  virtual long getElapsedCpuTime() const = 0;
+
+  /*!
+   * @return The time of each run in nanoseconds including the current run.
+   *  If the runs are stored in a histogram, only the current run is contained.
+   */
+  std::vector<long> getRunTimes() const;
+
+  /*!
+   * @return The time of each finished run in nanoseconds, i.e., without the current run.
+   *  If the runs are stored in a histogram, the result is empty.
+   */
+  const std::vector<long> &getFinishedRunTimes() const { return run_times_; }
+
+  /*!
+   * @return The cpu or thread time of each run in nanoseconds including the current run. Invalid times are -1.
+   *  If the runs are stored in a histogram, only the current run is contained.
+   */
+  std::vector<long> getCpuRunTimes() const;
+
+  /*!
+   * @return Count, sum, min, max, mean and variance of the run times including the current run.
+   */
+  RunStatistics getRunStatistics() const;
+
+  /*!
+   * @return Count, sum, min, max, mean and variance of the cpu or thread run times including the current run.
+   */
+  RunStatistics getCpuRunStatistics() const;
+
+  /*!
+   * @return The 50th, 90th, 99th and 99.9th percentile of the run times. See getPercentile.
+   */
+  RunPercentiles getRunPercentiles() const;
+
+  /*!
+   * @return The 50th, 90th, 99th and 99.9th percentile of the cpu or thread run times. See getPercentile.
+   */
+  RunPercentiles getCpuRunPercentiles() const;
+
+  /*!
+   * Computes a percentile of the run times using selection instead of sorting.
+   * If the runs are stored in a histogram, the percentile is computed from the histogram of the finished runs and its
+   *  error is bounded by the histogram's precision.
+   * @param percentile The percentile in the range [0, 100], e.g., 99.9.
+   * @return The percentile in nanoseconds or -1 if there are no valid runs.
+   */
+  long getPercentile( double percentile ) const;
+
+  /*!
+   * Same as getPercentile but for the cpu or thread run times.
+   */
+  long getCpuPercentile( double percentile ) const;
+
+  /*!
+   * @return The histogram of the finished runs. Only valid if the runs are stored in a histogram.
+   */
+  const Histogram &getRunHistogram() const { return run_histogram_; }
+
+  /*!
+   * @return The histogram of the cpu or thread time of the finished runs. Only valid if the runs are stored in a
+   *  histogram and the cpu time is measured.
+   */
+  const Histogram &getCpuRunHistogram() const { return cpu_run_histogram_; }
+
+  std::string toString() const;
+
+  /*!
+   * Writes the report of toString() into the given buffer, e.g., to print timers periodically without allocating.
+   * Timers storing their runs in a vector compute the percentiles on a copy of the runs that is kept per thread, hence,
+   *  only the first report of a thread and reports with more runs than any report before allocate.
+   * @param buffer The buffer. Null terminated unless size is 0.
+   * @param size The size of the buffer in bytes.
+   * @return The length of the report. If it is not smaller than size, the report was truncated.
+   */
+  size_t format( char *buffer, size_t size ) const;
 
-  static inline bool getCpuTime( long &val )
+  /*!
+   * Writes the report of toString() using the given writer. See format.
+   */
+  void write( TextWriter &writer ) const;
+
+  /*!
+   * Formats a time in the same way as the printed tables.
+   * @param time The time in nanoseconds.
+   * @param print_time_unit The unit. If Default, the unit is chosen depending on the magnitude of the time.
+   */
+  static std::string formatTime( double time, TimeUnit print_time_unit = Default );
+
+  //! Same as formatTime but writes the time using the given writer.
+  static void writeTime( TextWriter &writer, double time, TimeUnit print_time_unit = Default );
+
+  /*!
+   * Formats the given runs as the table printed by toString().
+   * @param name The name of the timer.
+   * @param run_times The wall time of each run in nanoseconds.
+   * @param cpu_run_times The cpu time of each run in nanoseconds. If empty, only the wall time is printed.
+   * @param print_time_unit The unit. If Default, the unit is chosen depending on the magnitude of the time.
+   */
+  static std::string formatRuns( const std::string &name, const std::vector<long> &run_times,
+                                 const std::vector<long> &cpu_run_times, TimeUnit print_time_unit = Default )
   {
-    // This could also maybe made a parameter
-#ifdef _POSIX_THREAD_CPUTIME
-    struct timespec spec;
-    if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &spec ) == -1 )
-    {
-      return false;
-    }
-    val = spec.tv_sec * 1000L * 1000L * 1000L + spec.tv_nsec;
-#elif defined(_POSIX_CPUTIME)
-    struct timespec spec;
-  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &spec) == -1)
+    return internalPrint( name, run_times, cpu_run_times, print_time_unit );
+  }
+
+  /*!
+   * Formats the given statistics as the table printed by toString(), e.g., for runs that were not recorded by a timer.
+   * @param name The name of the timer.
+   * @param run_stats The statistics of the wall times.
+   * @param cpu_run_stats The statistics of the cpu times. If empty, only the wall time is printed.
+   * @param run_percentiles The percentiles of the wall times. Percentiles of -1 are printed as "-".
+   * @param cpu_run_percentiles The percentiles of the cpu times.
+   * @param print_time_unit The unit. If Default, the unit is chosen depending on the magnitude of the time.
+   */
+  static std::string formatStatistics( const std::string &name, const RunStatistics &run_stats,
+                                       const RunStatistics &cpu_run_stats = RunStatistics(),
+                                       const RunPercentiles &run_percentiles = RunPercentiles(),
+                                       const RunPercentiles &cpu_run_percentiles = RunPercentiles(),
+                                       TimeUnit print_time_unit = Default )
+  {
+    return internalPrintStatistics( name, run_stats, cpu_run_stats, run_percentiles, cpu_run_percentiles,
+                                    print_time_unit );
+  }
+
+  /*!
+   * Formats the counters as the row appended to the table by toString(), i.e., the instructions per cycle and the
+   *  mean of each counter per run.
+   * @param totals The sum of the counters over all runs.
+   * @param runs The number of runs. If 0, an empty string is returned.
+   */
+  static std::string formatCounters( const CounterValues &totals, size_t runs );
+
+  //! Same as formatCounters but writes the row using the given writer.
+  static void writeCounters( TextWriter &writer, const CounterValues &totals, size_t runs );
+
+  /*!
+   * Formats the allocations as the row appended to the table by toString(), i.e., the allocations and bytes per run.
+   * @param totals The sum of the allocations over all runs.
+   * @param runs The number of runs. If 0, an empty string is returned.
+   */
+  static std::string formatAllocations( const AllocationCounts &totals, size_t runs );
+
+  //! Same as formatAllocations but writes the row using the given writer.
+  static void writeAllocations( TextWriter &writer, const AllocationCounts &totals, size_t runs );
+
+protected:
+  friend class ShardedTimerBase;
+  friend class LiveReporter;
+
+  //! Interns the name in the NameRegistry.
+  TimerBase( const std::string &name, TimeUnit print_time_unit, bool print_on_destruct, RunStorage run_storage,
+             bool measures_cpu_time );
+
+  TimerBase( NameId name, TimeUnit print_time_unit, bool print_on_destruct, RunStorage run_storage,
+             bool measures_cpu_time );
+
+  /*!
+   * Records the elapsed time as a new run if new_run is true, otherwise, clears all runs.
+   * Resets the elapsed time afterwards. The timer has to be stopped.
+   */
+  void finishRun( bool new_run );
+
+  //! Prints the timer to std::cout. Called by the destructor of the derived timer if print_on_destruct is set.
+  void printOnDestruct() const;
+
+  //! Makes this timer the innermost timer of the thread for the AllocationTracker. Called by start.
+  inline void beginAllocations()
   {
-    return false;
+    if ( allocations_installed_ ) return;
+    allocations_previous_ = AllocationTracker::exchangeCurrent( &elapsed_allocations_ );
+    allocations_installed_ = allocations_tracked_ = true;
   }
-  val = spec.tv_sec * 1000L * 1000L * 1000L + spec.tv_nsec;
-#else
-  val = std::clock() * 1000L * 1000L * 1000L / CLOCKS_PER_SEC;
-#endif
-    return true;
+
+  //! Restores the previous innermost timer. Called by stop.
+  inline void endAllocations()
+  {
+    if ( !allocations_installed_ ) return;
+    allocations_installed_ = false;
+    // If timers are not stopped in reverse order, the later timer stays the innermost timer until it is stopped
+    if ( AllocationTracker::current() == &elapsed_allocations_ )
+      AllocationTracker::exchangeCurrent( allocations_previous_ );
+  }
+
+  //! Records a trace event with the name of this timer. Only called while tracing is enabled, see Tracer.
+  void traceEvent( TraceEvent::Type type );
+
+  //! Counts and reports a violation of the latency budget. Called by stop if the elapsed time exceeds the budget.
+  void budgetExceeded();
+
+  //! @return The current time of the RollingWindow in nanoseconds.
+  static long long windowTime()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( WallClock::now().time_since_epoch()).count();
+  }
+
+  //! Appends the statistics of the rolling window to the table if the window is enabled.
+  static void writeWindow( TextWriter &writer, const RollingWindow &window, const RunStatistics &window_stats,
+                           TimeUnit print_time_unit );
+
+  //! Same as writeWindow but returns the rows as string.
+  static std::string formatWindow( const RollingWindow &window, const RunStatistics &window_stats,
+                                   TimeUnit print_time_unit );
+
+  //! Appends the count of budget violations to the table if a budget was set.
+  static void writeBudget( TextWriter &writer, long budget, size_t violations, TimeUnit print_time_unit );
+
+  //! Same as writeBudget but returns the row as string.
+  static std::string formatBudget( long budget, size_t violations, TimeUnit print_time_unit );
+
+  static std::string internalPrint( const std::string &name, const std::vector<long> &run_times,
+                                    const std::vector<long> &cpu_run_times, TimeUnit print_time_unit );
+
+  static std::string internalPrintStatistics( const std::string &name, const RunStatistics &run_stats,
+                                              const RunStatistics &cpu_run_stats, const RunPercentiles &run_percentiles,
+                                              const RunPercentiles &cpu_run_percentiles, TimeUnit print_time_unit,
+                                              unsigned sample_period = 1 );
+
+  static void internalWriteStatistics( TextWriter &writer, const std::string &name, const RunStatistics &run_stats,
+                                       const RunStatistics &cpu_run_stats, const RunPercentiles &run_percentiles,
+                                       const RunPercentiles &cpu_run_percentiles, TimeUnit print_time_unit,
+                                       unsigned sample_period = 1 );
+
+  std::vector<long> run_times_;
+  std::vector<long> cpu_run_times_;
+  Histogram run_histogram_;
+  Histogram cpu_run_histogram_;
+  NameId name_id_;
+  RunStorage run_storage_;
+  TimeUnit print_time_unit_;
+  unsigned sample_period_ = 1;
+  long elapsed_time_ = 0;
+  long elapsed_cpu_time_ = 0;
+  long latency_budget_ = NoBudget;
+  size_t budget_violations_ = 0;
+  BudgetCallback budget_callback_;
+  RollingWindow rolling_window_;
+  bool budget_reported_ = false;
+  bool running_ = false;
+  bool cpu_time_valid_ = true;
+  bool measures_cpu_time_;
+  bool print_on_destruct_ = false;
+  bool measures_counters_ = false;
+  //! Whether the counters could be read at every start and stop of the current run.
+  bool counters_valid_ = false;
+  CounterValues elapsed_counters_;
+  CounterValues counter_totals_;
+  size_t counter_runs_ = 0;
+  AllocationCounts elapsed_allocations_;
+  AllocationCounts allocation_totals_;
+  size_t allocation_runs_ = 0;
+  AllocationCounts *allocations_previous_ = nullptr;
+  //! Whether elapsed_allocations_ is the current counts of the thread.
+  bool allocations_installed_ = false;
+  //! Whether the allocations were tracked in the current run.
+  bool allocations_tracked_ = false;
+  //! Set by the LiveReporter, so the timer is removed from the reporter on destruction.
+  bool live_registered_ = false;
+  LiveStatistics live_statistics_;
+};
+
+template<>
+struct TimerBase::TimerResult<void>
+{
+  long time;
+  long cpu_time;
+
+  std::string toString( const std::string &name )
+  {
+    return TimerBase::internalPrint( name, { time }, { cpu_time }, TimerBase::TimeUnit::Default );
+  }
+};
+
+namespace detail
+{
+template<typename T>
+struct is_std_function : std::false_type
+{
+};
+
+template<typename T>
+struct is_std_function<std::function<T>> : std::true_type
+{
+};
+
+/*!
+ * The type of the result of calling a Function. References are kept, const and volatile are removed from values, so
+ *  the result can be moved out of the TimerResult.
+ */
+template<typename Function>
+struct callable_result
+{
+  typedef decltype( std::declval<Function &>()()) raw_type;
+  typedef typename std::conditional<std::is_reference<raw_type>::value, raw_type,
+                                    typename std::remove_cv<raw_type>::type>::type type;
+};
+}
+
+/*!
+ * Timer class that can be used for simple profiling.
+ * The runtime of a single method can be measured using the static time method.
+ * To measure multiple runs use a Timer instance and pass true to the reset method between runs.
+ * By default, the time of every run is stored. For timers that record runs for a long time, e.g., in a control loop,
+ *  the runs can instead be recorded in a fixed size Histogram which keeps the memory constant.
+ *
+ * What is measured is selected at compile time using the following policies:
+ * @tparam WallClockT The clock used for the wall time, e.g., WallClock, TscClock or any std::chrono clock.
+ * @tparam CpuClockT The clock used for the cpu time. ThreadCpuClock or NoCpuClock to disable cpu time measurements.
+ * @tparam CompensationT How the time it takes to read the clocks is compensated. DoubleSamplingCompensation reads
+ *  every clock twice per start and stop, NoCompensation only once and CalibratedCompensation reads them once and
+ *  subtracts an overhead that is calibrated once per process.
+ *
+ * Timer is the default instantiation which measures wall and cpu time with double sampling.
+ * A WallTimer only reads the wall clock once per start and stop.
+ */
+template<typename WallClockT, typename CpuClockT, typename CompensationT, typename CountersT = NoCounters>
+class BasicTimer : public TimerBase
+{
+public:
+  typedef WallClockT WallClockType;
+  typedef CpuClockT CpuClockType;
+  typedef CompensationT CompensationType;
+
+  template<typename T>
+  static std::unique_ptr<TimerResult<T>> time( const std::function<T( void )> &function )
+  {
+    return internalTime( function, typename std::is_void<T>::type());
+  }
+
+  /*!
+   * Times a single call of the given callable, e.g., a lambda.
+   * Unlike the std::function overload, the callable is not type-erased and the result is returned by value, hence,
+   *  nothing is allocated on the heap. The result of the callable is constructed in place and can be moved out.
+   * @return The wall and cpu time and the result. If the callable returns a reference, the result is that reference.
+   *  If it returns void, the TimerResult has no result.
+   */
+  template<typename Function, typename = typename std::enable_if<
+    !detail::is_std_function<typename std::decay<Function>::type>::value>::type>
+  static TimerResult<typename detail::callable_result<Function>::type> time( Function &&function )
+  {
+    typedef typename detail::callable_result<Function>::type ResultType;
+    return internalTimeCallable<ResultType>( function, typename std::is_void<ResultType>::type());
   }
 
   /*!
@@ -83,13 +536,40 @@ public:
    * @param autostart If true, the timer starts immediately after construction. If false, it has to be manually started
    *  using the start() method.
    * @param print_on_destruct If true, prints when the Time object is destructed.
+   * @param run_storage How runs are stored. HistogramStorage allocates the histograms on construction and uses
+   *  constant memory afterwards.
    */
-  explicit Timer( std::string name, TimeUnit print_time_unit = Default, bool autostart = true,
-                  bool print_on_destruct = false );
+  explicit BasicTimer( const std::string &name, TimeUnit print_time_unit = Default, bool autostart = true,
+                       bool print_on_destruct = false, RunStorage run_storage = VectorStorage )
+    : BasicTimer( NameRegistry::instance().intern( name ), print_time_unit, autostart, print_on_destruct, run_storage )
+  {
+  }
 
-  ~Timer();
+  /*!
+   * Same as above but the name is known at compile time, which avoids any string operations. See
+   *  HECTOR_TIMEIT_STATIC_NAME.
+   */
+  explicit BasicTimer( const NameDescriptor &name, TimeUnit print_time_unit = Default, bool autostart = true,
+                       bool print_on_destruct = false, RunStorage run_storage = VectorStorage )
+    : BasicTimer( name.id(), print_time_unit, autostart, print_on_destruct, run_storage )
+  {
+  }
 
-  const std::string &name() const { return name_; }
+  //! Same as above but with the id of an interned name, see NameRegistry.
+  explicit BasicTimer( NameId name, TimeUnit print_time_unit = Default, bool autostart = true,
+                       bool print_on_destruct = false, RunStorage run_storage = VectorStorage )
+    : TimerBase( name, print_time_unit, print_on_destruct, run_storage, CpuClockT::enabled )
+    , overhead_( CompensationT::template overhead<WallClockT, CpuClockT>())
+  {
+    measures_counters_ = counters_valid_ = CountersT::enabled;
+    detail::calibrateClock<WallClockT>();
+    if ( autostart ) start();
+  }
+
+  ~BasicTimer() override
+  {
+    if ( print_on_destruct_ ) printOnDestruct();
+  }
 
   /*!
    * Starts the timer if it isn't already running.
@@ -98,6 +578,9 @@ public:
   {
     if ( running_ ) return;
     running_ = true;
+    // Recorded before the clocks are read, so the trace event isn't part of the measured time
+    if ( Tracer::enabled()) traceEvent( TraceEvent::Begin );
+    if ( AllocationTracker::enabled()) beginAllocations();
     /*
      * To get a more accurate measurement, the time it takes to measure the time is subtracted by using the following method:
      * We assume that each measurement takes roughly the same time
@@ -122,17 +605,24 @@ public:
      * Wall time B duration:           XR + YI + YR + YI + YR + R + YI + YR + YI + YR + XI
      * Diff Wall time = Wall time A - Wall time B = XR + XI + XR + XI = 2 * (XR + XI)
      * Wall time = Wall time B - 1/2 * Diff Wall time - 2 * Diff CPU = 1.5 * Wall time B - 0.5 * Wall time A - 2 * Diff CPU = R
+     *
+     * Without double sampling only the A samples are taken. The wall time then contains XR + XI + 2 * (YI + YR) and the
+     *  cpu time YR + YI on top of R. The CalibratedCompensation measures these constants once and they are subtracted on
+     *  stop, other policies subtract nothing.
+     * The conditions on the policies are compile time constants, hence, disabled measurements generate no code.
      */
-    start_a_ = std::chrono::high_resolution_clock::now();
-    start_b_ = std::chrono::high_resolution_clock::now();
-    if ( cpu_time_valid_a_ )
+    start_a_ = WallClockT::now();
+    if ( CompensationT::double_sampling ) start_b_ = WallClockT::now();
+    if ( CpuClockT::enabled && cpu_time_valid_ )
     {
-      cpu_time_valid_a_ = getCpuTime( cpu_start_a_ );
-      if ( cpu_time_valid_b_ )
+      cpu_time_valid_ = CpuClockT::now( cpu_start_a_ );
+      if ( CompensationT::double_sampling && cpu_time_valid_b_ )
       {
-        cpu_time_valid_b_ = getCpuTime( cpu_start_b_ );
+        cpu_time_valid_b_ = CpuClockT::now( cpu_start_b_ );
       }
     }
+    // The counters are read last on start and first on stop, so they count as little of the timing as possible
+    if ( CountersT::enabled && counters_valid_ ) counters_valid_ = CountersT::read( counters_start_ );
   }
 
   /*!
@@ -144,28 +634,36 @@ public:
     // See start method for a documentation of the algorithm used to get precise time measurements
     long time_a = 0;
     long time_b = 0;
-    if ( cpu_time_valid_a_ )
+    if ( CountersT::enabled && counters_valid_ )
     {
-      if ( cpu_time_valid_b_ )
+      CounterValues counters;
+      counters_valid_ = CountersT::read( counters );
+      for ( int i = 0; i < CounterValues::CounterCount; ++i )
+        elapsed_counters_.values[i] += counters.values[i] - counters_start_.values[i];
+    }
+    if ( CpuClockT::enabled && cpu_time_valid_ )
+    {
+      if ( CompensationT::double_sampling && cpu_time_valid_b_ )
       {
-        cpu_time_valid_b_ = getCpuTime( time_b );
+        cpu_time_valid_b_ = CpuClockT::now( time_b );
       }
-      cpu_time_valid_a_ = getCpuTime( time_a );
+      cpu_time_valid_ = CpuClockT::now( time_a );
     }
-    auto time_point_b = std::chrono::high_resolution_clock::now();
-    auto time_point_a = std::chrono::high_resolution_clock::now();
+    typename WallClockT::time_point time_point_b;
+    if ( CompensationT::double_sampling ) time_point_b = WallClockT::now();
+    typename WallClockT::time_point time_point_a = WallClockT::now();
     long cpu_diff = 0;
-    if ( cpu_time_valid_a_ )
+    if ( CpuClockT::enabled && cpu_time_valid_ )
     {
       long elapsed;
-      if ( cpu_time_valid_b_ )
+      if ( CompensationT::double_sampling && cpu_time_valid_b_ )
       {
         cpu_diff = (time_a - cpu_start_a_) - (time_b - cpu_start_b_);
         elapsed = (time_b - cpu_start_b_) - cpu_diff / 2;
       }
       else
       {
-        elapsed = time_a - cpu_start_a_;
+        elapsed = time_a - cpu_start_a_ - overhead_.cpu;
       }
       if ( elapsed < 0 ) // TODO IF DEBUG
       {
@@ -173,16 +671,28 @@ public:
       }
       elapsed_cpu_time_ += elapsed;
     }
-    long wall_time_b = internalGetDuration( start_b_, time_point_b );
-    long wall_time_a = internalGetDuration( start_a_, time_point_a );
-    long elapsed = wall_time_b + wall_time_b / 2 - wall_time_a / 2 - 2 * cpu_diff;
+    long elapsed;
+    if ( CompensationT::double_sampling )
+    {
+      long wall_time_b = internalGetDuration( start_b_, time_point_b );
+      long wall_time_a = internalGetDuration( start_a_, time_point_a );
+      elapsed = wall_time_b + wall_time_b / 2 - wall_time_a / 2 - 2 * cpu_diff;
+    }
+    else
+    {
+      elapsed = internalGetDuration( start_a_, time_point_a ) - overhead_.wall;
+    }
 
     if ( elapsed < 0 ) // TODO IF DEBUG
     {
       elapsed = 0;
     }
     elapsed_time_ += elapsed;
+    if ( elapsed_time_ > latency_budget_ ) budgetExceeded();
+    live_statistics_.setCurrent( elapsed_time_ );
     running_ = false;
+    endAllocations();
+    if ( Tracer::enabled()) traceEvent( TraceEvent::End );
   }
 
   /*!
@@ -190,115 +700,157 @@ public:
    * If you want to time multiple runs pass true.
    * @param new_run Whether or not you want to time a new run. If false, everything is reset including the runs.
    */
-  void reset( bool new_run = false );
+  void reset( bool new_run = false )
+  {
+    stop();
+    finishRun( new_run );
+    cpu_time_valid_b_ = true;
+  }
 
-  /*!
-   * Returns the elapsed time since the timer or run was started excluding the time where it was paused using the stop
-   *  method.
-   * Does not use any logic to account for the timing function call.
-   * @return The elapsed time in nanoseconds.
-   */
-  inline long getElapsedTime() const
+  inline long getElapsedTime() const override
   {
     long result = elapsed_time_;
     if ( running_ )
-      result += internalGetDuration( start_b_, std::chrono::high_resolution_clock::now());
+      result += internalGetDuration( CompensationT::double_sampling ? start_b_ : start_a_, WallClockT::now());
     return result;
   }
 
-  /*!
-   * Returns the elapsed cpu or thread time (depending on what is available) since the timer or run was started
-   *  excluding the time where it was paused using the stop method.
-   * Does not use any logic to account for the timing function call.
-   * @return The elapsed cpu or thread time in nanoseconds.
-   */
-  inline long getElapsedCpuTime() const
+  inline long getElapsedCpuTime() const override
   {
-    if ( !cpu_time_valid_a_ ) return -1;
+    if ( !CpuClockT::enabled || !cpu_time_valid_ ) return -1;
     long result = elapsed_cpu_time_;
     if ( running_ )
     {
       long time;
-      if ( !getCpuTime( time )) return -1;
+      if ( !CpuClockT::now( time )) return -1;
       result += time - cpu_start_a_;
     }
     return result;
   }
 
-  std::vector<long> getRunTimes() const;
+protected:
+  static inline long internalGetDuration( const typename WallClockT::time_point &start,
+                                          const typename WallClockT::time_point &end )
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
+  }
 
-  std::vector<long> getCpuRunTimes() const;
+  template<typename T>
+  static std::unique_ptr<TimerResult<T>> internalTime( const std::function<T( void )> &function, std::false_type )
+  {
+    BasicTimer timer( anonymousName());
+    T function_result = function();
+    timer.stop();
+    std::unique_ptr<TimerResult<T> > result(
+      new TimerResult<T>{ .time = timer.getElapsedTime(), .cpu_time = timer.getElapsedCpuTime(), .result = function_result } );
+    return result;
+  }
 
-  std::string toString() const;
+  static std::unique_ptr<TimerResult<void>> internalTime( const std::function<void( void )> &function, std::true_type )
+  {
+    BasicTimer timer( anonymousName());
+    function();
+    timer.stop();
+    std::unique_ptr<TimerResult<void> > result( new TimerResult<void>());
+    result->time = timer.getElapsedTime();
+    result->cpu_time = timer.getElapsedCpuTime();
+    return result;
+  }
 
-protected:
+  static const NameDescriptor &anonymousName()
+  {
+    static const NameDescriptor name( "anonymous" );
+    return name;
+  }
 
-  static std::string internalPrint( const std::string &name, const std::vector<long> &run_times,
-                                    const std::vector<long> &cpu_run_times, TimeUnit print_time_unit );
+  template<typename ResultType, typename Function>
+  static TimerResult<ResultType> internalTimeCallable( Function &function, std::false_type )
+  {
+    BasicTimer timer( anonymousName(), Default, false );
+    timer.start();
+    TimerResult<ResultType> result{ 0, 0, function() };
+    timer.stop();
+    result.time = timer.getElapsedTime();
+    result.cpu_time = timer.getElapsedCpuTime();
+    return result;
+  }
 
-  static inline long internalGetDuration( const std::chrono::high_resolution_clock::time_point &start,
-                                          const std::chrono::high_resolution_clock::time_point &end )
+  template<typename ResultType, typename Function>
+  static TimerResult<void> internalTimeCallable( Function &function, std::true_type )
   {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
+    BasicTimer timer( anonymousName(), Default, false );
+    timer.start();
+    function();
+    timer.stop();
+    return TimerResult<void>{ timer.getElapsedTime(), timer.getElapsedCpuTime() };
   }
 
-  std::vector<long> run_times_;
-  std::vector<long> cpu_run_times_;
-  std::string name_;
-  TimeUnit print_time_unit_;
-  std::chrono::high_resolution_clock::time_point start_a_;
-  std::chrono::high_resolution_clock::time_point start_b_;
-  long elapsed_time_ = 0;
-  long elapsed_cpu_time_ = 0;
+  typename WallClockT::time_point start_a_;
+  typename WallClockT::time_point start_b_;
+  ClockOverhead overhead_;
+  CounterValues counters_start_;
   long cpu_start_a_ = 0;
   long cpu_start_b_ = 0;
-  bool running_ = false;
-  bool cpu_time_valid_a_ = true;
   bool cpu_time_valid_b_ = true;
-  bool print_on_destruct_ = false;
 };
 
-template<typename T>
-std::unique_ptr<Timer::TimerResult<T>> Timer::time( const std::function<T( void )> &function )
-{
-  Timer timer( "anonymous" );
-  T function_result = function();
-  timer.stop();
-  std::unique_ptr<Timer::TimerResult<T> > result(
-    new Timer::TimerResult<T>{ .time = timer.getElapsedTime(), .cpu_time = timer.getElapsedCpuTime(), .result = function_result } );
-  return result;
-}
+//! The default timer which measures wall and cpu time and compensates the time it takes to read the clocks.
+typedef BasicTimer<WallClock, ThreadCpuClock, DoubleSamplingCompensation> Timer;
+
+//! Timer that only measures the wall time with a single clock read per start and stop.
+typedef BasicTimer<WallClock, NoCpuClock, NoCompensation> WallTimer;
+
+//! Timer that measures wall and cpu time and subtracts a once calibrated clock read overhead from every run.
+typedef BasicTimer<WallClock, ThreadCpuClock, CalibratedCompensation> CalibratedTimer;
+
+//! Timer that additionally measures the hardware performance counters if the kernel allows it. See PerfCounters.
+typedef BasicTimer<WallClock, ThreadCpuClock, DoubleSamplingCompensation, PerfCounters> CountingTimer;
 
-struct TimeBlock
+/*!
+ * Starts the given timer on construction and stops it and records a new run on destruction.
+ */
+template<typename TimerT>
+struct BasicTimeBlock
 {
-  explicit TimeBlock( Timer &timer ) : timer_( timer ) { timer_.start(); }
+  explicit BasicTimeBlock( TimerT &timer ) : timer_( timer ) { timer_.start(); }
 
-  ~TimeBlock()
+  ~BasicTimeBlock()
   {
     timer_.stop();
     timer_.reset( true );
   }
 
-  Timer &timer_;
+  TimerT &timer_;
 };
 
-template<>
-struct Timer::TimerResult<void>
+typedef BasicTimeBlock<Timer> TimeBlock;
+
+/*!
+ * Same as BasicTimeBlock but only times the executions chosen by the sampler.
+ * The timer's sample period should be set to the sampler's period, so the printed counts are extrapolated.
+ */
+template<typename TimerT>
+struct BasicSampledTimeBlock
 {
-  long time;
-  long cpu_time;
+  BasicSampledTimeBlock( TimerT &timer, Sampler &sampler ) : timer_( sampler.sample() ? &timer : nullptr )
+  {
+    if ( timer_ != nullptr ) timer_->start();
+  }
 
-  std::string toString( const std::string &name )
+  ~BasicSampledTimeBlock()
   {
-    return Timer::internalPrint( name, { time }, { cpu_time }, Timer::TimeUnit::Default );
+    if ( timer_ == nullptr ) return;
+    timer_->stop();
+    timer_->reset( true );
   }
+
+  TimerT *timer_;
 };
 
-template<>
-std::unique_ptr<Timer::TimerResult<void>> Timer::time<void>( const std::function<void( void )> &function );
+typedef BasicSampledTimeBlock<Timer> SampledTimeBlock;
 }
 
-std::ostream &operator<<( std::ostream &stream, const hector_timeit::Timer &timer );
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::TimerBase &timer );
 
 #include "hector_timeit/macros.h"
 
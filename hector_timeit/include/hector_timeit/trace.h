@@ -0,0 +1,309 @@
+#ifndef HECTOR_TIMEIT_TRACE_H
+#define HECTOR_TIMEIT_TRACE_H
+
+#include "hector_timeit/clocks.h"
+#include "hector_timeit/name_registry.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hector_timeit
+{
+
+struct TraceEvent
+{
+  enum Type
+  {
+    Begin = 0,
+    End = 1
+  };
+
+  //! TscClock time in nanoseconds.
+  long long timestamp;
+  NameId name;
+  uint32_t type;
+};
+
+/*!
+ * Fixed size ring buffer of the trace events of a single thread. If the buffer is full, the oldest events are
+ *  overwritten. Only the owning thread writes into the buffer.
+ *
+ * In streaming mode, the buffer is a single producer single consumer queue instead. A flusher consumes the events
+ *  behind the owning thread and, if the flusher falls behind by the capacity, new events are dropped instead of
+ *  overwriting events that were not flushed yet.
+ *
+ * The owning thread only writes the write position and the dropped count. All other positions belong to the consumer,
+ *  i.e., the Tracer, which only changes them while holding its lock.
+ */
+class TraceBuffer
+{
+public:
+  /*!
+   * @param capacity The number of events. Rounded up to the next power of two.
+   * @param thread_id The id of the thread shown in the trace.
+   */
+  TraceBuffer( size_t capacity, long thread_id, bool streaming = false );
+
+  inline void push( NameId name, TraceEvent::Type type, long long timestamp )
+  {
+    size_t written = written_.load( std::memory_order_relaxed );
+    if ( streaming_.load( std::memory_order_relaxed ) && written - flushed_.load( std::memory_order_acquire ) > mask_ )
+    {
+      // Only the owning thread writes, hence, no atomic increment required
+      dropped_.store( dropped_.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+      return;
+    }
+    TraceEvent &event = events_[written & mask_];
+    event.timestamp = timestamp;
+    event.name = name;
+    event.type = type;
+    written_.store( written + 1, std::memory_order_release );
+  }
+
+  long threadId() const { return thread_id_; }
+
+  size_t capacity() const { return events_.size(); }
+
+  /*!
+   * @return The number of events that were recorded including the overwritten events.
+   */
+  size_t writtenCount() const { return written_.load( std::memory_order_acquire ); }
+
+  /*!
+   * @return The number of events still in the buffer, i.e., neither overwritten nor cleared.
+   */
+  size_t size() const;
+
+  /*!
+   * @return The number of events that were lost, i.e., overwritten in ring mode or dropped in streaming mode.
+   */
+  size_t droppedCount() const;
+
+  /*!
+   * @return The events still in the buffer from oldest to newest. See size().
+   */
+  std::vector<TraceEvent> events() const;
+
+  /*!
+   * @return The event with the given index in the range [writtenCount() - capacity(), writtenCount()).
+   */
+  const TraceEvent &event( size_t index ) const { return events_[index & mask_]; }
+
+  /*!
+   * @return The number of events that were consumed by the flusher. Only meaningful in streaming mode.
+   */
+  size_t flushedCount() const { return flushed_.load( std::memory_order_acquire ); }
+
+  /*!
+   * Marks the events up to the given count as consumed which allows the owning thread to reuse their slots.
+   * Must only be called by the flusher.
+   */
+  void setFlushedCount( size_t count ) { flushed_.store( count, std::memory_order_release ); }
+
+  /*!
+   * Switches between ring mode and streaming mode. When streaming starts, the events still in the buffer are the first
+   *  to be consumed.
+   */
+  void setStreaming( bool streaming );
+
+  /*!
+   * Discards the events recorded so far and resets the dropped count by advancing the read positions. Must only be
+   *  called by the consumer but the owning thread may record concurrently. Events recorded during the call may or may
+   *  not be discarded.
+   */
+  void clear();
+
+  //! Marks the buffer as finished because the owning thread exited. Called by the owning thread.
+  void finish() { finished_.store( true, std::memory_order_release ); }
+
+  bool finished() const { return finished_.load( std::memory_order_acquire ); }
+
+  /*!
+   * @return True if there are no events left to consume, i.e., all events were flushed in streaming mode or the buffer
+   *  is empty in ring mode.
+   */
+  bool drained() const;
+
+private:
+  //! @return The index of the oldest event still in the buffer.
+  size_t begin( size_t written ) const;
+
+  std::vector<TraceEvent> events_;
+  size_t mask_;
+  std::atomic<size_t> written_;
+  std::atomic<size_t> flushed_;
+  std::atomic<size_t> cleared_;
+  std::atomic<size_t> dropped_;
+  //! The dropped count when the buffer was cleared.
+  std::atomic<size_t> dropped_cleared_;
+  std::atomic<bool> streaming_;
+  std::atomic<bool> finished_;
+  long thread_id_;
+};
+
+/*!
+ * The recorded events of all threads together with their names, e.g., read from a trace file.
+ */
+struct TraceData
+{
+  struct Thread
+  {
+    long thread_id;
+    std::vector<TraceEvent> events;
+  };
+
+  long process_id = 0;
+  std::vector<std::string> names;
+  std::vector<Thread> threads;
+
+  const std::string &name( NameId id ) const;
+
+  /*!
+   * Writes the events as Chrome trace-event JSON. Ends without a preceding begin, e.g., because the begin was
+   *  overwritten or tracing was enabled while a timer was running, are skipped.
+   */
+  void writeChromeTrace( std::ostream &stream ) const;
+};
+
+class TraceFileWriter;
+
+/*!
+ * Opt-in recording of the start and stop of every timer and scope as a timeline that can be written as Chrome
+ *  trace-event JSON which can be opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * While tracing is disabled, timers only check an atomic flag. While it is enabled, every edge writes a 16 byte event
+ *  into a ring buffer of the calling thread which neither locks nor allocates. Only the first event of a thread
+ *  allocates and registers its buffer, and the first traced start of a timer interns its name.
+ *
+ * Like the ShardedTimer, the buffers are read without synchronization. Hence, the trace should be written when no
+ *  thread is recording, e.g., after disable() or on application exit.
+ * The buffer of a thread that exited is released once its events were consumed, i.e., flushed to the trace file or
+ *  cleared. Until then, its events are part of the trace.
+ */
+class Tracer
+{
+public:
+  static constexpr size_t DefaultEventsPerThread = 1 << 16;
+
+  static Tracer &instance();
+
+  ~Tracer();
+
+  static inline bool enabled() { return enabled_.load( std::memory_order_relaxed ); }
+
+  /*!
+   * Records an event for the calling thread if tracing is enabled.
+   */
+  static inline void record( NameId name, TraceEvent::Type type )
+  {
+    if ( !enabled()) return;
+    TraceBuffer *buffer = localBuffer();
+    if ( buffer == nullptr && (buffer = instance().registerThread()) == nullptr ) return;
+    buffer->push( name, type, TscClock::now().time_since_epoch().count());
+  }
+
+  /*!
+   * Enables tracing.
+   * @param events_per_thread The capacity of the ring buffer of each thread. Only affects threads that did not record
+   *  an event yet.
+   * @param path If not empty, the trace is written to this file on application exit.
+   */
+  void enable( size_t events_per_thread = DefaultEventsPerThread, const std::string &path = "" );
+
+  /*!
+   * Enables tracing and streams all events into a binary trace file (see TraceFileWriter) instead of only keeping the
+   *  latest events in memory. A background thread appends the new events of all threads every flush interval, hence,
+   *  the memory stays bounded by the buffer capacity per thread. If a thread records more events than its buffer holds
+   *  within a flush interval, the surplus events are dropped.
+   * @param path The trace file. Existing files are overwritten.
+   * @param events_per_thread The capacity of the buffer of each thread that did not record an event yet.
+   * @param flush_interval_ms The interval in milliseconds in which the background thread writes the new events.
+   * @return True if the file was opened, false if it could not be opened or a file is already being written.
+   */
+  bool enableFile( const std::string &path, size_t events_per_thread = DefaultEventsPerThread,
+                   long flush_interval_ms = 100 );
+
+  /*!
+   * Disables tracing. If a trace file is written, the remaining events are flushed and the file is closed.
+   */
+  void disable();
+
+  /*!
+   * Removes all recorded events and the dropped counts. Only advances the read position of each buffer, hence, it can
+   *  be called while threads are recording. Events that are recorded during the call may or may not be removed.
+   */
+  void clear();
+
+  /*!
+   * @return The number of events in the buffers of all threads.
+   */
+  size_t eventCount() const;
+
+  /*!
+   * @return The number of events that were overwritten or, when streaming to a file, dropped because a buffer was full.
+   */
+  size_t droppedEventCount() const;
+
+  /*!
+   * @return The events that are still in the buffers of all threads.
+   */
+  TraceData data() const;
+
+  /*!
+   * Writes the events that are still in the buffers as Chrome trace-event JSON. See TraceData::writeChromeTrace.
+   */
+  void writeChromeTrace( std::ostream &stream ) const;
+
+  /*!
+   * @return True if the trace was written successfully, false otherwise.
+   */
+  bool writeChromeTrace( const std::string &path ) const;
+
+private:
+  //! Thread local owner of the buffer of a thread that marks the buffer as finished when the thread exits.
+  struct LocalBufferOwner;
+
+  Tracer();
+
+  static inline TraceBuffer *&localBuffer()
+  {
+    static thread_local TraceBuffer *buffer = nullptr;
+    return buffer;
+  }
+
+  //! @return The buffer of the calling thread or nullptr if the thread is exiting.
+  TraceBuffer *registerThread();
+
+  //! Releases the buffers of exited threads that were drained. Has to be called with the lock held.
+  void releaseFinishedBuffers();
+
+  //! Writes the new events of all buffers to the trace file.
+  void flush();
+
+  void flushLoop( long flush_interval_ms );
+
+  static std::atomic<bool> enabled_;
+
+  mutable std::mutex mutex_;
+  // Shared with the LocalBufferOwner of the thread, so the buffer outlives the tracer if the thread exits later
+  std::vector<std::shared_ptr<TraceBuffer>> buffers_;
+  //! The dropped counts of released buffers.
+  size_t released_dropped_ = 0;
+  size_t events_per_thread_ = DefaultEventsPerThread;
+  std::string path_;
+
+  std::unique_ptr<TraceFileWriter> file_writer_;
+  std::thread flush_thread_;
+  std::mutex flush_mutex_;
+  std::condition_variable flush_condition_;
+  bool stop_flushing_ = false;
+};
+}
+
+#endif //HECTOR_TIMEIT_TRACE_H
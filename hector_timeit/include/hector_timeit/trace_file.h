@@ -0,0 +1,115 @@
+#ifndef HECTOR_TIMEIT_TRACE_FILE_H
+#define HECTOR_TIMEIT_TRACE_FILE_H
+
+#include "hector_timeit/timer.h"
+#include "hector_timeit/trace.h"
+
+#include <cstdint>
+#include <string>
+
+namespace hector_timeit
+{
+
+/*!
+ * Appends trace events to a binary trace file that is memory mapped and grows as required.
+ *
+ * File format (all fixed size integers are little endian):
+ *  Header (32 bytes): magic "HTIMEIT\0", uint32 version, uint32 header size, uint64 data size, uint64 process id.
+ *   The data size is updated after every flush, hence, a file of a crashed process can be read up to the last flush.
+ *  Records until the data size, each starting with a type byte:
+ *   Name (1): varint id, varint length, name bytes.
+ *   Events (2): varint thread id, varint count, varint timestamp of the first event in nanoseconds, then per event
+ *    varint (zigzag(timestamp delta to the previous event) << 1 | type) and varint name id.
+ *  Varints are unsigned LEB128, i.e., 7 bits per byte with the high bit set on all but the last byte.
+ * A typical event takes 3 to 5 bytes.
+ */
+class TraceFileWriter
+{
+public:
+  static constexpr uint32_t Version = 1;
+  static constexpr size_t HeaderSize = 32;
+
+  TraceFileWriter() = default;
+
+  ~TraceFileWriter();
+
+  TraceFileWriter( const TraceFileWriter & ) = delete;
+
+  TraceFileWriter &operator=( const TraceFileWriter & ) = delete;
+
+  /*!
+   * Creates or truncates the file and writes the header.
+   * @return True if successful, false otherwise.
+   */
+  bool open( const std::string &path );
+
+  bool isOpen() const { return data_ != nullptr; }
+
+  /*!
+   * Writes the names with ids that were interned since the last call.
+   */
+  void writeNames( const NameRegistry &registry );
+
+  /*!
+   * Writes the events in the range [begin, end) of the given buffer as a single events record.
+   */
+  void writeEvents( const TraceBuffer &buffer, size_t begin, size_t end );
+
+  /*!
+   * Updates the data size in the header, so the records written so far are visible to readers.
+   */
+  void commit();
+
+  /*!
+   * Commits and truncates the file to its data size.
+   */
+  void close();
+
+  /*!
+   * @return The size of the header and the records in bytes.
+   */
+  size_t size() const { return size_; }
+
+  /*!
+   * @return False if growing the file failed and records were lost.
+   */
+  bool good() const { return good_; }
+
+private:
+  bool reserve( size_t bytes );
+
+  inline void writeVarint( uint64_t value )
+  {
+    while ( value >= 0x80 )
+    {
+      data_[size_++] = static_cast<char>((value & 0x7F) | 0x80);
+      value >>= 7;
+    }
+    data_[size_++] = static_cast<char>(value);
+  }
+
+  int fd_ = -1;
+  char *data_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  NameId names_written_ = 0;
+  bool good_ = true;
+};
+
+/*!
+ * Reads a trace file written by the TraceFileWriter.
+ * @param path The trace file.
+ * @param data Set to the names and the events per thread. The events of the same thread are concatenated in order.
+ * @param error Set to a description of the problem if reading fails.
+ * @return True if the file was read successfully, false otherwise.
+ */
+bool readTraceFile( const std::string &path, TraceData &data, std::string &error );
+
+/*!
+ * Creates the text report of a trace, i.e., the table printed by the Timer for every name where each pair of begin and
+ *  end is a run. Only the wall time is traced, hence, the reports don't contain the cpu time.
+ */
+std::string traceReport( const TraceData &data, TimerBase::TimeUnit print_time_unit = TimerBase::Default );
+}
+
+#endif //HECTOR_TIMEIT_TRACE_FILE_H
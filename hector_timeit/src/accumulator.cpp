@@ -0,0 +1,132 @@
+#include "hector_timeit/accumulator.h"
+
+#include <iostream>
+#include <sstream>
+
+namespace hector_timeit
+{
+
+constexpr uint64_t RunAccumulator::MaxTime;
+constexpr uint32_t RunAccumulator::MaxCount;
+constexpr size_t ShardedAccumulatorArray::CacheLineSize;
+
+void RunAccumulator::merge( const RunAccumulator &other )
+{
+  uint32_t other_count = other.count();
+  if ( other_count == 0 ) return;
+  uint32_t count = this->count();
+  if ( count == 0 || other.min_ < min_ ) min_ = other.min_;
+  if ( other.max_ > max_ ) max_ = other.max_;
+  setCount( MaxCount - count < other_count ? MaxCount : count + other_count );
+  sum_ += other.sum_;
+  sum_squares_ += other.sum_squares_;
+}
+
+double RunAccumulator::mean() const
+{
+  uint32_t count = this->count();
+  return count == 0 ? 0 : static_cast<double>(sum_) / count;
+}
+
+double RunAccumulator::variance() const
+{
+  uint32_t count = this->count();
+  if ( count < 2 ) return 0;
+  double variance = (sum_squares_ - static_cast<double>(sum_) * mean()) / (count - 1);
+  // Rounding errors may make the variance of almost constant runs slightly negative
+  return variance < 0 ? 0 : variance;
+}
+
+RunStatistics RunAccumulator::statistics() const
+{
+  RunStatistics result;
+  result.count = result.total_count = count();
+  if ( result.count == 0 ) return result;
+  result.sum = sum_;
+  result.min = min();
+  result.max = max();
+  result.mean = mean();
+  result.variance = variance();
+  return result;
+}
+
+std::string RunAccumulator::toString( const std::string &name, TimerBase::TimeUnit print_time_unit ) const
+{
+  return TimerBase::formatStatistics( name, statistics(), RunStatistics(), RunPercentiles(), RunPercentiles(),
+                                      print_time_unit );
+}
+
+ShardedAccumulatorArray::ShardedAccumulatorArray( std::string name, size_t size, TimerBase::TimeUnit print_time_unit )
+  : name_( std::move( name )), size_( size ), print_time_unit_( print_time_unit )
+{
+}
+
+RunAccumulator *ShardedAccumulatorArray::localShard()
+{
+  std::thread::id id = std::this_thread::get_id();
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  for ( auto &shard : shards_ )
+  {
+    if ( shard.thread_id == id ) return shard.accumulators;
+  }
+  // new does not guarantee alignments larger than the fundamental alignment before C++17, hence, the memory is aligned
+  //  manually and padded, so the next allocation can not share the last cache line.
+  size_t bytes = (size_ * sizeof( RunAccumulator ) + CacheLineSize - 1) / CacheLineSize * CacheLineSize;
+  std::unique_ptr<char[]> memory( new char[bytes + CacheLineSize] );
+  uintptr_t address = reinterpret_cast<uintptr_t>(memory.get());
+  address = (address + CacheLineSize - 1) / CacheLineSize * CacheLineSize;
+  RunAccumulator *accumulators = reinterpret_cast<RunAccumulator *>(address);
+  for ( size_t i = 0; i < size_; ++i ) new( accumulators + i ) RunAccumulator();
+  shards_.push_back( Shard{ id, std::move( memory ), accumulators } );
+  return accumulators;
+}
+
+size_t ShardedAccumulatorArray::shardCount() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  return shards_.size();
+}
+
+RunAccumulator ShardedAccumulatorArray::merged( size_t index ) const
+{
+  RunAccumulator result;
+  if ( index >= size_ ) return result;
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  for ( auto &shard : shards_ ) result.merge( shard.accumulators[index] );
+  return result;
+}
+
+void ShardedAccumulatorArray::clear()
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  for ( auto &shard : shards_ )
+  {
+    for ( size_t i = 0; i < size_; ++i ) shard.accumulators[i].clear();
+  }
+}
+
+std::string ShardedAccumulatorArray::toString( size_t index ) const
+{
+  return merged( index ).toString( name_ + "[" + std::to_string( index ) + "]", print_time_unit_ );
+}
+
+std::string ShardedAccumulatorArray::toString() const
+{
+  std::ostringstream result;
+  bool first = true;
+  for ( size_t i = 0; i < size_; ++i )
+  {
+    RunAccumulator accumulator = merged( i );
+    if ( accumulator.count() == 0 ) continue;
+    if ( !first ) result << std::endl;
+    first = false;
+    result << accumulator.toString( name_ + "[" + std::to_string( i ) + "]", print_time_unit_ );
+  }
+  return result.str();
+}
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ShardedAccumulatorArray &array )
+{
+  return stream << array.toString();
+}
@@ -0,0 +1,75 @@
+// Interposes the allocation functions of the C library to count the allocations of the running timers.
+// Built as the separate hector_timeit_alloc_hooks library, since every allocation of a process that links it is
+//  routed through these functions. See AllocationTracker.
+
+#include "hector_timeit/allocation_tracker.h"
+
+#include <cerrno>
+#include <cstddef>
+
+#ifdef __GLIBC__
+
+extern "C"
+{
+// The implementations of glibc which are called after recording the allocation
+void *__libc_malloc( size_t size );
+void *__libc_calloc( size_t count, size_t size );
+void *__libc_realloc( void *ptr, size_t size );
+void *__libc_memalign( size_t alignment, size_t size );
+void __libc_free( void *ptr );
+
+void *malloc( size_t size )
+{
+  hector_timeit::AllocationTracker::record( size );
+  return __libc_malloc( size );
+}
+
+void *calloc( size_t count, size_t size )
+{
+  hector_timeit::AllocationTracker::record( count * size );
+  return __libc_calloc( count, size );
+}
+
+void *realloc( void *ptr, size_t size )
+{
+  hector_timeit::AllocationTracker::record( size );
+  return __libc_realloc( ptr, size );
+}
+
+void *memalign( size_t alignment, size_t size )
+{
+  hector_timeit::AllocationTracker::record( size );
+  return __libc_memalign( alignment, size );
+}
+
+void *aligned_alloc( size_t alignment, size_t size )
+{
+  hector_timeit::AllocationTracker::record( size );
+  return __libc_memalign( alignment, size );
+}
+
+int posix_memalign( void **ptr, size_t alignment, size_t size )
+{
+  if ( alignment % sizeof( void * ) != 0 || (alignment & (alignment - 1)) != 0 ) return EINVAL;
+  hector_timeit::AllocationTracker::record( size );
+  void *result = __libc_memalign( alignment, size );
+  if ( result == nullptr ) return ENOMEM;
+  *ptr = result;
+  return 0;
+}
+
+void free( void *ptr )
+{
+  __libc_free( ptr );
+}
+}
+
+namespace
+{
+struct EnableTracker
+{
+  EnableTracker() { hector_timeit::AllocationTracker::setEnabled( true ); }
+} enable_tracker;
+}
+
+#endif
@@ -0,0 +1,8 @@
+#include "hector_timeit/allocation_tracker.h"
+
+namespace hector_timeit
+{
+
+std::atomic<bool> AllocationTracker::enabled_( false );
+thread_local AllocationCounts *AllocationTracker::current_ = nullptr;
+}
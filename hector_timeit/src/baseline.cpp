@@ -0,0 +1,299 @@
+#include "hector_timeit/baseline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+namespace hector_timeit
+{
+
+constexpr uint32_t Baseline::Version;
+
+namespace
+{
+const char Magic[8] = { 'H', 'T', 'B', 'A', 'S', 'E', '\0', '\0' };
+//! Limits the runs of a loaded baseline (2GB of run times), so corrupt counts are rejected instead of allocated.
+const uint64_t MaxRunCount = 1ULL << 28;
+
+void writeVarint( std::string &data, uint64_t value )
+{
+  while ( value >= 0x80 )
+  {
+    data.push_back( static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  data.push_back( static_cast<char>(value));
+}
+
+bool readVarint( const char *&it, const char *end, uint64_t &value )
+{
+  value = 0;
+  for ( int shift = 0; it < end && shift < 64; shift += 7 )
+  {
+    unsigned char byte = static_cast<unsigned char>(*it++);
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0 ) return true;
+  }
+  return false;
+}
+
+double median( const std::vector<long> &sorted )
+{
+  if ( sorted.empty()) return 0;
+  size_t middle = sorted.size() / 2;
+  if ( sorted.size() % 2 == 1 ) return sorted[middle];
+  return (static_cast<double>(sorted[middle - 1]) + sorted[middle]) / 2;
+}
+
+//! Evenly spaced order statistics of the sorted values, i.e., a subsample with the same distribution.
+std::vector<long> thin( const std::vector<long> &sorted, size_t max_size )
+{
+  if ( sorted.size() <= max_size || max_size == 0 ) return sorted;
+  std::vector<long> result( max_size );
+  for ( size_t i = 0; i < max_size; ++i ) result[i] = sorted[(2 * i + 1) * sorted.size() / (2 * max_size)];
+  return result;
+}
+
+double resampledMedian( const std::vector<long> &values, std::mt19937_64 &generator, std::vector<long> &buffer )
+{
+  std::uniform_int_distribution<size_t> distribution( 0, values.size() - 1 );
+  buffer.resize( values.size());
+  for ( long &value : buffer ) value = values[distribution( generator )];
+  size_t middle = buffer.size() / 2;
+  std::nth_element( buffer.begin(), buffer.begin() + middle, buffer.end());
+  if ( buffer.size() % 2 == 1 ) return buffer[middle];
+  long upper = buffer[middle];
+  long lower = *std::max_element( buffer.begin(), buffer.begin() + middle );
+  return (static_cast<double>(lower) + upper) / 2;
+}
+
+std::string formatPercent( double value )
+{
+  std::ostringstream stream;
+  stream << std::showpos << std::fixed << std::setprecision( 1 ) << value * 100 << "%";
+  return stream.str();
+}
+}
+
+Baseline::Baseline( std::string name, const std::vector<long> &run_times ) : name_( std::move( name ))
+{
+  run_times_.reserve( run_times.size());
+  for ( long time : run_times )
+  {
+    if ( time >= 0 ) run_times_.push_back( time );
+  }
+  std::sort( run_times_.begin(), run_times_.end());
+}
+
+Baseline Baseline::fromTimer( const TimerBase &timer )
+{
+  if ( timer.runStorage() != TimerBase::HistogramStorage ) return Baseline( timer.name(), timer.getFinishedRunTimes());
+  const Histogram &histogram = timer.getRunHistogram();
+  std::vector<long> run_times;
+  run_times.reserve( histogram.count());
+  for ( size_t i = 0; i < histogram.bucketCount(); ++i )
+  {
+    size_t count = histogram.bucketValueCount( i );
+    if ( count == 0 ) continue;
+    long lower = histogram.bucketLowerBound( i );
+    long center = lower + (histogram.bucketUpperBound( i ) - lower) / 2;
+    run_times.insert( run_times.end(), count, center );
+  }
+  return Baseline( timer.name(), run_times );
+}
+
+bool Baseline::save( const std::string &path ) const
+{
+  std::string data( Magic, sizeof( Magic ));
+  for ( size_t i = 0; i < 4; ++i ) data.push_back( static_cast<char>((Version >> (8 * i)) & 0xFF));
+  writeVarint( data, name_.size());
+  data += name_;
+  size_t distinct = 0;
+  for ( size_t i = 0; i < run_times_.size(); ++i )
+  {
+    if ( i == 0 || run_times_[i] != run_times_[i - 1] ) ++distinct;
+  }
+  writeVarint( data, distinct );
+  long previous = 0;
+  for ( size_t i = 0; i < run_times_.size(); )
+  {
+    size_t j = i;
+    while ( j < run_times_.size() && run_times_[j] == run_times_[i] ) ++j;
+    writeVarint( data, static_cast<uint64_t>(run_times_[i] - previous));
+    writeVarint( data, j - i );
+    previous = run_times_[i];
+    i = j;
+  }
+  std::ofstream stream( path, std::ios::binary | std::ios::trunc );
+  stream.write( data.data(), static_cast<std::streamsize>(data.size()));
+  return static_cast<bool>(stream);
+}
+
+bool Baseline::load( const std::string &path, Baseline &baseline, std::string &error )
+{
+  std::ifstream stream( path, std::ios::binary );
+  if ( !stream )
+  {
+    error = "Could not open " + path;
+    return false;
+  }
+  std::string content(( std::istreambuf_iterator<char>( stream )), std::istreambuf_iterator<char>());
+  if ( content.size() < sizeof( Magic ) + 4 || std::memcmp( content.data(), Magic, sizeof( Magic )) != 0 )
+  {
+    error = "Not a hector_timeit baseline file";
+    return false;
+  }
+  uint32_t version = 0;
+  for ( size_t i = 0; i < 4; ++i )
+    version |= static_cast<uint32_t>(static_cast<unsigned char>(content[sizeof( Magic ) + i])) << (8 * i);
+  if ( version != Version )
+  {
+    error = "Unsupported baseline file version " + std::to_string( version );
+    return false;
+  }
+  const char *it = content.data() + sizeof( Magic ) + 4;
+  const char *end = content.data() + content.size();
+  uint64_t name_length, distinct;
+  if ( !readVarint( it, end, name_length ) || name_length > static_cast<uint64_t>(end - it))
+  {
+    error = "Baseline file is truncated";
+    return false;
+  }
+  Baseline result;
+  result.name_.assign( it, name_length );
+  it += name_length;
+  if ( !readVarint( it, end, distinct ))
+  {
+    error = "Baseline file is truncated";
+    return false;
+  }
+  uint64_t value = 0;
+  for ( uint64_t i = 0; i < distinct; ++i )
+  {
+    uint64_t delta, count;
+    if ( !readVarint( it, end, delta ) || !readVarint( it, end, count ))
+    {
+      error = "Baseline file is truncated";
+      return false;
+    }
+    if ( count > MaxRunCount - result.run_times_.size())
+    {
+      error = "Baseline file is corrupt, it contains more than " + std::to_string( MaxRunCount ) + " runs";
+      return false;
+    }
+    value += delta;
+    result.run_times_.insert( result.run_times_.end(), count, static_cast<long>(value));
+  }
+  baseline = std::move( result );
+  return true;
+}
+
+Comparison compare( const Baseline &baseline, const std::vector<long> &run_times, const ComparisonOptions &options )
+{
+  Comparison result;
+  result.name = baseline.name();
+  result.confidence = options.confidence;
+  result.alpha = options.alpha;
+  result.threshold = options.threshold;
+  const std::vector<long> &reference = baseline.runTimes();
+  std::vector<long> current;
+  current.reserve( run_times.size());
+  for ( long time : run_times )
+  {
+    if ( time >= 0 ) current.push_back( time );
+  }
+  std::sort( current.begin(), current.end());
+  result.baseline_count = reference.size();
+  result.current_count = current.size();
+  if ( reference.empty() || current.empty()) return result;
+
+  const double baseline_median = median( reference );
+  result.baseline_median = static_cast<long>(baseline_median);
+  result.current_median = static_cast<long>(median( current ));
+  if ( baseline_median > 0 ) result.relative_change = median( current ) / baseline_median - 1;
+
+  // Mann-Whitney U: Rank the merged runs assigning ties their average rank and sum the ranks of the current runs
+  const double n1 = reference.size(), n2 = current.size(), n = n1 + n2;
+  double rank_sum = 0;
+  double tie_sum = 0;
+  size_t i = 0, j = 0;
+  double rank = 1;
+  while ( i < reference.size() || j < current.size())
+  {
+    long value = j == current.size() || (i < reference.size() && reference[i] < current[j]) ? reference[i] : current[j];
+    size_t count_reference = 0, count_current = 0;
+    while ( i < reference.size() && reference[i] == value ) ++i, ++count_reference;
+    while ( j < current.size() && current[j] == value ) ++j, ++count_current;
+    double ties = count_reference + count_current;
+    rank_sum += count_current * (rank + (ties - 1) / 2);
+    tie_sum += ties * ties * ties - ties;
+    rank += ties;
+  }
+  result.u = rank_sum - n2 * (n2 + 1) / 2;
+  const double mean = n1 * n2 / 2;
+  const double variance = n1 * n2 / 12 * ((n + 1) - tie_sum / (n * (n - 1)));
+  if ( variance > 0 )
+  {
+    // Continuity correction towards the mean
+    double difference = result.u - mean;
+    difference -= difference > 0 ? 0.5 : (difference < 0 ? -0.5 : 0);
+    result.z = difference / std::sqrt( variance );
+    result.p_value = std::erfc( std::abs( result.z ) / std::sqrt( 2.0 ));
+  }
+
+  // Percentile bootstrap of the relative change of the median. Seeded with a constant so it is reproducible
+  result.ci_lower = result.ci_upper = result.relative_change;
+  if ( options.bootstrap_resamples == 0 || baseline_median <= 0 ) return result;
+  std::vector<long> reference_sample = thin( reference, options.max_bootstrap_runs );
+  std::vector<long> current_sample = thin( current, options.max_bootstrap_runs );
+  std::mt19937_64 generator( 42 );
+  std::vector<long> buffer;
+  std::vector<double> changes;
+  changes.reserve( options.bootstrap_resamples );
+  for ( size_t k = 0; k < options.bootstrap_resamples; ++k )
+  {
+    double resampled_baseline = resampledMedian( reference_sample, generator, buffer );
+    double resampled_current = resampledMedian( current_sample, generator, buffer );
+    if ( resampled_baseline > 0 ) changes.push_back( resampled_current / resampled_baseline - 1 );
+  }
+  if ( changes.empty()) return result;
+  std::sort( changes.begin(), changes.end());
+  double tail = (1 - options.confidence) / 2;
+  result.ci_lower = changes[static_cast<size_t>(tail * (changes.size() - 1))];
+  result.ci_upper = changes[static_cast<size_t>(std::ceil((1 - tail) * (changes.size() - 1)))];
+  return result;
+}
+
+Comparison compare( const Baseline &baseline, const TimerBase &timer, const ComparisonOptions &options )
+{
+  return compare( baseline, Baseline::fromTimer( timer ).runTimes(), options );
+}
+
+std::string Comparison::toString() const
+{
+  std::ostringstream stringstream;
+  stringstream << "[Comparison: " << name << "] ";
+  if ( baseline_count == 0 || current_count == 0 )
+  {
+    stringstream << "no runs to compare (baseline: " << baseline_count << ", current: " << current_count << ").";
+    return stringstream.str();
+  }
+  stringstream << (regression() ? "REGRESSION" : "passed") << ": median " << TimerBase::formatTime( baseline_median )
+               << " -> " << TimerBase::formatTime( current_median ) << " (" << formatPercent( relative_change ) << ", "
+               << std::round( confidence * 100 ) << "% CI: [" << formatPercent( ci_lower ) << ", "
+               << formatPercent( ci_upper ) << "]), p = " << std::setprecision( 3 ) << p_value
+               << (significant() ? " (significant)" : " (not significant)") << ", threshold: "
+               << formatPercent( threshold ) << ", runs: " << baseline_count << " -> " << current_count;
+  return stringstream.str();
+}
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::Comparison &comparison )
+{
+  return stream << comparison.toString();
+}
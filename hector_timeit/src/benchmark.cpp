@@ -0,0 +1,380 @@
+#include "hector_timeit/benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace hector_timeit
+{
+
+namespace
+{
+constexpr size_t GranularitySamples = 1000;
+//! The number of back-to-back reads per sample of the read cost.
+constexpr int GranularityReads = 16;
+constexpr long GranularityFactor = 1000;
+//! The batch size is grown by at most this factor per warmup batch to avoid overshooting on a noisy estimate.
+constexpr double MaxBatchGrowth = 10;
+
+long elapsedSince( WallClock::time_point start )
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>( WallClock::now() - start ).count();
+}
+
+double quantile( const std::vector<double> &sorted, double q )
+{
+  if ( sorted.empty()) return 0;
+  double index = q * (sorted.size() - 1);
+  size_t lower = static_cast<size_t>(index);
+  if ( lower + 1 >= sorted.size()) return sorted.back();
+  double fraction = index - lower;
+  return sorted[lower] + fraction * (sorted[lower + 1] - sorted[lower]);
+}
+
+//! The two-sided quantile of the standard normal distribution for the given confidence.
+double normalQuantile( double confidence )
+{
+  // erf is monotonic, hence, bisect erf(z / sqrt(2)) = confidence
+  double lower = 0, upper = 10;
+  for ( int i = 0; i < 64; ++i )
+  {
+    double z = (lower + upper) / 2;
+    if ( std::erf( z / std::sqrt( 2.0 )) < confidence ) lower = z;
+    else upper = z;
+  }
+  return (lower + upper) / 2;
+}
+
+const char *stopReasonString( BenchmarkResult::StopReason reason )
+{
+  switch ( reason )
+  {
+    case BenchmarkResult::TargetErrorReached:
+      return "target error reached";
+    case BenchmarkResult::TimeBudgetExhausted:
+      return "time budget exhausted";
+    case BenchmarkResult::MaxSamplesReached:
+      return "max samples reached";
+  }
+  return "unknown";
+}
+
+bool pinToCore( unsigned index )
+{
+#ifdef __linux__
+  unsigned cores = std::max( 1U, std::thread::hardware_concurrency());
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( index % cores, &set );
+  return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#else
+  (void) index;
+  return false;
+#endif
+}
+
+ScalingStep runScalingStep( const std::function<void( Timer &, long )> &thread_function, long count, unsigned threads,
+                            bool pin_threads )
+{
+  std::vector<std::unique_ptr<Timer>> timers;
+  for ( unsigned i = 0; i < threads; ++i )
+    timers.emplace_back( new Timer( "thread " + std::to_string( i ), TimerBase::Default, false ));
+  std::vector<WallClock::time_point> ends( threads );
+  std::atomic<unsigned> ready{ 0 };
+  std::atomic<unsigned> pinned{ 0 };
+  std::atomic<bool> go{ false };
+  std::vector<std::thread> workers;
+  workers.reserve( threads );
+  for ( unsigned i = 0; i < threads; ++i )
+  {
+    workers.emplace_back( [ &, i ]()
+    {
+      if ( pin_threads && pinToCore( i )) pinned.fetch_add( 1 );
+      // Barrier: Spin until all threads are ready so they run concurrently for the whole measurement
+      ready.fetch_add( 1 );
+      while ( !go.load( std::memory_order_acquire )) std::this_thread::yield();
+      thread_function( *timers[i], count );
+      ends[i] = WallClock::now();
+    } );
+  }
+  while ( ready.load() < threads ) std::this_thread::yield();
+  WallClock::time_point start = WallClock::now();
+  go.store( true, std::memory_order_release );
+  for ( auto &worker : workers ) worker.join();
+
+  ScalingStep step;
+  step.threads = threads;
+  step.wall_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    *std::max_element( ends.begin(), ends.end()) - start ).count();
+  step.pinned = pin_threads && pinned.load() == threads;
+  std::vector<long> run_times;
+  for ( const auto &timer : timers )
+  {
+    RunStatistics stats = timer->getRunStatistics();
+    step.run_stats.merge( stats );
+    step.thread_stats.push_back( stats );
+    std::vector<long> thread_run_times = timer->getRunTimes();
+    run_times.insert( run_times.end(), thread_run_times.begin(), thread_run_times.end());
+  }
+  step.run_percentiles = RunPercentiles::fromRunTimes( run_times );
+  return step;
+}
+
+void computeStatistics( BenchmarkResult &result, const BenchmarkOptions &options )
+{
+  const std::vector<double> &samples = result.samples;
+  const size_t n = samples.size();
+  if ( n == 0 ) return;
+  double sum = 0;
+  for ( double sample : samples ) sum += sample;
+  result.mean = sum / n;
+  double squared_sum = 0;
+  for ( double sample : samples ) squared_sum += (sample - result.mean) * (sample - result.mean);
+  result.stddev = n > 1 ? std::sqrt( squared_sum / (n - 1)) : 0;
+
+  std::vector<double> sorted = samples;
+  std::sort( sorted.begin(), sorted.end());
+  result.median = quantile( sorted, 0.5 );
+  double q1 = quantile( sorted, 0.25 );
+  double q3 = quantile( sorted, 0.75 );
+  double iqr = q3 - q1;
+  result.outliers.resize( n );
+  for ( size_t i = 0; i < n; ++i )
+  {
+    double sample = samples[i];
+    if ( sample < q1 - 3 * iqr ) result.outliers[i] = BenchmarkResult::LowSevere;
+    else if ( sample < q1 - 1.5 * iqr ) result.outliers[i] = BenchmarkResult::LowMild;
+    else if ( sample > q3 + 3 * iqr ) result.outliers[i] = BenchmarkResult::HighSevere;
+    else if ( sample > q3 + 1.5 * iqr ) result.outliers[i] = BenchmarkResult::HighMild;
+    else result.outliers[i] = BenchmarkResult::NoOutlier;
+  }
+
+  // Percentile bootstrap of the mean. Seeded with a constant so the interval is reproducible for the same samples
+  result.confidence = options.confidence;
+  if ( options.bootstrap_resamples == 0 || n < 2 )
+  {
+    result.ci_lower = result.ci_upper = result.mean;
+    return;
+  }
+  std::mt19937_64 generator( 42 );
+  std::uniform_int_distribution<size_t> distribution( 0, n - 1 );
+  std::vector<double> means( options.bootstrap_resamples );
+  for ( double &mean : means )
+  {
+    double resample_sum = 0;
+    for ( size_t i = 0; i < n; ++i ) resample_sum += samples[distribution( generator )];
+    mean = resample_sum / n;
+  }
+  std::sort( means.begin(), means.end());
+  double alpha = (1 - options.confidence) / 2;
+  result.ci_lower = quantile( means, alpha );
+  result.ci_upper = quantile( means, 1 - alpha );
+}
+}
+
+double BenchmarkResult::relativeError() const
+{
+  if ( mean == 0 ) return 0;
+  return (ci_upper - ci_lower) / 2 / mean;
+}
+
+size_t BenchmarkResult::outlierCount( Outlier type ) const
+{
+  return static_cast<size_t>(std::count( outliers.begin(), outliers.end(), type ));
+}
+
+std::string BenchmarkResult::toString( TimerBase::TimeUnit print_time_unit ) const
+{
+  std::ostringstream stringstream;
+  stringstream << "[Benchmark: " << name << "] " << samples.size() << " sample(s) of " << batch_size
+               << " iteration(s) (" << stopReasonString( stop_reason ) << ")";
+  if ( samples.empty()) return stringstream.str();
+  stringstream << std::endl << "Per iteration: " << TimerBase::formatTime( mean, print_time_unit ) << " ["
+               << TimerBase::formatTime( ci_lower, print_time_unit ) << ", "
+               << TimerBase::formatTime( ci_upper, print_time_unit ) << "] (" << std::round( confidence * 100 )
+               << "% CI, +- " << std::round( relativeError() * 1000 ) / 10 << "%), median: "
+               << TimerBase::formatTime( median, print_time_unit ) << ", stddev: "
+               << TimerBase::formatTime( stddev, print_time_unit );
+  size_t low_mild = outlierCount( LowMild ), low_severe = outlierCount( LowSevere );
+  size_t high_mild = outlierCount( HighMild ), high_severe = outlierCount( HighSevere );
+  size_t total = low_mild + low_severe + high_mild + high_severe;
+  if ( total != 0 )
+  {
+    stringstream << std::endl << "Outliers: " << total << " (" << std::round( 1000.0 * total / samples.size()) / 10
+                 << "%): " << low_severe << " low severe, " << low_mild << " low mild, " << high_mild << " high mild, "
+                 << high_severe << " high severe";
+  }
+  return stringstream.str();
+}
+
+double ScalingStep::throughput() const
+{
+  if ( wall_time <= 0 ) return 0;
+  return run_stats.total_count * 1E9 / wall_time;
+}
+
+double ScalingResult::speedup( const ScalingStep &step ) const
+{
+  for ( const auto &single : steps )
+  {
+    if ( single.threads != 1 ) continue;
+    double baseline = single.throughput();
+    return baseline == 0 ? 0 : step.throughput() / baseline;
+  }
+  return 0;
+}
+
+double ScalingResult::efficiency( const ScalingStep &step ) const
+{
+  return step.threads == 0 ? 0 : speedup( step ) / step.threads;
+}
+
+std::string ScalingResult::toString( TimerBase::TimeUnit print_time_unit ) const
+{
+  std::ostringstream stringstream;
+  stringstream << "[Scaling: " << name << "] " << count << " run(s) per thread took:" << std::endl;
+  stringstream << "Threads       Throughput         Average             p99         Longest     Speedup  Efficiency";
+  for ( const auto &step : steps )
+  {
+    std::ostringstream throughput;
+    throughput << std::fixed << std::setprecision( 1 ) << step.throughput() << "/s";
+    stringstream << std::endl << std::setw( 7 ) << step.threads << (step.pinned ? "*" : " ")
+                 << std::setw( 16 ) << throughput.str()
+                 << std::setw( 16 ) << TimerBase::formatTime( step.run_stats.mean, print_time_unit )
+                 << std::setw( 16 ) << TimerBase::formatTime( step.run_percentiles.p99, print_time_unit )
+                 << std::setw( 16 ) << TimerBase::formatTime( step.run_stats.max, print_time_unit )
+                 << std::fixed << std::setprecision( 2 ) << std::setw( 11 ) << speedup( step ) << "x"
+                 << std::setw( 11 ) << std::setprecision( 1 ) << efficiency( step ) * 100 << "%"
+                 << std::defaultfloat;
+  }
+  bool any_pinned = false;
+  for ( const auto &step : steps ) any_pinned |= step.pinned;
+  if ( any_pinned ) stringstream << std::endl << "* Threads pinned to cores";
+  return stringstream.str();
+}
+
+ScalingResult Benchmark::runScalingThreads( const std::string &name,
+                                            const std::function<void( Timer &, long )> &thread_function, long count,
+                                            const ScalingOptions &options )
+{
+  ScalingResult result;
+  result.name = name;
+  result.count = count;
+  unsigned max_threads = options.max_threads != 0 ? options.max_threads
+                                                  : std::max( 1U, std::thread::hardware_concurrency());
+  for ( unsigned threads = 1;; threads *= 2 )
+  {
+    if ( threads > max_threads ) threads = max_threads;
+    result.steps.push_back( runScalingStep( thread_function, count, threads, options.pin_threads ));
+    if ( threads == max_threads ) break;
+  }
+  return result;
+}
+
+long Benchmark::clockGranularity()
+{
+  std::vector<long> read_times;
+  read_times.reserve( GranularitySamples );
+  long resolution = 0;
+  for ( size_t i = 0; i < GranularitySamples; ++i )
+  {
+    WallClock::time_point start = WallClock::now();
+    WallClock::time_point end = WallClock::now();
+    // Spin until the clock ticks to obtain the resolution
+    while ( end == start ) end = WallClock::now();
+    long difference = std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
+    if ( resolution == 0 || difference < resolution ) resolution = difference;
+    // The cost of a read is averaged over back-to-back reads, so it isn't rounded up to the resolution
+    start = WallClock::now();
+    for ( int k = 0; k < GranularityReads; ++k ) end = WallClock::now();
+    long reads_time = std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
+    read_times.push_back( reads_time / GranularityReads );
+  }
+  std::nth_element( read_times.begin(), read_times.begin() + read_times.size() / 2, read_times.end());
+  return std::max( resolution, read_times[read_times.size() / 2] );
+}
+
+BenchmarkResult Benchmark::runBatches( const std::string &name, const std::function<void( size_t )> &batch,
+                                       const BenchmarkOptions &options )
+{
+  BenchmarkResult result;
+  result.name = name;
+  const WallClock::time_point benchmark_start = WallClock::now();
+  const long min_sample_time =
+    options.min_sample_time > 0 ? options.min_sample_time : GranularityFactor * clockGranularity();
+
+  // Warmup: Grow the batch until a single batch takes at least the minimum sample time
+  size_t batch_size = 1;
+  while ( true )
+  {
+    WallClock::time_point start = WallClock::now();
+    batch( batch_size );
+    long elapsed = elapsedSince( start );
+    long total = elapsedSince( benchmark_start );
+    if ( elapsed < min_sample_time )
+    {
+      if ( total >= options.time_budget ) break;
+      double growth = elapsed <= 0 ? MaxBatchGrowth : std::min( MaxBatchGrowth, 1.2 * min_sample_time / elapsed );
+      batch_size = std::max<size_t>( batch_size + 1, static_cast<size_t>(std::ceil( batch_size * growth )));
+      continue;
+    }
+    if ( total >= options.warmup_time || total >= options.time_budget ) break;
+  }
+  result.batch_size = batch_size;
+
+  // Sampling: The stop criterion uses the normal approximation which is cheap to update, the reported interval is
+  //  obtained using the bootstrap once sampling stopped
+  const double z = normalQuantile( options.confidence );
+  double mean = 0, m2 = 0;
+  result.samples.reserve( std::min<size_t>( options.max_samples, 1024 ));
+  while ( true )
+  {
+    WallClock::time_point start = WallClock::now();
+    batch( batch_size );
+    double sample = static_cast<double>(elapsedSince( start )) / batch_size;
+    result.samples.push_back( sample );
+    // Welford's online algorithm
+    const size_t n = result.samples.size();
+    double delta = sample - mean;
+    mean += delta / n;
+    m2 += delta * (sample - mean);
+
+    if ( n >= options.max_samples )
+    {
+      result.stop_reason = BenchmarkResult::MaxSamplesReached;
+      break;
+    }
+    if ( n >= options.min_samples && n > 1 && mean > 0 &&
+         z * std::sqrt( m2 / (n - 1) / n ) / mean <= options.target_relative_error )
+    {
+      result.stop_reason = BenchmarkResult::TargetErrorReached;
+      break;
+    }
+    if ( n >= options.min_samples && elapsedSince( benchmark_start ) >= options.time_budget )
+    {
+      result.stop_reason = BenchmarkResult::TimeBudgetExhausted;
+      break;
+    }
+  }
+  computeStatistics( result, options );
+  return result;
+}
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::BenchmarkResult &result )
+{
+  return stream << result.toString();
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ScalingResult &result )
+{
+  return stream << result.toString();
+}
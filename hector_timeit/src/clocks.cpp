@@ -0,0 +1,90 @@
+#include "hector_timeit/clocks.h"
+
+#include <cmath>
+#include <limits>
+#include <time.h>
+
+#ifdef HECTOR_TIMEIT_HAS_TSC
+#include <cpuid.h>
+#endif
+
+namespace hector_timeit
+{
+
+constexpr bool TscClock::is_steady;
+constexpr bool WallClock::is_steady;
+constexpr bool ThreadCpuClock::enabled;
+constexpr bool NoCpuClock::enabled;
+
+std::atomic<int> WallClock::source_( WallClock::HighResolutionClock );
+
+namespace detail
+{
+#ifdef HECTOR_TIMEIT_HAS_TSC
+namespace
+{
+bool hasInvariantTsc()
+{
+  unsigned int eax, ebx, ecx, edx;
+  if ( __get_cpuid_max( 0x80000000, nullptr ) < 0x80000007 ) return false;
+  // RDTSCP support
+  if ( !__get_cpuid( 0x80000001, &eax, &ebx, &ecx, &edx ) || (edx & (1U << 27)) == 0 ) return false;
+  // Invariant TSC, i.e., constant rate and not stopped in deep C-states
+  if ( !__get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx )) return false;
+  return (edx & (1U << 8)) != 0;
+}
+
+long long monotonicNanoseconds()
+{
+  struct timespec spec;
+  clock_gettime( CLOCK_MONOTONIC, &spec );
+  return spec.tv_sec * 1000LL * 1000LL * 1000LL + spec.tv_nsec;
+}
+
+/*!
+ * Reads the TSC and CLOCK_MONOTONIC as close together as possible by using the sample with the smallest number of
+ *  ticks around the clock_gettime call.
+ */
+void sampleClocks( unsigned long long &ticks, long long &nanoseconds )
+{
+  unsigned int aux;
+  unsigned long long best_window = std::numeric_limits<unsigned long long>::max();
+  for ( int i = 0; i < 16; ++i )
+  {
+    unsigned long long before = __rdtscp( &aux );
+    long long time = monotonicNanoseconds();
+    unsigned long long after = __rdtscp( &aux );
+    if ( after - before >= best_window ) continue;
+    best_window = after - before;
+    ticks = before + best_window / 2;
+    nanoseconds = time;
+  }
+}
+}
+#endif
+
+TscCalibration TscCalibration::calibrate()
+{
+  TscCalibration result;
+#ifdef HECTOR_TIMEIT_HAS_TSC
+  if ( !hasInvariantTsc()) return result;
+  unsigned long long start_ticks = 0, end_ticks = 0;
+  long long start_nanoseconds = 0, end_nanoseconds = 0;
+  sampleClocks( start_ticks, start_nanoseconds );
+  struct timespec sleep_time = { 0, 20 * 1000 * 1000 };
+  nanosleep( &sleep_time, nullptr );
+  sampleClocks( end_ticks, end_nanoseconds );
+  if ( end_ticks <= start_ticks || end_nanoseconds <= start_nanoseconds ) return result;
+
+  double ticks = end_ticks - start_ticks;
+  double nanoseconds = end_nanoseconds - start_nanoseconds;
+  result.usable = true;
+  result.tsc_base = start_ticks;
+  result.nanoseconds_base = start_nanoseconds;
+  result.multiplier = static_cast<unsigned long long>(std::llround( nanoseconds / ticks * 4294967296.0 ));
+  result.ticks_per_nanosecond = ticks / nanoseconds;
+#endif
+  return result;
+}
+}
+}
@@ -58,6 +58,20 @@ int main( int, char ** )
     }
     timer.stop();
 
+    // Timer with an overhead that is calibrated once instead of sampling every clock twice
+    fibonacci_a = 1;
+    fibonacci_b = 2;
+    hector_timeit::CalibratedTimer calibrated_timer( "CalibratedAccuracyTimer" );
+    for ( long i = 0; i < iterations; ++i )
+    {
+      fibonacci_a = fibonacci_a * fibonacci_a + fibonacci_b * fibonacci_b;
+      fibonacci_b = sqrtl( fibonacci_a + fibonacci_b );
+      asm("");
+      calibrated_timer.stop();
+      calibrated_timer.start();
+    }
+    calibrated_timer.stop();
+
     // Naive approach
     long elapsed = 0;
     fibonacci_a = 1;
@@ -89,17 +103,45 @@ int main( int, char ** )
     long duration = std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
 
     long diff_timer = labs( duration - timer.getElapsedTime());
+    long diff_calibrated = labs( duration - calibrated_timer.getElapsedTime());
     long diff_naive = labs( duration - elapsed );
+    hector_timeit::ClockOverhead overhead = hector_timeit::CalibratedCompensation::overhead<
+      hector_timeit::WallClock, hector_timeit::ThreadCpuClock>();
     std::cout << "Timer:  " << timer.getElapsedTime() << "ns" << std::endl;
+    std::cout << "Calibrated: " << calibrated_timer.getElapsedTime() << "ns (Overhead per run: " << overhead.wall
+              << "ns, Thread: " << overhead.cpu << "ns)" << std::endl;
     std::cout << "Naive:  " << elapsed << "ns" << std::endl;
     std::cout << "Chrono: " << duration << "ns" << std::endl;
     std::cout << "Difference Timer: " << diff_timer << " (" << fabs((diff_timer * 1.0 / duration)) * 100 << "%)"
               << std::endl;
+    std::cout << "Difference Calibrated: " << diff_calibrated << " ("
+              << fabs((diff_calibrated * 1.0 / duration)) * 100 << "%)" << std::endl;
     std::cout << "Difference Naive: " << diff_naive << " (" << fabs((diff_naive * 1.0 / duration)) * 100 << "%)"
               << std::endl;
     // Could be improved by using averages and accounting for stddev
   }
 
+  {
+    std::cout << std::endl << "Cost of reading the clocks (10^6 iterations)." << std::endl;
+    std::cout << "TSC: " << (hector_timeit::TscClock::usesTsc() ? "invariant, " : "not available, using steady_clock")
+              << (hector_timeit::TscClock::usesTsc() ? std::to_string( hector_timeit::TscClock::frequency() / 1E9 ) + "GHz"
+                                                     : "") << std::endl;
+    constexpr long iterations = 1000 * 1000;
+    HECTOR_TIME_SECTION( HIGH_RESOLUTION_CLOCK );
+    for ( long i = 0; i < iterations; ++i )
+    {
+      std::chrono::high_resolution_clock::now();
+    }
+    HECTOR_TIME_SECTION_END_AND_PRINT( HIGH_RESOLUTION_CLOCK );
+
+    HECTOR_TIME_SECTION( TSC_CLOCK );
+    for ( long i = 0; i < iterations; ++i )
+    {
+      hector_timeit::TscClock::now();
+    }
+    HECTOR_TIME_SECTION_END_AND_PRINT( TSC_CLOCK );
+  }
+
   for (int i = 0; i < 10; ++i) someFunction();
   return 0;
 }
@@ -0,0 +1,110 @@
+#include "hector_timeit/histogram.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace hector_timeit
+{
+
+constexpr int Histogram::DefaultSignificantBits;
+
+Histogram::Histogram( int significant_bits )
+  : linear_bucket_count_( 1ULL << significant_bits ), significant_bits_( significant_bits )
+{
+  if ( significant_bits < 2 || significant_bits > 16 )
+    throw std::invalid_argument( "Histogram: significant_bits has to be in the range [2, 16]!" );
+  // The largest exponent for a positive long is 63 - significant_bits. Each exponent adds half the linear buckets.
+  buckets_.resize((65 - significant_bits) * (linear_bucket_count_ / 2), 0 );
+}
+
+void Histogram::merge( const Histogram &other )
+{
+  if ( other.significant_bits_ != significant_bits_ )
+    throw std::invalid_argument( "Histogram: Can not merge histograms with different number of significant bits!" );
+  invalid_count_ += other.invalid_count_;
+  if ( other.count_ == 0 ) return;
+  for ( size_t i = 0; i < buckets_.size(); ++i ) buckets_[i] += other.buckets_[i];
+  if ( count_ == 0 )
+  {
+    min_ = other.min_;
+    max_ = other.max_;
+    shift_ = other.shift_;
+  }
+  else
+  {
+    min_ = std::min( min_, other.min_ );
+    max_ = std::max( max_, other.max_ );
+  }
+  // Move the other histogram's sums to our shift
+  double offset = static_cast<double>(other.shift_ - shift_);
+  shifted_sum_squares_ += other.shifted_sum_squares_ + 2 * offset * other.shifted_sum_ + other.count_ * offset * offset;
+  shifted_sum_ += other.shifted_sum_ + other.count_ * offset;
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+void Histogram::clear()
+{
+  std::fill( buckets_.begin(), buckets_.end(), 0 );
+  count_ = 0;
+  invalid_count_ = 0;
+  sum_ = 0;
+  min_ = 0;
+  max_ = 0;
+  shift_ = 0;
+  shifted_sum_ = 0;
+  shifted_sum_squares_ = 0;
+}
+
+RunStatistics Histogram::statistics() const
+{
+  RunStatistics result;
+  result.count = count_;
+  result.total_count = count_ + invalid_count_;
+  result.sum = sum_;
+  result.min = min_;
+  result.max = max_;
+  if ( count_ == 0 ) return result;
+  result.mean = (double) sum_ / count_;
+  // Same as RunStatistics, the variance of a single run is 0
+  if ( count_ < 2 ) return result;
+  result.variance = (shifted_sum_squares_ - shifted_sum_ * shifted_sum_ / count_) / (count_ - 1);
+  if ( result.variance < 0 ) result.variance = 0;
+  return result;
+}
+
+long Histogram::bucketLowerBound( size_t index ) const
+{
+  if ( index < linear_bucket_count_ ) return static_cast<long>(index);
+  int exponent = static_cast<int>(index >> (significant_bits_ - 1)) - 1;
+  unsigned long long sub_bucket = index - (static_cast<unsigned long long>(exponent) << (significant_bits_ - 1));
+  return static_cast<long>(sub_bucket << exponent);
+}
+
+long Histogram::bucketUpperBound( size_t index ) const
+{
+  if ( index < linear_bucket_count_ ) return static_cast<long>(index);
+  int exponent = static_cast<int>(index >> (significant_bits_ - 1)) - 1;
+  unsigned long long sub_bucket = index - (static_cast<unsigned long long>(exponent) << (significant_bits_ - 1));
+  return static_cast<long>(((sub_bucket + 1) << exponent) - 1);
+}
+
+long Histogram::valueAtPercentile( double percentile ) const
+{
+  if ( count_ == 0 ) return -1;
+  size_t rank = RunPercentiles::rank( count_, percentile );
+  // The extremes are known exactly
+  if ( rank == 0 ) return min_;
+  if ( rank == count_ - 1 ) return max_;
+  size_t cumulative = 0;
+  for ( size_t i = 0; i < buckets_.size(); ++i )
+  {
+    cumulative += buckets_[i];
+    if ( cumulative <= rank ) continue;
+    long lower = bucketLowerBound( i );
+    long value = lower + (bucketUpperBound( i ) - lower) / 2;
+    return std::max( min_, std::min( max_, value ));
+  }
+  return max_;
+}
+}
@@ -0,0 +1,97 @@
+#include "hector_timeit/latency_budget.h"
+
+#include <cstdint>
+#include <functional>
+#include <thread>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace hector_timeit
+{
+
+constexpr size_t BudgetViolationQueue::DefaultCapacity;
+
+BudgetViolationQueue &BudgetViolationQueue::instance()
+{
+  static BudgetViolationQueue queue;
+  return queue;
+}
+
+BudgetViolationQueue::BudgetViolationQueue( size_t capacity )
+{
+  size_t size = 2;
+  while ( size < capacity ) size <<= 1;
+  slots_.reset( new Slot[size] );
+  mask_ = size - 1;
+  for ( size_t i = 0; i < size; ++i ) slots_[i].sequence.store( i, std::memory_order_relaxed );
+}
+
+bool BudgetViolationQueue::push( const BudgetViolation &violation )
+{
+  size_t position = push_position_.load( std::memory_order_relaxed );
+  for ( ;; )
+  {
+    Slot &slot = slots_[position & mask_];
+    // The slot is free if its sequence equals the position, it still holds the violation of the previous round if the
+    //  sequence is smaller and another producer already claimed it if the sequence is larger
+    intptr_t difference = static_cast<intptr_t>(slot.sequence.load( std::memory_order_acquire ) - position);
+    if ( difference == 0 )
+    {
+      if ( push_position_.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ))
+      {
+        slot.violation = violation;
+        slot.sequence.store( position + 1, std::memory_order_release );
+        return true;
+      }
+    }
+    else if ( difference < 0 )
+    {
+      dropped_.fetch_add( 1, std::memory_order_relaxed );
+      return false;
+    }
+    else
+    {
+      position = push_position_.load( std::memory_order_relaxed );
+    }
+  }
+}
+
+bool BudgetViolationQueue::pop( BudgetViolation &violation )
+{
+  size_t position = pop_position_.load( std::memory_order_relaxed );
+  for ( ;; )
+  {
+    Slot &slot = slots_[position & mask_];
+    intptr_t difference = static_cast<intptr_t>(slot.sequence.load( std::memory_order_acquire ) - (position + 1));
+    if ( difference == 0 )
+    {
+      if ( pop_position_.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ))
+      {
+        violation = slot.violation;
+        // Frees the slot for the producers of the next round
+        slot.sequence.store( position + mask_ + 1, std::memory_order_release );
+        return true;
+      }
+    }
+    else if ( difference < 0 )
+    {
+      return false;
+    }
+    else
+    {
+      position = pop_position_.load( std::memory_order_relaxed );
+    }
+  }
+}
+
+long budgetThreadId()
+{
+#ifdef __linux__
+  return static_cast<long>(syscall( SYS_gettid ));
+#else
+  return static_cast<long>(std::hash<std::thread::id>()( std::this_thread::get_id()) & 0x7FFFFFFF);
+#endif
+}
+}
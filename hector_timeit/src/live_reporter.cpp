@@ -0,0 +1,173 @@
+#include "hector_timeit/live_reporter.h"
+#include "hector_timeit/shared_memory.h"
+#include "hector_timeit/sharded_timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+
+namespace hector_timeit
+{
+
+LiveReporter &LiveReporter::instance()
+{
+  static LiveReporter reporter;
+  // Checked after the reporter is constructed since starting the export uses the reporter
+  static std::atomic<bool> export_checked( false );
+  if ( !export_checked.load( std::memory_order_relaxed ) && !export_checked.exchange( true ))
+    SharedMemoryExporter::startFromEnvironment();
+  return reporter;
+}
+
+LiveReporter::~LiveReporter()
+{
+  stop();
+  std::lock_guard<std::mutex> lock( mutex_ );
+  // Timers that were constructed before the reporter are destructed after it and must not access it anymore
+  for ( auto &source : sources_ )
+  {
+    if ( source.registered != nullptr ) *source.registered = false;
+  }
+}
+
+void LiveReporter::add( TimerBase &timer )
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  if ( timer.live_registered_ ) return;
+  timer.live_registered_ = true;
+  TimerBase *ptr = &timer;
+  sources_.push_back( Source{ ptr, timer.name(), [ ptr ]() { return ptr->liveSnapshot(); },
+                              [ ptr ]( std::vector<uint64_t> &counts ) { return ptr->liveHistogram( counts ); },
+                              [ ptr ]() { ptr->enableLiveHistogram(); }, &timer.live_registered_ } );
+  if ( histograms_enabled_ ) timer.enableLiveHistogram();
+}
+
+void LiveReporter::add( ShardedTimerBase &timer )
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  ShardedTimerBase *ptr = &timer;
+  sources_.push_back( Source{ ptr, timer.name(), [ ptr ]() { return ptr->liveSnapshot(); },
+                              [ ptr ]( std::vector<uint64_t> &counts ) { return ptr->liveHistogram( counts ); },
+                              [ ptr ]() { ptr->enableLiveHistogram(); }, nullptr } );
+  if ( histograms_enabled_ ) ptr->enableLiveHistogram();
+}
+
+void LiveReporter::remove( const void *timer )
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  sources_.erase( std::remove_if( sources_.begin(), sources_.end(),
+                                  [ timer ]( const Source &source ) { return source.key == timer; } ),
+                  sources_.end());
+}
+
+size_t LiveReporter::size() const
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  return sources_.size();
+}
+
+std::vector<LiveReporter::Entry> LiveReporter::snapshot() const
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  std::vector<Entry> result;
+  result.reserve( sources_.size());
+  for ( auto &source : sources_ )
+  {
+    result.push_back( Entry{ source.key, source.name, source.snapshot(), {}} );
+    if ( histograms_enabled_ ) source.histogram( result.back().histogram );
+  }
+  return result;
+}
+
+void LiveReporter::enableHistograms()
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  histograms_enabled_ = true;
+  for ( auto &source : sources_ ) source.enable_histogram();
+}
+
+std::string LiveReporter::toString() const
+{
+  return report( snapshot(), nullptr );
+}
+
+std::string LiveReporter::report( const std::vector<Entry> &entries, const std::vector<Entry> *previous )
+{
+  std::ostringstream stream;
+  bool first = true;
+  for ( const Entry &entry : entries )
+  {
+    const LiveSnapshot &snapshot = entry.snapshot;
+    if ( snapshot.count == 0 && snapshot.current == 0 ) continue;
+    if ( !first ) stream << std::endl;
+    first = false;
+    stream << "[Live: " << entry.name << "] " << snapshot.count << " run(s)";
+    if ( previous != nullptr )
+    {
+      LiveSnapshot last;
+      for ( const Entry &other : *previous )
+      {
+        if ( other.key != entry.key ) continue;
+        last = other.snapshot;
+        break;
+      }
+      // The timer may have been reset since the last report
+      size_t count = snapshot.count >= last.count ? snapshot.count - last.count : snapshot.count;
+      long long sum = snapshot.count >= last.count ? snapshot.sum - last.sum : snapshot.sum;
+      stream << " (+" << count;
+      if ( count != 0 ) stream << ", mean: " << TimerBase::formatTime( static_cast<double>(sum) / count );
+      stream << ")";
+    }
+    if ( snapshot.count != 0 )
+    {
+      stream << ", mean: " << TimerBase::formatTime( static_cast<double>(snapshot.sum) / snapshot.count )
+             << ", shortest: " << TimerBase::formatTime( snapshot.min )
+             << ", longest: " << TimerBase::formatTime( snapshot.max )
+             << ", sum: " << TimerBase::formatTime( static_cast<double>(snapshot.sum));
+    }
+    if ( snapshot.current != 0 ) stream << ", current: " << TimerBase::formatTime( snapshot.current );
+  }
+  return stream.str();
+}
+
+void LiveReporter::start( std::chrono::milliseconds period, Callback callback )
+{
+  stop();
+  if ( !callback ) callback = []( const std::string &report ) { std::cout << report << std::endl << std::flush; };
+  std::lock_guard<std::mutex> lock( thread_mutex_ );
+  stop_ = false;
+  thread_ = std::thread( &LiveReporter::run, this, period, std::move( callback ));
+}
+
+void LiveReporter::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock( thread_mutex_ );
+    if ( !thread_.joinable()) return;
+    stop_ = true;
+  }
+  condition_.notify_all();
+  thread_.join();
+}
+
+bool LiveReporter::isRunning() const
+{
+  return thread_.joinable();
+}
+
+void LiveReporter::run( std::chrono::milliseconds period, Callback callback )
+{
+  std::vector<Entry> previous;
+  std::unique_lock<std::mutex> lock( thread_mutex_ );
+  while ( !condition_.wait_for( lock, period, [ this ]() { return stop_; } ))
+  {
+    lock.unlock();
+    std::vector<Entry> entries = snapshot();
+    std::string result = report( entries, &previous );
+    if ( !result.empty()) callback( result );
+    previous = std::move( entries );
+    lock.lock();
+  }
+}
+}
@@ -0,0 +1,127 @@
+#include "hector_timeit/live_statistics.h"
+#include "hector_timeit/run_statistics.h"
+
+#include <thread>
+
+namespace hector_timeit
+{
+
+constexpr int LiveHistogram::SignificantBits;
+constexpr size_t LiveHistogram::BucketCount;
+
+LiveHistogram::LiveHistogram()
+{
+  for ( auto &bucket : buckets_ ) bucket.store( 0, std::memory_order_relaxed );
+}
+
+void LiveHistogram::clear()
+{
+  for ( auto &bucket : buckets_ ) bucket.store( 0, std::memory_order_relaxed );
+}
+
+void LiveHistogram::addTo( std::vector<uint64_t> &counts ) const
+{
+  if ( counts.size() < BucketCount ) counts.resize( BucketCount, 0 );
+  for ( size_t i = 0; i < BucketCount; ++i ) counts[i] += buckets_[i].load( std::memory_order_relaxed );
+}
+
+long LiveHistogram::bucketValue( size_t index )
+{
+  if ( index < (1U << SignificantBits)) return static_cast<long>(index);
+  // Same layout as the Histogram, see Histogram::bucketLowerBound
+  int exponent = static_cast<int>(index >> (SignificantBits - 1)) - 1;
+  unsigned long long sub_bucket = index - (static_cast<unsigned long long>(exponent) << (SignificantBits - 1));
+  unsigned long long lower = sub_bucket << exponent;
+  unsigned long long upper = ((sub_bucket + 1) << exponent) - 1;
+  return static_cast<long>(lower + (upper - lower) / 2);
+}
+
+long LiveHistogram::percentile( const std::vector<uint64_t> &counts, double percentile )
+{
+  uint64_t count = 0;
+  for ( uint64_t bucket : counts ) count += bucket;
+  if ( count == 0 ) return -1;
+  uint64_t rank = RunPercentiles::rank( count, percentile );
+  uint64_t cumulative = 0;
+  for ( size_t i = 0; i < counts.size(); ++i )
+  {
+    cumulative += counts[i];
+    if ( cumulative > rank ) return bucketValue( i );
+  }
+  return bucketValue( counts.size() - 1 );
+}
+
+void LiveSnapshot::merge( const LiveSnapshot &other )
+{
+  if ( other.count != 0 )
+  {
+    if ( count == 0 || other.min < min ) min = other.min;
+    if ( count == 0 || other.max > max ) max = other.max;
+  }
+  count += other.count;
+  sum += other.sum;
+  current += other.current;
+}
+
+LiveSnapshot LiveStatistics::snapshot() const
+{
+  LiveSnapshot result;
+  for ( int attempt = 0;; ++attempt )
+  {
+    unsigned sequence = sequence_.load( std::memory_order_acquire );
+    if ((sequence & 1) == 0 )
+    {
+      result.count = count_.load( std::memory_order_relaxed );
+      result.sum = sum_.load( std::memory_order_relaxed );
+      result.min = min_.load( std::memory_order_relaxed );
+      result.max = max_.load( std::memory_order_relaxed );
+      result.current = current_.load( std::memory_order_relaxed );
+      // Orders the loads of the values before the second load of the sequence
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if ( sequence_.load( std::memory_order_relaxed ) == sequence ) return result;
+    }
+    // The writer may have been preempted in the middle of a write
+    if ( attempt > 100 ) std::this_thread::yield();
+  }
+}
+
+LiveStatistics::~LiveStatistics()
+{
+  delete histogram_.load( std::memory_order_acquire );
+}
+
+void LiveStatistics::clear()
+{
+  set( LiveSnapshot());
+  LiveHistogram *histogram = histogram_.load( std::memory_order_acquire );
+  if ( histogram != nullptr ) histogram->clear();
+}
+
+void LiveStatistics::enableHistogram()
+{
+  if ( histogram_.load( std::memory_order_acquire ) != nullptr ) return;
+  LiveHistogram *histogram = new LiveHistogram();
+  LiveHistogram *expected = nullptr;
+  // Another thread may have enabled the histogram at the same time
+  if ( !histogram_.compare_exchange_strong( expected, histogram, std::memory_order_acq_rel )) delete histogram;
+}
+
+bool LiveStatistics::histogram( std::vector<uint64_t> &counts ) const
+{
+  LiveHistogram *histogram = histogram_.load( std::memory_order_acquire );
+  if ( histogram == nullptr ) return false;
+  histogram->addTo( counts );
+  return true;
+}
+
+void LiveStatistics::set( const LiveSnapshot &snapshot )
+{
+  beginWrite();
+  count_.store( snapshot.count, std::memory_order_relaxed );
+  sum_.store( snapshot.sum, std::memory_order_relaxed );
+  min_.store( snapshot.min, std::memory_order_relaxed );
+  max_.store( snapshot.max, std::memory_order_relaxed );
+  current_.store( snapshot.current, std::memory_order_relaxed );
+  endWrite();
+}
+}
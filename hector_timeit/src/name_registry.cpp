@@ -0,0 +1,73 @@
+#include "hector_timeit/name_registry.h"
+
+namespace hector_timeit
+{
+
+constexpr NameId NameRegistry::InvalidName;
+constexpr size_t NameRegistry::FirstChunkSize;
+constexpr size_t NameRegistry::ChunkCount;
+
+namespace
+{
+//! Computes the chunk and the index in the chunk of the given id where chunk i has FirstChunkSize << i entries.
+inline void locate( size_t id, size_t first_chunk_size, size_t &chunk, size_t &index )
+{
+  unsigned long long block = id / first_chunk_size + 1;
+  chunk = static_cast<size_t>(63 - __builtin_clzll( block ));
+  index = id - first_chunk_size * ((static_cast<size_t>(1) << chunk) - 1);
+}
+}
+
+NameRegistry &NameRegistry::instance()
+{
+  static NameRegistry registry;
+  return registry;
+}
+
+NameId NameRegistry::intern( const std::string &name )
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  auto it = ids_.find( name );
+  if ( it != ids_.end()) return it->second;
+  size_t size = size_.load( std::memory_order_relaxed );
+  size_t chunk, index;
+  locate( size, FirstChunkSize, chunk, index );
+  if ( chunks_[chunk] == nullptr ) chunks_[chunk] = new std::string[FirstChunkSize << chunk];
+  chunks_[chunk][index] = name;
+  NameId id = static_cast<NameId>(size);
+  ids_.insert( { name, id } );
+  // Publishes the chunk and the name to the lock-free readers
+  size_.store( size + 1, std::memory_order_release );
+  return id;
+}
+
+NameRegistry::~NameRegistry()
+{
+  for ( std::string *chunk : chunks_ ) delete[] chunk;
+}
+
+const std::string &NameRegistry::name( NameId id ) const
+{
+  static const std::string unknown = "unknown";
+  if ( id >= size_.load( std::memory_order_acquire )) return unknown;
+  size_t chunk, index;
+  locate( id, FirstChunkSize, chunk, index );
+  return chunks_[chunk][index];
+}
+
+size_t NameRegistry::size() const
+{
+  return size_.load( std::memory_order_acquire );
+}
+
+NameId NameDescriptor::resolve() const
+{
+  std::string name = prefix_;
+  name += name_;
+  if ( line_ >= 0 ) name += ":" + std::to_string( line_ );
+  NameId id = NameRegistry::instance().intern( name );
+  // Concurrent first uses intern the same name and, therefore, store the same id
+  id_.store( id, std::memory_order_release );
+  return id;
+}
+}
@@ -0,0 +1,194 @@
+#include "hector_timeit/perf_counters.h"
+
+#ifdef __linux__
+
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+namespace hector_timeit
+{
+
+const char *CounterValues::name( Counter counter )
+{
+  switch ( counter )
+  {
+    case Cycles:
+      return "Cycles";
+    case Instructions:
+      return "Instructions";
+    case L1DMisses:
+      return "L1D misses";
+    case LLCMisses:
+      return "LLC misses";
+    case BranchMisses:
+      return "Branch misses";
+    default:
+      return "Unknown";
+  }
+}
+
+PerfCounterGroup &PerfCounterGroup::threadGroup()
+{
+  static thread_local PerfCounterGroup group;
+  return group;
+}
+
+#ifdef __linux__
+namespace
+{
+void fillAttributes( perf_event_attr &attributes, CounterValues::Counter counter )
+{
+  std::memset( &attributes, 0, sizeof( attributes ));
+  attributes.size = sizeof( attributes );
+  attributes.type = PERF_TYPE_HARDWARE;
+  switch ( counter )
+  {
+    case CounterValues::Cycles:
+      attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case CounterValues::Instructions:
+      attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case CounterValues::L1DMisses:
+      attributes.type = PERF_TYPE_HW_CACHE;
+      attributes.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case CounterValues::LLCMisses:
+      attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case CounterValues::BranchMisses:
+      attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    default:
+      break;
+  }
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+}
+
+#ifdef __x86_64__
+
+inline uint64_t rdpmc( uint32_t counter )
+{
+  uint32_t low, high;
+  __asm__ __volatile__( "rdpmc" : "=a"( low ), "=d"( high ) : "c"( counter ));
+  return static_cast<uint64_t>(high) << 32 | low;
+}
+
+#endif
+}
+
+PerfCounterGroup::PerfCounterGroup()
+{
+  for ( int i = 0; i < CounterValues::CounterCount; ++i )
+  {
+    fds_[i] = -1;
+    pages_[i] = nullptr;
+  }
+  bool rdpmc = true;
+  for ( int i = 0; i < CounterValues::CounterCount; ++i )
+  {
+    perf_event_attr attributes;
+    fillAttributes( attributes, static_cast<CounterValues::Counter>(i));
+    // Counts the calling thread on any cpu
+    int fd = static_cast<int>(syscall( SYS_perf_event_open, &attributes, 0, -1, leader_, 0 ));
+    if ( fd == -1 ) continue;
+    if ( leader_ == -1 ) leader_ = fd;
+    fds_[i] = fd;
+    void *page = mmap( nullptr, static_cast<size_t>(sysconf( _SC_PAGESIZE )), PROT_READ, MAP_SHARED, fd, 0 );
+    if ( page == MAP_FAILED )
+    {
+      rdpmc = false;
+      continue;
+    }
+    pages_[i] = page;
+    if ( !static_cast<perf_event_mmap_page *>(page)->cap_user_rdpmc ) rdpmc = false;
+  }
+#ifdef __x86_64__
+  rdpmc_ = rdpmc && isOpen();
+#else
+  (void) rdpmc;
+#endif
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+  for ( int i = 0; i < CounterValues::CounterCount; ++i )
+  {
+    if ( pages_[i] != nullptr ) munmap( pages_[i], static_cast<size_t>(sysconf( _SC_PAGESIZE )));
+    if ( fds_[i] != -1 ) close( fds_[i] );
+  }
+}
+
+bool PerfCounterGroup::read( CounterValues &values ) const
+{
+  if ( !isOpen()) return false;
+#ifdef __x86_64__
+  if ( rdpmc_ )
+  {
+    for ( int i = 0; i < CounterValues::CounterCount; ++i )
+    {
+      if ( pages_[i] == nullptr ) continue;
+      const volatile perf_event_mmap_page *page = static_cast<const volatile perf_event_mmap_page *>(pages_[i]);
+      uint32_t sequence;
+      uint64_t count;
+      // The kernel updates the page under a sequence lock when the counter is (re)scheduled
+      do
+      {
+        sequence = page->lock;
+        __asm__ __volatile__( "" ::: "memory" );
+        uint32_t index = page->index;
+        // An index of 0 means that the counter is currently not active on the cpu
+        if ( index == 0 ) return readSlow( values );
+        count = page->offset;
+        uint16_t width = page->pmc_width;
+        int64_t pmc = static_cast<int64_t>(rdpmc( index - 1 ) << (64 - width)) >> (64 - width);
+        count += pmc;
+        __asm__ __volatile__( "" ::: "memory" );
+      } while ( page->lock != sequence );
+      values.values[i] = count;
+    }
+    return true;
+  }
+#endif
+  return readSlow( values );
+}
+
+bool PerfCounterGroup::readSlow( CounterValues &values ) const
+{
+  for ( int i = 0; i < CounterValues::CounterCount; ++i )
+  {
+    if ( fds_[i] == -1 ) continue;
+    uint64_t value;
+    if ( ::read( fds_[i], &value, sizeof( value )) != sizeof( value )) return false;
+    values.values[i] = value;
+  }
+  return true;
+}
+
+#else
+
+PerfCounterGroup::PerfCounterGroup()
+{
+  for ( int i = 0; i < CounterValues::CounterCount; ++i )
+  {
+    fds_[i] = -1;
+    pages_[i] = nullptr;
+  }
+}
+
+PerfCounterGroup::~PerfCounterGroup() = default;
+
+bool PerfCounterGroup::read( CounterValues & ) const { return false; }
+
+bool PerfCounterGroup::readSlow( CounterValues & ) const { return false; }
+
+#endif
+}
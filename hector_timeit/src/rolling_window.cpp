@@ -0,0 +1,48 @@
+#include "hector_timeit/rolling_window.h"
+
+namespace hector_timeit
+{
+
+constexpr size_t RollingWindow::DefaultIntervals;
+
+RollingWindow::RollingWindow( Mode mode, long long window, size_t intervals ) : mode_( mode )
+{
+  if ( window < 1 ) window = 1;
+  if ( intervals < 1 ) intervals = 1;
+  if ( static_cast<long long>(intervals) > window ) intervals = static_cast<size_t>(window);
+  interval_length_ = (window + static_cast<long long>(intervals) - 1) / static_cast<long long>(intervals);
+  intervals_.resize( intervals );
+}
+
+RollingWindow RollingWindow::lastSeconds( double seconds, size_t intervals )
+{
+  return RollingWindow( Time, static_cast<long long>(seconds * 1E9), intervals );
+}
+
+RollingWindow RollingWindow::lastRuns( long long runs, size_t intervals )
+{
+  return RollingWindow( Runs, runs, intervals );
+}
+
+RunStatistics RollingWindow::statistics( long long now ) const
+{
+  RunStatistics result;
+  if ( intervals_.empty()) return result;
+  // In Runs mode, the window ends at the latest run instead of the current time
+  long long current = mode_ == Time ? now / interval_length_ : latest_;
+  long long oldest = current - static_cast<long long>(intervals_.size()) + 1;
+  for ( const Interval &interval : intervals_ )
+  {
+    if ( interval.index < oldest || interval.index > current ) continue;
+    result.merge( interval.statistics );
+  }
+  return result;
+}
+
+void RollingWindow::clear()
+{
+  for ( Interval &interval : intervals_ ) interval = Interval();
+  runs_ = 0;
+  latest_ = -1;
+}
+}
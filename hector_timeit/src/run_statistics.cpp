@@ -0,0 +1,161 @@
+#include "hector_timeit/run_statistics.h"
+#include "hector_timeit/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace hector_timeit
+{
+
+namespace
+{
+double square( double x ) { return x * x; }
+
+//! The variance of a single run is undefined, hence, the sum is computed explicitly for that case.
+double sumOfSquaredDifferences( const RunStatistics &stats )
+{
+  return stats.count > 1 ? stats.variance * (stats.count - 1) : 0;
+}
+
+std::vector<long> validRunTimes( const std::vector<long> &run_times )
+{
+  std::vector<long> result;
+  result.reserve( run_times.size());
+  for ( long time : run_times )
+  {
+    if ( time != -1 ) result.push_back( time );
+  }
+  return result;
+}
+}
+
+RunStatistics RunStatistics::fromRunTimes( const std::vector<long> &run_times )
+{
+  RunStatistics result;
+  result.total_count = run_times.size();
+  result.max = 0;
+  result.min = INT64_MAX;
+  for ( long time : run_times )
+  {
+    if ( time == -1 ) continue;
+    result.sum += time;
+    ++result.count;
+    if ( time > result.max ) result.max = time;
+    if ( time < result.min ) result.min = time;
+  }
+  result.mean = (double) result.sum / result.count;
+  double var = 0;
+  for ( long time : run_times )
+  {
+    if ( time == -1 ) continue;
+    var += square( time - result.mean );
+  }
+  // The sample variance of a single run is undefined, report 0 like the histogram
+  if ( result.count > 1 ) result.variance = var / (result.count - 1);
+  return result;
+}
+
+void RunStatistics::add( long time )
+{
+  ++total_count;
+  if ( time == -1 ) return;
+  if ( count == 0 )
+  {
+    count = 1;
+    sum = min = max = time;
+    mean = time;
+    variance = 0;
+    return;
+  }
+  // Welford's update of the sum of squared differences
+  double m2 = sumOfSquaredDifferences( *this );
+  double delta = time - mean;
+  ++count;
+  sum += time;
+  if ( time < min ) min = time;
+  if ( time > max ) max = time;
+  mean = (double) sum / count;
+  m2 += delta * (time - mean);
+  variance = m2 / (count - 1);
+}
+
+void RunStatistics::merge( const RunStatistics &other )
+{
+  total_count += other.total_count;
+  if ( other.count == 0 ) return;
+  if ( count == 0 )
+  {
+    size_t total = total_count;
+    *this = other;
+    total_count = total;
+    return;
+  }
+  // Parallel combination of the sums of squared differences (Chan et al.)
+  double m2 = sumOfSquaredDifferences( *this ) + sumOfSquaredDifferences( other );
+  double delta = other.mean - mean;
+  size_t merged_count = count + other.count;
+  m2 += square( delta ) * count * other.count / merged_count;
+  count = merged_count;
+  sum += other.sum;
+  if ( other.min < min ) min = other.min;
+  if ( other.max > max ) max = other.max;
+  mean = (double) sum / count;
+  variance = m2 / (count - 1);
+}
+
+size_t RunPercentiles::rank( size_t count, double percentile )
+{
+  if ( count == 0 ) return 0;
+  // The epsilon prevents percentiles that are not exactly representable, e.g., 99.9, from rounding up a rank
+  double rank = std::ceil( percentile * count / 100.0 - 1E-9 );
+  if ( rank < 1 ) return 0;
+  if ( rank >= count ) return count - 1;
+  return static_cast<size_t>(rank) - 1;
+}
+
+RunPercentiles RunPercentiles::fromRunTimes( const std::vector<long> &run_times )
+{
+  std::vector<long> values = validRunTimes( run_times );
+  return fromRunTimesInPlace( values );
+}
+
+RunPercentiles RunPercentiles::fromRunTimesInPlace( std::vector<long> &values )
+{
+  RunPercentiles result;
+  values.erase( std::remove( values.begin(), values.end(), -1L ), values.end());
+  if ( values.empty()) return result;
+  // Since the percentiles are ascending, each selection only has to partition the range behind the previous one
+  long *percentiles[] = { &result.p50, &result.p90, &result.p99, &result.p999 };
+  const double levels[] = { 50, 90, 99, 99.9 };
+  auto begin = values.begin();
+  for ( int i = 0; i < 4; ++i )
+  {
+    auto nth = values.begin() + rank( values.size(), levels[i] );
+    std::nth_element( begin, nth, values.end());
+    *percentiles[i] = *nth;
+    begin = nth;
+  }
+  return result;
+}
+
+RunPercentiles RunPercentiles::fromHistogram( const Histogram &histogram )
+{
+  RunPercentiles result;
+  if ( histogram.count() == 0 ) return result;
+  result.p50 = histogram.valueAtPercentile( 50 );
+  result.p90 = histogram.valueAtPercentile( 90 );
+  result.p99 = histogram.valueAtPercentile( 99 );
+  result.p999 = histogram.valueAtPercentile( 99.9 );
+  return result;
+}
+
+long RunPercentiles::percentile( const std::vector<long> &run_times, double percentile )
+{
+  std::vector<long> values = validRunTimes( run_times );
+  if ( values.empty()) return -1;
+  auto nth = values.begin() + rank( values.size(), percentile );
+  std::nth_element( values.begin(), nth, values.end());
+  return *nth;
+}
+}
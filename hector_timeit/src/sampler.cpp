@@ -0,0 +1,41 @@
+#include "hector_timeit/sampler.h"
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace hector_timeit
+{
+
+Sampler::Sampler( unsigned period, Mode mode )
+  : countdown_( 1 ), period_( period < 1 ? 1 : period ), mode_( mode )
+{
+  // Seeded per sampler, so threads executing the same block don't sample in lockstep
+  state_ = std::hash<std::thread::id>()( std::this_thread::get_id())
+           ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())
+           ^ reinterpret_cast<uintptr_t>(this);
+  if ( state_ == 0 ) state_ = 0x9E3779B97F4A7C15ULL;
+  if ( mode_ == Random && period_ > 1 )
+  {
+    log_skip_probability_ = std::log1p( -1.0 / period_ );
+    countdown_ = nextCountdown();
+  }
+}
+
+unsigned Sampler::nextCountdown()
+{
+  if ( mode_ == EveryNth || period_ == 1 ) return period_;
+  // xorshift64*
+  state_ ^= state_ >> 12;
+  state_ ^= state_ << 25;
+  state_ ^= state_ >> 27;
+  uint64_t random = state_ * 0x2545F4914F6CDD1DULL;
+  // Uniform in (0, 1]
+  double uniform = (static_cast<double>(random >> 11) + 1) / 9007199254740992.0;
+  double gap = std::floor( std::log( uniform ) / log_skip_probability_ );
+  if ( gap >= std::numeric_limits<unsigned>::max() - 1 ) return std::numeric_limits<unsigned>::max();
+  return static_cast<unsigned>(gap) + 1;
+}
+}
@@ -0,0 +1,204 @@
+#include "hector_timeit/scope_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace hector_timeit
+{
+
+constexpr uint32_t ScopeTree::Root;
+constexpr uint32_t ScopeTree::InvalidNode;
+constexpr uint64_t ScopeTree::EmptyKey;
+
+namespace
+{
+constexpr size_t InitialCapacity = 64;
+constexpr size_t InitialStackDepth = 32;
+}
+
+ScopeTree::ScopeTree()
+{
+  nodes_.push_back( Node{ 0, InvalidNode, 0, 0 } );
+  stack_.reserve( InitialStackDepth );
+  stack_.push_back( Frame{ Root, WallClock::time_point() } );
+  keys_.assign( InitialCapacity, EmptyKey );
+  values_.assign( InitialCapacity, InvalidNode );
+  mask_ = InitialCapacity - 1;
+}
+
+uint32_t ScopeTree::insertChild( uint32_t parent, ScopeId scope )
+{
+  // Keep the load factor below 0.5 so probe sequences stay short
+  if ( 2 * nodes_.size() >= keys_.size()) rehash( 2 * keys_.size());
+  uint32_t node = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back( Node{ scope, parent, 0, 0 } );
+  uint64_t key = makeKey( parent, scope );
+  size_t slot = hash( key ) & mask_;
+  while ( keys_[slot] != EmptyKey ) slot = (slot + 1) & mask_;
+  keys_[slot] = key;
+  values_[slot] = node;
+  return node;
+}
+
+void ScopeTree::rehash( size_t capacity )
+{
+  std::vector<uint64_t> keys( capacity, EmptyKey );
+  std::vector<uint32_t> values( capacity, InvalidNode );
+  size_t mask = capacity - 1;
+  for ( size_t i = 0; i < keys_.size(); ++i )
+  {
+    if ( keys_[i] == EmptyKey ) continue;
+    size_t slot = hash( keys_[i] ) & mask;
+    while ( keys[slot] != EmptyKey ) slot = (slot + 1) & mask;
+    keys[slot] = keys_[i];
+    values[slot] = values_[i];
+  }
+  keys_.swap( keys );
+  values_.swap( values );
+  mask_ = mask;
+}
+
+long long ScopeTree::selfTime( uint32_t node ) const
+{
+  long long result = nodes_[node].inclusive_time;
+  for ( size_t i = node + 1; i < nodes_.size(); ++i )
+  {
+    if ( nodes_[i].parent == node ) result -= nodes_[i].inclusive_time;
+  }
+  return result;
+}
+
+void ScopeTree::merge( const ScopeTree &other )
+{
+  // Every node is stored after its parent, hence, the parent was already mapped
+  std::vector<uint32_t> mapping( other.nodes_.size(), Root );
+  for ( size_t i = 1; i < other.nodes_.size(); ++i )
+  {
+    const Node &node = other.nodes_[i];
+    mapping[i] = findOrInsertChild( mapping[node.parent], node.scope );
+    nodes_[mapping[i]].inclusive_time += node.inclusive_time;
+    nodes_[mapping[i]].count += node.count;
+  }
+}
+
+ScopeProfiler &ScopeProfiler::instance()
+{
+  static ScopeProfiler profiler;
+  return profiler;
+}
+
+ScopeProfiler::ScopeProfiler()
+{
+  // Construct the registry first, so it is destroyed after the profiler which needs the names for the report on exit
+  NameRegistry::instance();
+}
+
+ScopeProfiler::~ScopeProfiler()
+{
+  if ( !print_on_exit_ ) return;
+  ScopeTree tree = mergedTree();
+  if ( tree.nodes().size() <= 1 ) return;
+  std::cout << toString( tree ) << std::endl << std::flush;
+}
+
+ScopeTree &ScopeProfiler::threadTree()
+{
+  std::thread::id id = std::this_thread::get_id();
+  std::lock_guard<std::mutex> lock( mutex_ );
+  for ( auto &tree : trees_ )
+  {
+    if ( tree.thread_id == id ) return *tree.tree;
+  }
+  trees_.push_back( ThreadTree{ id, std::unique_ptr<ScopeTree>( new ScopeTree()) } );
+  return *trees_.back().tree;
+}
+
+size_t ScopeProfiler::threadCount() const
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  return trees_.size();
+}
+
+ScopeTree ScopeProfiler::mergedTree() const
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  ScopeTree result;
+  for ( auto &tree : trees_ ) result.merge( *tree.tree );
+  return result;
+}
+
+namespace
+{
+void printPadded( std::ostringstream &stream, const std::string &text, size_t pad, bool left_aligned )
+{
+  if ( !left_aligned ) for ( size_t i = text.length(); i < pad; ++i ) stream << " ";
+  stream << text;
+  if ( left_aligned ) for ( size_t i = text.length(); i < pad; ++i ) stream << " ";
+}
+}
+
+std::string ScopeProfiler::toString( const ScopeTree &tree, TimerBase::TimeUnit print_time_unit ) const
+{
+  const std::vector<ScopeTree::Node> &nodes = tree.nodes();
+  std::vector<std::vector<uint32_t>> children( nodes.size());
+  std::vector<long long> child_time( nodes.size(), 0 );
+  for ( uint32_t i = 1; i < nodes.size(); ++i )
+  {
+    children[nodes[i].parent].push_back( i );
+    child_time[nodes[i].parent] += nodes[i].inclusive_time;
+  }
+  for ( auto &list : children )
+  {
+    std::sort( list.begin(), list.end(), [&nodes]( uint32_t a, uint32_t b )
+    {
+      return nodes[a].inclusive_time > nodes[b].inclusive_time;
+    } );
+  }
+
+  std::ostringstream stream;
+  stream << "[ScopeProfiler] " << threadCount() << " thread(s):" << std::endl;
+  printPadded( stream, "Scope", 40, true );
+  printPadded( stream, "Calls", 12, false );
+  printPadded( stream, "Inclusive", 16, false );
+  printPadded( stream, "Self", 16, false );
+  printPadded( stream, "% Parent", 12, false );
+
+  // Depth-first traversal using an explicit stack of (node, depth)
+  std::vector<std::pair<uint32_t, size_t>> stack;
+  for ( auto it = children[ScopeTree::Root].rbegin(); it != children[ScopeTree::Root].rend(); ++it )
+    stack.push_back( { *it, 0 } );
+  while ( !stack.empty())
+  {
+    uint32_t index = stack.back().first;
+    size_t depth = stack.back().second;
+    stack.pop_back();
+    const ScopeTree::Node &node = nodes[index];
+    long long parent_time = node.parent == ScopeTree::Root ? child_time[ScopeTree::Root]
+                                                           : nodes[node.parent].inclusive_time;
+    stream << std::endl;
+    printPadded( stream, std::string( 2 * depth, ' ' ) + scopeName( node.scope ), 40, true );
+    printPadded( stream, std::to_string( node.count ), 12, false );
+    printPadded( stream, TimerBase::formatTime( node.inclusive_time, print_time_unit ), 16, false );
+    printPadded( stream, TimerBase::formatTime( node.inclusive_time - child_time[index], print_time_unit ), 16, false );
+    std::ostringstream percent;
+    percent << std::fixed << std::setprecision( 1 )
+            << (parent_time > 0 ? 100.0 * node.inclusive_time / parent_time : 100.0) << "%";
+    printPadded( stream, percent.str(), 12, false );
+    for ( auto it = children[index].rbegin(); it != children[index].rend(); ++it )
+      stack.push_back( { *it, depth + 1 } );
+  }
+  return stream.str();
+}
+
+std::string ScopeProfiler::toString() const
+{
+  return toString( mergedTree());
+}
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ScopeProfiler &profiler )
+{
+  return stream << profiler.toString();
+}
@@ -0,0 +1,304 @@
+#include "hector_timeit/benchmark.h"
+#include "hector_timeit/timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+/*
+ * Measures the overhead of hector_timeit itself and writes the results as JSON, so the overhead can be compared between
+ *  releases. Progress is printed to std::cerr.
+ *
+ * Usage: hector_timeit_self_benchmark [--quick] [--threads N] [--output FILE]
+ *   --quick      Shorter time budgets and fewer runs for smoke tests. Less accurate.
+ *   --threads N  The maximum number of threads for the multi-threaded benchmarks. Default: Hardware concurrency
+ *   --output     Writes the JSON to FILE instead of std::cout.
+ *
+ * The JSON object contains some information on the system and a list of results. Each result has a name, the number of
+ *  threads, the unit and the value. Results of the Benchmark runner additionally contain the confidence interval and the
+ *  number of samples.
+ *
+ * The ShardedTimer and ScopeProfiler benchmarks use the same code as the HECTOR_TIME_BLOCK and HECTOR_TIME_SCOPE macros
+ *  without printing on exit, since that would mix the reports into the JSON output.
+ */
+
+using namespace hector_timeit;
+
+namespace
+{
+
+struct Result
+{
+  std::string name;
+  unsigned threads;
+  std::string unit;
+  double value;
+  std::vector<std::pair<std::string, double>> extra;
+};
+
+struct Settings
+{
+  bool quick = false;
+  unsigned max_threads = 1;
+  std::string output;
+};
+
+std::vector<Result> results;
+Settings settings;
+
+BenchmarkOptions benchmarkOptions()
+{
+  BenchmarkOptions options;
+  if ( settings.quick )
+  {
+    options.warmup_time = 10000000;
+    options.time_budget = 100000000;
+  }
+  else
+  {
+    options.time_budget = 2000000000;
+  }
+  return options;
+}
+
+void add( const BenchmarkResult &result )
+{
+  std::cerr << result << std::endl;
+  results.push_back( Result{ result.name, 1, "ns", result.mean,
+                             { { "ci_lower", result.ci_lower },
+                               { "ci_upper", result.ci_upper },
+                               { "median", result.median },
+                               { "samples", static_cast<double>(result.samples.size()) },
+                               { "batch_size", static_cast<double>(result.batch_size) }}} );
+}
+
+template<typename TimerT>
+void benchmarkStartStop( const std::string &name, TimerBase::RunStorage run_storage )
+{
+  TimerT timer( name, TimerBase::Default, false, false, run_storage );
+  // Batches reset the runs afterwards, so the memory of the VectorStorage is bounded by the batch size
+  add( Benchmark::runBatches( name, [ &timer ]( size_t iterations )
+  {
+    for ( size_t i = 0; i < iterations; ++i )
+    {
+      timer.start();
+      timer.stop();
+      timer.reset( true );
+    }
+    timer.reset();
+  }, benchmarkOptions()));
+}
+
+void benchmarkTimeFunction()
+{
+  std::function<int()> function = []() { return 42; };
+  add( Benchmark::run( "timer_time_std_function", [ &function ]()
+  {
+    doNotOptimize( Timer::time( function ));
+  }, benchmarkOptions()));
+  add( Benchmark::run( "timer_time_lambda", []()
+  {
+    doNotOptimize( Timer::time( []() { return 42; } ));
+  }, benchmarkOptions()));
+}
+
+void benchmarkSampledBlock()
+{
+  ShardedTimer timer( "sampled_time_block", TimerBase::Default, false, TimerBase::HistogramStorage, 100 );
+  Timer &shard = timer.localShard();
+  Sampler sampler( 100 );
+  add( Benchmark::run( "sampled_time_block_1_in_100", [ &shard, &sampler ]()
+  {
+    SampledTimeBlock block( shard, sampler );
+  }, benchmarkOptions()));
+}
+
+void benchmarkScope()
+{
+  ScopeProfiler::instance().setPrintOnExit( false );
+  add( Benchmark::run( "time_scope", []()
+  {
+    HECTOR_TIME_SCOPE( SelfBenchmarkScope );
+  }, benchmarkOptions()));
+}
+
+/*!
+ * Times blocks on the given number of threads at the same time and reports the median, minimum and maximum cost per
+ *  block of all threads and repetitions.
+ */
+void benchmarkBlockThreads( unsigned threads, TimerBase::RunStorage run_storage, const std::string &name )
+{
+  const long iterations = settings.quick ? 100000 : 1000000;
+  const int repetitions = settings.quick ? 3 : 5;
+  std::vector<double> times;
+  for ( int repetition = 0; repetition < repetitions; ++repetition )
+  {
+    ShardedTimer timer( name, TimerBase::Default, false, run_storage );
+    std::atomic<unsigned> ready{ 0 };
+    std::vector<double> thread_times( threads );
+    std::vector<std::thread> workers;
+    for ( unsigned t = 0; t < threads; ++t )
+    {
+      workers.emplace_back( [ &, t ]()
+      {
+        Timer &shard = timer.localShard();
+        // Start at the same time so the threads contend for the whole measurement
+        ready.fetch_add( 1 );
+        while ( ready.load() < threads ) std::this_thread::yield();
+        WallClock::time_point start = WallClock::now();
+        for ( long i = 0; i < iterations; ++i )
+        {
+          TimeBlock block( shard );
+        }
+        thread_times[t] = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          WallClock::now() - start ).count()) / iterations;
+      } );
+    }
+    for ( auto &worker : workers ) worker.join();
+    times.insert( times.end(), thread_times.begin(), thread_times.end());
+  }
+  std::sort( times.begin(), times.end());
+  std::cerr << "[" << name << "] " << threads << " thread(s): " << TimerBase::formatTime( times[times.size() / 2] )
+            << " per block" << std::endl;
+  results.push_back( Result{ name, threads, "ns", times[times.size() / 2],
+                             { { "min", times.front() }, { "max", times.back() }}} );
+}
+
+void fill( Timer &timer, long runs )
+{
+  for ( long i = 0; i < runs; ++i )
+  {
+    timer.start();
+    // Runs without elapsed time are not recorded
+    for ( int k = 0; k < 10; ++k ) __asm__ __volatile__( "" );
+    timer.stop();
+    timer.reset( true );
+  }
+}
+
+void benchmarkToString( TimerBase::RunStorage run_storage, const std::string &name )
+{
+  const long runs = 1000000;
+  Timer timer( name, TimerBase::Default, false, false, run_storage );
+  fill( timer, runs );
+  BenchmarkOptions options = benchmarkOptions();
+  options.min_samples = 5;
+  options.max_samples = settings.quick ? 5 : 30;
+  options.warmup_time = 0;
+  add( Benchmark::run( name, [ &timer ]()
+  {
+    doNotOptimize( timer.toString());
+  }, options ));
+  results.back().extra.push_back( { "runs", static_cast<double>(timer.getRunStatistics().total_count) } );
+}
+
+size_t heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+  struct mallinfo info = mallinfo();
+  return static_cast<size_t>(static_cast<unsigned>(info.uordblks)) + static_cast<unsigned>(info.hblkhd);
+#else
+  return 0;
+#endif
+}
+
+void measureMemory( TimerBase::RunStorage run_storage, const std::string &name )
+{
+  const long runs = settings.quick ? 100000 : 1000000;
+  size_t before = heapInUse();
+  Timer timer( name, TimerBase::Default, false, false, run_storage );
+  fill( timer, runs );
+  size_t after = heapInUse();
+  if ( after == 0 ) return;
+  size_t recorded = timer.getRunStatistics().total_count;
+  double bytes_per_run = recorded == 0 ? 0 : static_cast<double>(after - before) / recorded;
+  std::cerr << "[" << name << "] " << bytes_per_run << " bytes per run" << std::endl;
+  results.push_back( Result{ name, 1, "bytes", bytes_per_run, { { "runs", static_cast<double>(recorded) }}} );
+}
+
+void writeJson( std::ostream &stream )
+{
+  stream << std::setprecision( 10 ) << "{\n  \"version\": 1,\n  \"clock_source\": \""
+         << (WallClock::source() == WallClock::Tsc ? "tsc" : "high_resolution_clock") << "\",\n"
+         << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+         << "  \"quick\": " << (settings.quick ? "true" : "false") << ",\n  \"results\": [";
+  for ( size_t i = 0; i < results.size(); ++i )
+  {
+    const Result &result = results[i];
+    stream << (i == 0 ? "\n" : ",\n") << "    { \"name\": \"" << result.name << "\", \"threads\": " << result.threads
+           << ", \"unit\": \"" << result.unit << "\", \"value\": " << result.value;
+    for ( const auto &extra : result.extra ) stream << ", \"" << extra.first << "\": " << extra.second;
+    stream << " }";
+  }
+  stream << "\n  ]\n}" << std::endl;
+}
+}
+
+int main( int argc, char **argv )
+{
+  settings.max_threads = std::max( 1U, std::thread::hardware_concurrency());
+  for ( int i = 1; i < argc; ++i )
+  {
+    if ( std::strcmp( argv[i], "--quick" ) == 0 ) settings.quick = true;
+    else if ( std::strcmp( argv[i], "--threads" ) == 0 && i + 1 < argc )
+      settings.max_threads = static_cast<unsigned>(std::max( 1, std::atoi( argv[++i] )));
+    else if ( std::strcmp( argv[i], "--output" ) == 0 && i + 1 < argc ) settings.output = argv[++i];
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--quick] [--threads N] [--output FILE]" << std::endl;
+      return 1;
+    }
+  }
+
+  benchmarkStartStop<Timer>( "timer_start_stop", TimerBase::VectorStorage );
+  benchmarkStartStop<Timer>( "timer_start_stop_histogram", TimerBase::HistogramStorage );
+  benchmarkStartStop<WallTimer>( "wall_timer_start_stop", TimerBase::VectorStorage );
+  benchmarkStartStop<CalibratedTimer>( "calibrated_timer_start_stop", TimerBase::VectorStorage );
+  if ( CountingTimer( "probe", TimerBase::Default, false ).measuresCounters())
+    benchmarkStartStop<CountingTimer>( "counting_timer_start_stop", TimerBase::VectorStorage );
+  benchmarkTimeFunction();
+  benchmarkSampledBlock();
+  benchmarkScope();
+
+  for ( unsigned threads = 1; threads <= settings.max_threads; threads *= 2 )
+  {
+    benchmarkBlockThreads( threads, TimerBase::VectorStorage, "time_block" );
+    benchmarkBlockThreads( threads, TimerBase::HistogramStorage, "time_block_histogram" );
+    if ( threads < settings.max_threads && threads * 2 > settings.max_threads )
+    {
+      benchmarkBlockThreads( settings.max_threads, TimerBase::VectorStorage, "time_block" );
+      benchmarkBlockThreads( settings.max_threads, TimerBase::HistogramStorage, "time_block_histogram" );
+    }
+  }
+
+  benchmarkToString( TimerBase::VectorStorage, "to_string_1e6_runs" );
+  benchmarkToString( TimerBase::HistogramStorage, "to_string_1e6_runs_histogram" );
+
+  measureMemory( TimerBase::VectorStorage, "memory_per_run" );
+  measureMemory( TimerBase::HistogramStorage, "memory_per_run_histogram" );
+
+  if ( settings.output.empty())
+  {
+    writeJson( std::cout );
+    return 0;
+  }
+  std::ofstream file( settings.output );
+  writeJson( file );
+  if ( !file )
+  {
+    std::cerr << "Failed to write " << settings.output << std::endl;
+    return 1;
+  }
+  return 0;
+}
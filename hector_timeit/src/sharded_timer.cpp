@@ -0,0 +1,204 @@
+#include "hector_timeit/sharded_timer.h"
+#include "hector_timeit/live_reporter.h"
+
+#include <iostream>
+
+namespace hector_timeit
+{
+
+ShardedTimerBase::ShardedTimerBase( std::string name, TimerBase::TimeUnit print_time_unit, bool print_on_destruct,
+                                    TimerBase::RunStorage run_storage, unsigned sample_period )
+  : name_( std::move( name )), print_time_unit_( print_time_unit ), run_storage_( run_storage )
+    , sample_period_( sample_period < 1 ? 1 : sample_period ), print_on_destruct_( print_on_destruct )
+{
+  // Also ensures that the reporter is constructed before and, hence, destructed after this timer
+  LiveReporter::instance().add( *this );
+}
+
+ShardedTimerBase::~ShardedTimerBase()
+{
+  LiveReporter::instance().remove( this );
+  if ( print_on_destruct_ ) std::cout << *this << std::endl << std::flush;
+}
+
+TimerBase &ShardedTimerBase::internalLocalShard( ShardFactory factory )
+{
+  std::thread::id id = std::this_thread::get_id();
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  for ( auto &shard : shards_ )
+  {
+    if ( shard.thread_id == id ) return *shard.timer;
+  }
+  shards_.push_back( Shard{ id, std::unique_ptr<TimerBase>( factory( name_, print_time_unit_, run_storage_ )) } );
+  if ( latency_budget_ != TimerBase::NoBudget )
+    shards_.back().timer->setLatencyBudget( latency_budget_, budget_callback_ );
+  if ( rolling_window_.enabled()) shards_.back().timer->setRollingWindow( rolling_window_ );
+  if ( live_histogram_ ) shards_.back().timer->enableLiveHistogram();
+  return *shards_.back().timer;
+}
+
+void ShardedTimerBase::setLatencyBudget( long budget, BudgetCallback callback )
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  latency_budget_ = budget;
+  budget_callback_ = std::move( callback );
+  for ( auto &shard : shards_ ) shard.timer->setLatencyBudget( latency_budget_, budget_callback_ );
+}
+
+void ShardedTimerBase::setRollingWindow( const RollingWindow &window )
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  rolling_window_ = window;
+  rolling_window_.clear();
+  for ( auto &shard : shards_ ) shard.timer->setRollingWindow( rolling_window_ );
+}
+
+RunStatistics ShardedTimerBase::getWindowStatistics() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  RunStatistics result;
+  for ( auto &shard : shards_ ) result.merge( shard.timer->getWindowStatistics());
+  return result;
+}
+
+size_t ShardedTimerBase::budgetViolations() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  size_t result = 0;
+  for ( auto &shard : shards_ ) result += shard.timer->budgetViolations();
+  return result;
+}
+
+size_t ShardedTimerBase::shardCount() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  return shards_.size();
+}
+
+std::vector<long> ShardedTimerBase::getRunTimes() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  std::vector<long> result;
+  for ( auto &shard : shards_ )
+  {
+    std::vector<long> run_times = shard.timer->getRunTimes();
+    result.insert( result.end(), run_times.begin(), run_times.end());
+  }
+  return result;
+}
+
+std::vector<long> ShardedTimerBase::getCpuRunTimes() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  std::vector<long> result;
+  for ( auto &shard : shards_ )
+  {
+    std::vector<long> cpu_run_times = shard.timer->getCpuRunTimes();
+    result.insert( result.end(), cpu_run_times.begin(), cpu_run_times.end());
+  }
+  return result;
+}
+
+LiveSnapshot ShardedTimerBase::liveSnapshot() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  LiveSnapshot result;
+  for ( auto &shard : shards_ ) result.merge( shard.timer->liveSnapshot());
+  return result;
+}
+
+void ShardedTimerBase::enableLiveHistogram()
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  live_histogram_ = true;
+  for ( auto &shard : shards_ ) shard.timer->enableLiveHistogram();
+}
+
+bool ShardedTimerBase::liveHistogram( std::vector<uint64_t> &counts ) const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  if ( !live_histogram_ ) return false;
+  for ( auto &shard : shards_ ) shard.timer->liveHistogram( counts );
+  return true;
+}
+
+RunStatistics ShardedTimerBase::getRunStatistics() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  RunStatistics result;
+  for ( auto &shard : shards_ ) result.merge( shard.timer->getRunStatistics());
+  return result;
+}
+
+RunStatistics ShardedTimerBase::getCpuRunStatistics() const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  RunStatistics result;
+  for ( auto &shard : shards_ ) result.merge( shard.timer->getCpuRunStatistics());
+  return result;
+}
+
+Histogram ShardedTimerBase::mergeHistograms( bool cpu ) const
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  Histogram result( Histogram::DefaultSignificantBits );
+  for ( auto &shard : shards_ )
+  {
+    // Shards without a cpu clock or with vector storage only have a placeholder histogram without buckets
+    if ( cpu && !shard.timer->measuresCpuTime()) continue;
+    const Histogram &histogram = cpu ? shard.timer->getCpuRunHistogram() : shard.timer->getRunHistogram();
+    if ( !histogram.valid() || histogram.count() == 0 ) continue;
+    result.merge( histogram );
+  }
+  return result;
+}
+
+RunPercentiles ShardedTimerBase::getRunPercentiles() const
+{
+  if ( run_storage_ == TimerBase::VectorStorage ) return RunPercentiles::fromRunTimes( getRunTimes());
+  return RunPercentiles::fromHistogram( mergeHistograms( false ));
+}
+
+RunPercentiles ShardedTimerBase::getCpuRunPercentiles() const
+{
+  if ( run_storage_ == TimerBase::VectorStorage ) return RunPercentiles::fromRunTimes( getCpuRunTimes());
+  return RunPercentiles::fromHistogram( mergeHistograms( true ));
+}
+
+long ShardedTimerBase::getPercentile( double percentile ) const
+{
+  if ( run_storage_ == TimerBase::VectorStorage ) return RunPercentiles::percentile( getRunTimes(), percentile );
+  return mergeHistograms( false ).valueAtPercentile( percentile );
+}
+
+std::string ShardedTimerBase::toString() const
+{
+  CounterValues counter_totals;
+  size_t counter_runs = 0;
+  AllocationCounts allocation_totals;
+  size_t allocation_runs = 0;
+  size_t budget_violations = 0;
+  {
+    std::lock_guard<std::mutex> lock( shards_mutex_ );
+    for ( auto &shard : shards_ )
+    {
+      counter_totals += shard.timer->getCounterTotals();
+      counter_runs += shard.timer->getCounterRunCount();
+      allocation_totals += shard.timer->getAllocationTotals();
+      allocation_runs += shard.timer->getAllocationRunCount();
+      budget_violations += shard.timer->budgetViolations();
+    }
+  }
+  return TimerBase::internalPrintStatistics( name_, getRunStatistics(), getCpuRunStatistics(), getRunPercentiles(),
+                                         getCpuRunPercentiles(), print_time_unit_, sample_period_ ) +
+         TimerBase::formatWindow( rolling_window_, getWindowStatistics(), print_time_unit_ ) +
+         TimerBase::formatCounters( counter_totals, counter_runs ) +
+         TimerBase::formatAllocations( allocation_totals, allocation_runs ) +
+         TimerBase::formatBudget( latency_budget_, budget_violations, print_time_unit_ );
+}
+}
+
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::ShardedTimerBase &timer )
+{
+  return stream << timer.toString();
+}
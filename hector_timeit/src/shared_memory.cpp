@@ -0,0 +1,316 @@
+#include "hector_timeit/shared_memory.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hector_timeit
+{
+namespace shared_memory
+{
+std::string segmentName( long pid )
+{
+  return "/hector_timeit." + std::to_string( pid );
+}
+
+size_t segmentSize( uint32_t capacity )
+{
+  return sizeof( Header ) + static_cast<size_t>(capacity) * sizeof( Entry );
+}
+
+namespace
+{
+Entry *entries( Header *header )
+{
+  return reinterpret_cast<Entry *>(reinterpret_cast<char *>(header) + header->header_size);
+}
+
+const Entry *entries( const Header *header )
+{
+  return reinterpret_cast<const Entry *>(reinterpret_cast<const char *>(header) + header->header_size);
+}
+
+long long steadyTime()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+}
+
+constexpr std::chrono::milliseconds SharedMemoryExporter::DefaultPeriod;
+constexpr int SharedMemoryReader::MaxReadAttempts;
+
+SharedMemoryExporter &SharedMemoryExporter::instance()
+{
+  // Ensures that the reporter is constructed before and, hence, destructed after the exporter
+  LiveReporter::instance();
+  static SharedMemoryExporter exporter;
+  return exporter;
+}
+
+SharedMemoryExporter::~SharedMemoryExporter()
+{
+  stop();
+}
+
+bool SharedMemoryExporter::start( std::chrono::milliseconds period, uint32_t capacity )
+{
+  stop();
+  std::string name = segmentName();
+  int fd = shm_open( name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600 );
+  if ( fd == -1 )
+  {
+    std::cerr << "hector_timeit: Failed to create shared memory segment " << name << ": " << std::strerror( errno )
+              << std::endl;
+    return false;
+  }
+  size_t size = shared_memory::segmentSize( capacity );
+  void *memory = MAP_FAILED;
+  if ( ftruncate( fd, static_cast<off_t>(size)) == 0 )
+    memory = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  int error = errno;
+  ::close( fd );
+  if ( memory == MAP_FAILED )
+  {
+    std::cerr << "hector_timeit: Failed to map shared memory segment " << name << ": " << std::strerror( error )
+              << std::endl;
+    shm_unlink( name.c_str());
+    return false;
+  }
+  // The segment is zero initialized by ftruncate, the magic is written last, so readers never see a partial header
+  header_ = new( memory ) shared_memory::Header();
+  size_ = size;
+  header_->version = shared_memory::Version;
+  header_->header_size = sizeof( shared_memory::Header );
+  header_->entry_size = sizeof( shared_memory::Entry );
+  header_->capacity = capacity;
+  header_->pid = getpid();
+  header_->period = std::chrono::duration_cast<std::chrono::nanoseconds>( period ).count();
+  header_->sequence.store( 0, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+  std::memcpy( header_->magic, shared_memory::Magic, sizeof( shared_memory::Magic ));
+
+  LiveReporter::instance().enableHistograms();
+  update();
+  std::lock_guard<std::mutex> lock( thread_mutex_ );
+  stop_ = false;
+  thread_ = std::thread( &SharedMemoryExporter::run, this, period );
+  return true;
+}
+
+void SharedMemoryExporter::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock( thread_mutex_ );
+    if ( thread_.joinable())
+    {
+      stop_ = true;
+    }
+  }
+  condition_.notify_all();
+  if ( thread_.joinable()) thread_.join();
+  if ( header_ == nullptr ) return;
+  munmap( header_, size_ );
+  shm_unlink( segmentName().c_str());
+  header_ = nullptr;
+  size_ = 0;
+  previous_histograms_.clear();
+}
+
+bool SharedMemoryExporter::isRunning() const
+{
+  return thread_.joinable();
+}
+
+std::string SharedMemoryExporter::segmentName() const
+{
+  return shared_memory::segmentName( getpid());
+}
+
+bool SharedMemoryExporter::startFromEnvironment()
+{
+  const char *value = std::getenv( "HECTOR_TIMEIT_EXPORT" );
+  if ( value == nullptr ) return false;
+  long period = std::atol( value );
+  return instance().start( period > 1 ? std::chrono::milliseconds( period ) : DefaultPeriod );
+}
+
+void SharedMemoryExporter::run( std::chrono::milliseconds period )
+{
+  std::unique_lock<std::mutex> lock( thread_mutex_ );
+  while ( !condition_.wait_for( lock, period, [ this ]() { return stop_; } ))
+  {
+    lock.unlock();
+    update();
+    lock.lock();
+  }
+}
+
+void SharedMemoryExporter::update()
+{
+  // Snapshots are taken before the sequence lock, so readers only wait for the copy into the segment
+  std::vector<LiveReporter::Entry> snapshots = LiveReporter::instance().snapshot();
+  std::vector<shared_memory::Entry> entries;
+  entries.reserve( std::min<size_t>( snapshots.size(), header_->capacity ));
+  std::unordered_map<const void *, std::vector<uint64_t>> histograms;
+  std::vector<uint64_t> interval;
+  for ( LiveReporter::Entry &snapshot : snapshots )
+  {
+    if ( entries.size() == header_->capacity ) break;
+    shared_memory::Entry entry;
+    std::memset( &entry, 0, sizeof( entry ));
+    std::strncpy( entry.name, snapshot.name.c_str(), shared_memory::NameLength - 1 );
+    entry.key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(snapshot.key));
+    entry.count = snapshot.snapshot.count;
+    entry.sum = snapshot.snapshot.sum;
+    entry.min = snapshot.snapshot.min;
+    entry.max = snapshot.snapshot.max;
+    entry.current = snapshot.snapshot.current;
+    entry.p50 = entry.p90 = entry.p99 = entry.p999 = -1;
+    if ( !snapshot.histogram.empty())
+    {
+      interval = snapshot.histogram;
+      auto previous = previous_histograms_.find( snapshot.key );
+      if ( previous != previous_histograms_.end() && previous->second.size() == interval.size())
+      {
+        // The timer may have been reset since the last update, then its histogram contains only new runs
+        bool reset = false;
+        for ( size_t i = 0; i < interval.size() && !reset; ++i ) reset = interval[i] < previous->second[i];
+        for ( size_t i = 0; i < interval.size() && !reset; ++i ) interval[i] -= previous->second[i];
+        if ( reset ) interval = snapshot.histogram;
+      }
+      entry.p50 = LiveHistogram::percentile( interval, 50 );
+      entry.p90 = LiveHistogram::percentile( interval, 90 );
+      entry.p99 = LiveHistogram::percentile( interval, 99 );
+      entry.p999 = LiveHistogram::percentile( interval, 99.9 );
+      histograms[snapshot.key] = std::move( snapshot.histogram );
+    }
+    entries.push_back( entry );
+  }
+  previous_histograms_ = std::move( histograms );
+
+  uint64_t sequence = header_->sequence.load( std::memory_order_relaxed );
+  header_->sequence.store( sequence + 1, std::memory_order_relaxed );
+  // Orders the odd sequence before the stores of the entries
+  std::atomic_thread_fence( std::memory_order_release );
+  if ( !entries.empty())
+    std::memcpy( shared_memory::entries( header_ ), entries.data(), entries.size() * sizeof( shared_memory::Entry ));
+  header_->entry_count = static_cast<uint32_t>(entries.size());
+  header_->timer_count = static_cast<uint32_t>(snapshots.size());
+  header_->update_time = shared_memory::steadyTime();
+  header_->sequence.store( sequence + 2, std::memory_order_release );
+}
+
+SharedMemoryReader::~SharedMemoryReader()
+{
+  close();
+}
+
+bool SharedMemoryReader::open( long pid, std::string &error )
+{
+  close();
+  std::string name = shared_memory::segmentName( pid );
+  int fd = shm_open( name.c_str(), O_RDONLY, 0 );
+  if ( fd == -1 )
+  {
+    error = "Process " + std::to_string( pid ) + " does not export its timers (" + std::strerror( errno ) +
+            "). Set HECTOR_TIMEIT_EXPORT or call SharedMemoryExporter::instance().start().";
+    return false;
+  }
+  struct stat info;
+  void *memory = MAP_FAILED;
+  size_t size = 0;
+  if ( fstat( fd, &info ) == 0 && static_cast<size_t>(info.st_size) >= sizeof( shared_memory::Header ))
+  {
+    size = static_cast<size_t>(info.st_size);
+    memory = mmap( nullptr, size, PROT_READ, MAP_SHARED, fd, 0 );
+  }
+  ::close( fd );
+  if ( memory == MAP_FAILED )
+  {
+    error = "Failed to map " + name + ".";
+    return false;
+  }
+  const auto *header = static_cast<const shared_memory::Header *>(memory);
+  if ( std::memcmp( header->magic, shared_memory::Magic, sizeof( shared_memory::Magic )) != 0 ||
+       header->version != shared_memory::Version || header->entry_size != sizeof( shared_memory::Entry ) ||
+       header->header_size != sizeof( shared_memory::Header ) ||
+       shared_memory::segmentSize( header->capacity ) > size )
+  {
+    error = name + " is not a compatible hector_timeit segment (expected version " +
+            std::to_string( shared_memory::Version ) + ").";
+    munmap( memory, size );
+    return false;
+  }
+  header_ = header;
+  size_ = size;
+  return true;
+}
+
+void SharedMemoryReader::close()
+{
+  if ( header_ == nullptr ) return;
+  munmap( const_cast<shared_memory::Header *>(header_), size_ );
+  header_ = nullptr;
+  size_ = 0;
+}
+
+bool SharedMemoryReader::read( Snapshot &snapshot ) const
+{
+  if ( header_ == nullptr ) return false;
+  for ( int attempt = 0; attempt < MaxReadAttempts; ++attempt )
+  {
+    uint64_t sequence = header_->sequence.load( std::memory_order_acquire );
+    if ((sequence & 1) == 0 )
+    {
+      uint32_t count = std::min( header_->entry_count, header_->capacity );
+      snapshot.pid = static_cast<long>(header_->pid);
+      snapshot.update_time = header_->update_time;
+      snapshot.period = header_->period;
+      snapshot.timer_count = header_->timer_count;
+      snapshot.entries.resize( count );
+      if ( count != 0 )
+        std::memcpy( snapshot.entries.data(), shared_memory::entries( header_ ), count * sizeof( shared_memory::Entry ));
+      // Orders the copy before the second load of the sequence
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if ( header_->sequence.load( std::memory_order_relaxed ) == sequence ) return true;
+    }
+    // The exporter may have been preempted in the middle of an update
+    if ( attempt > 100 ) std::this_thread::yield();
+  }
+  // The exporter did not finish the update, e.g., because the process died while writing
+  return false;
+}
+
+std::vector<long> SharedMemoryReader::list()
+{
+  std::vector<long> result;
+  // Linux mounts the POSIX shared memory at /dev/shm
+  DIR *directory = opendir( "/dev/shm" );
+  if ( directory == nullptr ) return result;
+  const std::string prefix = "hector_timeit.";
+  while ( dirent *entry = readdir( directory ))
+  {
+    std::string name = entry->d_name;
+    if ( name.compare( 0, prefix.size(), prefix ) != 0 ) continue;
+    char *end = nullptr;
+    long pid = std::strtol( name.c_str() + prefix.size(), &end, 10 );
+    if ( end == nullptr || *end != '\0' || pid <= 0 ) continue;
+    // Segments of crashed processes are not removed
+    if ( kill( static_cast<pid_t>(pid), 0 ) == 0 || errno == EPERM ) result.push_back( pid );
+  }
+  closedir( directory );
+  std::sort( result.begin(), result.end());
+  return result;
+}
+}
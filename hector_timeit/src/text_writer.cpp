@@ -0,0 +1,126 @@
+#include "hector_timeit/text_writer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+namespace hector_timeit
+{
+
+namespace
+{
+const double PowersOfTen[] = { 1E0, 1E1, 1E2, 1E3, 1E4, 1E5, 1E6, 1E7, 1E8, 1E9 };
+//! Scaled values below this limit are exactly representable integers, hence, the fast path can round them.
+constexpr double FastPathLimit = 9007199254740992.0; // 2^53
+
+//! Writes the digits of value right aligned into the end of the buffer and returns the first digit.
+char *formatUnsigned( unsigned long long value, char *end )
+{
+  char *it = end;
+  do
+  {
+    *--it = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while ( value != 0 );
+  return it;
+}
+}
+
+void TextWriter::write( const char *text, size_t length )
+{
+  if ( size_ + 1 < capacity_ )
+  {
+    size_t available = capacity_ - 1 - size_;
+    size_t count = length < available ? length : available;
+    std::memcpy( buffer_ + size_, text, count );
+    buffer_[size_ + count] = '\0';
+  }
+  size_ += length;
+}
+
+void TextWriter::writeRepeated( char c, size_t count )
+{
+  if ( size_ + 1 < capacity_ )
+  {
+    size_t available = capacity_ - 1 - size_;
+    size_t written = count < available ? count : available;
+    std::memset( buffer_ + size_, c, written );
+    buffer_[size_ + written] = '\0';
+  }
+  size_ += count;
+}
+
+void TextWriter::writeInteger( long long value )
+{
+  if ( value >= 0 ) return writeUnsigned( static_cast<unsigned long long>(value));
+  write( '-' );
+  // Negating the minimum would overflow, hence, negate after the conversion to unsigned
+  writeUnsigned( 0ULL - static_cast<unsigned long long>(value));
+}
+
+void TextWriter::writeUnsigned( unsigned long long value )
+{
+  char digits[24];
+  char *end = digits + sizeof( digits );
+  char *begin = formatUnsigned( value, end );
+  write( begin, static_cast<size_t>(end - begin));
+}
+
+void TextWriter::writeFixed( double value, int precision )
+{
+  if ( precision < 0 ) precision = 0;
+  if ( precision > 9 ) precision = 9;
+  if ( std::isfinite( value ))
+  {
+    double magnitude = std::fabs( value );
+    double scaled = magnitude * PowersOfTen[precision];
+    if ( scaled < FastPathLimit )
+    {
+      double integral = std::floor( scaled );
+      double fraction = scaled - integral;
+      // The scaling is off by at most one rounding error, so close to a tie the rounding direction is not known
+      if ( std::fabs( fraction - 0.5 ) > scaled * 4E-16 + 1E-300 )
+      {
+        uint64_t rounded = static_cast<uint64_t>(integral) + (fraction > 0.5 ? 1 : 0);
+        char digits[32];
+        char *end = digits + sizeof( digits );
+        char *begin = end;
+        if ( precision > 0 )
+        {
+          uint64_t divisor = static_cast<uint64_t>(PowersOfTen[precision]);
+          uint64_t decimals = rounded % divisor;
+          rounded /= divisor;
+          for ( int i = 0; i < precision; ++i )
+          {
+            *--begin = static_cast<char>('0' + decimals % 10);
+            decimals /= 10;
+          }
+          *--begin = '.';
+        }
+        begin = formatUnsigned( rounded, begin );
+        // printf keeps the sign of negative values that round to zero
+        if ( std::signbit( value )) *--begin = '-';
+        write( begin, static_cast<size_t>(end - begin));
+        return;
+      }
+    }
+  }
+  // The largest double has 309 integral digits
+  char buffer[384];
+  int length = std::snprintf( buffer, sizeof( buffer ), "%.*f", precision, value );
+  if ( length > 0 ) write( buffer, static_cast<size_t>(length) < sizeof( buffer ) ? length : sizeof( buffer ) - 1 );
+}
+
+void TextWriter::writePadded( const char *text, size_t length, size_t width )
+{
+  if ( width <= length )
+  {
+    write( text, length );
+    return;
+  }
+  size_t left = (width - length) / 2;
+  writeRepeated( ' ', left );
+  write( text, length );
+  writeRepeated( ' ', width - left - length );
+}
+}
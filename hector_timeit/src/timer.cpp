@@ -3,6 +3,7 @@
 //
 
 #include "hector_timeit/timer.h"
+#include "hector_timeit/live_reporter.h"
 
 #include <sstream>
 #include <iostream>
@@ -12,40 +13,129 @@
 namespace hector_timeit
 {
 
-Timer::Timer( std::string name, TimeUnit print_time_unit, bool autostart, bool print_on_destruct )
-  : name_( std::move( name )), print_time_unit_( print_time_unit ), print_on_destruct_( print_on_destruct )
+TimerBase::TimerBase( const std::string &name, TimeUnit print_time_unit, bool print_on_destruct,
+                      RunStorage run_storage, bool measures_cpu_time )
+  : TimerBase( NameRegistry::instance().intern( name ), print_time_unit, print_on_destruct, run_storage,
+               measures_cpu_time )
 {
-  if ( autostart ) start();
 }
 
-Timer::~Timer()
+TimerBase::TimerBase( NameId name, TimeUnit print_time_unit, bool print_on_destruct, RunStorage run_storage,
+                      bool measures_cpu_time )
+  : name_id_( name ), run_storage_( run_storage ), print_time_unit_( print_time_unit )
+    , measures_cpu_time_( measures_cpu_time ), print_on_destruct_( print_on_destruct )
 {
-  if ( print_on_destruct_ ) std::cout << *this << std::endl << std::flush;
+  if ( run_storage_ == HistogramStorage )
+  {
+    run_histogram_ = Histogram( Histogram::DefaultSignificantBits );
+    if ( measures_cpu_time_ ) cpu_run_histogram_ = Histogram( Histogram::DefaultSignificantBits );
+  }
+}
+
+TimerBase::~TimerBase()
+{
+  if ( live_registered_ ) LiveReporter::instance().remove( this );
+  endAllocations();
+}
+
+void TimerBase::printOnDestruct() const
+{
+  std::cout << *this << std::endl << std::flush;
+}
+
+void TimerBase::traceEvent( TraceEvent::Type type )
+{
+  Tracer::record( name_id_, type );
+}
+
+constexpr long TimerBase::NoBudget;
+
+void TimerBase::setLatencyBudget( long budget, BudgetCallback callback )
+{
+  latency_budget_ = budget;
+  budget_callback_ = std::move( callback );
+}
+
+void TimerBase::clearLatencyBudget()
+{
+  latency_budget_ = NoBudget;
+  budget_callback_ = BudgetCallback();
 }
 
-void Timer::reset( bool new_run )
+void TimerBase::budgetExceeded()
+{
+  // A run that is stopped and started multiple times exceeds the budget on every following stop
+  if ( budget_reported_ ) return;
+  budget_reported_ = true;
+  ++budget_violations_;
+  BudgetViolation violation{ name_id_, elapsed_time_, latency_budget_, budgetThreadId(),
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::system_clock::now().time_since_epoch()).count() };
+  if ( budget_callback_ ) budget_callback_( violation );
+  else BudgetViolationQueue::instance().push( violation );
+}
+
+void TimerBase::setRollingWindow( const RollingWindow &window )
+{
+  rolling_window_ = window;
+  rolling_window_.clear();
+}
+
+void TimerBase::finishRun( bool new_run )
 {
-  stop();
   if ( new_run )
   {
     if ( elapsed_time_ > 0 )
     {
-      run_times_.push_back( elapsed_time_ );
-      cpu_run_times_.push_back( cpu_time_valid_a_ ? elapsed_cpu_time_ : -1 );
+      if ( run_storage_ == HistogramStorage )
+      {
+        run_histogram_.record( elapsed_time_ );
+        if ( measures_cpu_time_ ) cpu_run_histogram_.record( cpu_time_valid_ ? elapsed_cpu_time_ : -1 );
+      }
+      else
+      {
+        run_times_.push_back( elapsed_time_ );
+        if ( measures_cpu_time_ ) cpu_run_times_.push_back( cpu_time_valid_ ? elapsed_cpu_time_ : -1 );
+      }
+      live_statistics_.addRun( elapsed_time_ );
+      if ( rolling_window_.enabled()) rolling_window_.add( elapsed_time_, windowTime());
+      if ( measures_counters_ && counters_valid_ )
+      {
+        counter_totals_ += elapsed_counters_;
+        ++counter_runs_;
+      }
+      if ( allocations_tracked_ )
+      {
+        allocation_totals_ += elapsed_allocations_;
+        ++allocation_runs_;
+      }
     }
   }
   else
   {
     run_times_.clear();
     cpu_run_times_.clear();
+    run_histogram_.clear();
+    cpu_run_histogram_.clear();
+    live_statistics_.clear();
+    rolling_window_.clear();
+    counter_totals_ = CounterValues();
+    counter_runs_ = 0;
+    allocation_totals_ = AllocationCounts();
+    allocation_runs_ = 0;
+    budget_violations_ = 0;
   }
   elapsed_time_ = 0;
   elapsed_cpu_time_ = 0;
-  cpu_time_valid_a_ = true;
-  cpu_time_valid_b_ = true;
+  cpu_time_valid_ = true;
+  elapsed_counters_ = CounterValues();
+  counters_valid_ = measures_counters_;
+  elapsed_allocations_ = AllocationCounts();
+  allocations_tracked_ = false;
+  budget_reported_ = false;
 }
 
-std::vector<long> Timer::getRunTimes() const
+std::vector<long> TimerBase::getRunTimes() const
 {
   std::vector<long> result = run_times_;
   long elapsed_time = getElapsedTime();
@@ -57,9 +147,10 @@ std::vector<long> Timer::getRunTimes() const
 }
 
 
-std::vector<long> Timer::getCpuRunTimes() const
+std::vector<long> TimerBase::getCpuRunTimes() const
 {
   std::vector<long> result = cpu_run_times_;
+  if ( !measures_cpu_time_ ) return result;
   long elapsed_cpu_time = getElapsedCpuTime();
   if ( elapsed_cpu_time > 0 )
   {
@@ -68,172 +159,454 @@ std::vector<long> Timer::getCpuRunTimes() const
   return result;
 }
 
-template<>
-std::unique_ptr<Timer::TimerResult<void>> Timer::time<void>( const std::function<void( void )> &function )
+RunStatistics TimerBase::getRunStatistics() const
+{
+  if ( run_storage_ == VectorStorage ) return RunStatistics::fromRunTimes( getRunTimes());
+  RunStatistics result = run_histogram_.statistics();
+  long elapsed_time = getElapsedTime();
+  if ( elapsed_time != 0 ) result.add( elapsed_time );
+  return result;
+}
+
+RunStatistics TimerBase::getCpuRunStatistics() const
 {
-  Timer timer( "anonymous" );
-  function();
-  timer.stop();
-  std::unique_ptr<Timer::TimerResult<void> > result( new Timer::TimerResult<void>());
-  result->time = timer.getElapsedTime();
-  result->cpu_time = timer.getElapsedCpuTime();
+  if ( run_storage_ == VectorStorage ) return RunStatistics::fromRunTimes( getCpuRunTimes());
+  RunStatistics result = cpu_run_histogram_.statistics();
+  long elapsed_cpu_time = getElapsedCpuTime();
+  if ( elapsed_cpu_time > 0 ) result.add( elapsed_cpu_time );
   return result;
 }
 
-std::string Timer::toString() const
+RunPercentiles TimerBase::getRunPercentiles() const
 {
-  return internalPrint( name_, getRunTimes(), getCpuRunTimes(), print_time_unit_ );
+  if ( run_storage_ == VectorStorage ) return RunPercentiles::fromRunTimes( getRunTimes());
+  return RunPercentiles::fromHistogram( run_histogram_ );
+}
+
+RunPercentiles TimerBase::getCpuRunPercentiles() const
+{
+  if ( run_storage_ == VectorStorage ) return RunPercentiles::fromRunTimes( getCpuRunTimes());
+  return RunPercentiles::fromHistogram( cpu_run_histogram_ );
+}
+
+long TimerBase::getPercentile( double percentile ) const
+{
+  if ( run_storage_ == VectorStorage ) return RunPercentiles::percentile( getRunTimes(), percentile );
+  return run_histogram_.valueAtPercentile( percentile );
+}
+
+long TimerBase::getCpuPercentile( double percentile ) const
+{
+  if ( run_storage_ == VectorStorage ) return RunPercentiles::percentile( getCpuRunTimes(), percentile );
+  return cpu_run_histogram_.valueAtPercentile( percentile );
 }
 
 namespace
 {
-void printPaddedString( std::ostringstream &stream, const std::string &text, size_t pad = 0 )
+//! Enough for the reports of most timers, larger reports are formatted a second time into a string of the right size.
+constexpr size_t StackBufferSize = 4096;
+//! Enough for any time, the largest double has 309 integral digits.
+constexpr size_t TimeBufferSize = 384;
+
+/*!
+ * Writes the text using the given function into a stack buffer and copies it into a string.
+ * If the text doesn't fit, it is written again directly into a string of the required size.
+ */
+template<typename WriteFunction>
+std::string writeToString( const WriteFunction &write )
 {
-  size_t i = 0;
-  for ( ; pad != 0 && i < (pad - text.length()) / 2; ++i ) stream << " ";
-  stream << text;
-  for ( i += text.length(); i < pad; ++i ) stream << " ";
+  char buffer[StackBufferSize];
+  TextWriter writer( buffer, sizeof( buffer ));
+  write( writer );
+  if ( !writer.truncated()) return std::string( buffer, writer.size());
+  std::string result( writer.size(), '\0' );
+  while ( true )
+  {
+    // The size may change if a running timer is written
+    TextWriter string_writer( &result[0], result.size() + 1 );
+    write( string_writer );
+    if ( !string_writer.truncated())
+    {
+      result.resize( string_writer.size());
+      return result;
+    }
+    result.resize( string_writer.size());
+  }
 }
 
+inline void writeTimeValue( TextWriter &writer, double time ) { writer.writeFixed( time, 3 ); }
+
+inline void writeTimeValue( TextWriter &writer, long time ) { writer.writeInteger( time ); }
+
+inline void writeTimeValue( TextWriter &writer, long long time ) { writer.writeInteger( time ); }
+
 template<typename T>
-void printTimeString( std::ostringstream &outstream, T time, Timer::TimeUnit print_time_unit, int pad = 0 )
+void writeTimeString( TextWriter &outwriter, T time, TimerBase::TimeUnit print_time_unit, size_t pad = 0 )
 {
-  std::ostringstream stream;
-  stream.precision( 3 );
-  stream.setf( std::ios::fixed, std::ios::floatfield );
+  char buffer[TimeBufferSize];
+  TextWriter writer( buffer, sizeof( buffer ));
   switch ( print_time_unit )
   {
-    case Timer::Seconds:
-      stream << time / 1E9 << "s";
+    case TimerBase::Seconds:
+      writer.writeFixed( time / 1E9, 3 );
+      writer.write( "s", 1 );
       break;
-    case Timer::Milliseconds:
-      stream << time / 1E6 << "ms";
+    case TimerBase::Milliseconds:
+      writer.writeFixed( time / 1E6, 3 );
+      writer.write( "ms", 2 );
       break;
-    case Timer::Microseconds:
-      stream << time / 1000.0 << "us";
+    case TimerBase::Microseconds:
+      writer.writeFixed( time / 1000.0, 3 );
+      writer.write( "us", 2 );
       break;
-    case Timer::Nanoseconds:
-      stream << time << "ns";
+    case TimerBase::Nanoseconds:
+      writeTimeValue( writer, time );
+      writer.write( "ns", 2 );
       break;
-    case Timer::Default:
+    case TimerBase::Default:
     default:
       if ( time < 5000 )
       {
-        stream << time << "ns";
+        writeTimeValue( writer, time );
+        writer.write( "ns", 2 );
       }
       else if ( time < 5E6 )
       {
-        stream << time / 1E3 << "us";
+        writer.writeFixed( time / 1E3, 3 );
+        writer.write( "us", 2 );
       }
       else if ( time < 5E9 )
       {
-        stream << time / 1E6 << "ms";
+        writer.writeFixed( time / 1E6, 3 );
+        writer.write( "ms", 2 );
       }
       else
       {
-        stream << time / 1E9 << "s";
+        writer.writeFixed( time / 1E9, 3 );
+        writer.write( "s", 1 );
       }
       break;
   }
-  printPaddedString( outstream, stream.str(), pad );
+  size_t length = writer.size() < sizeof( buffer ) ? writer.size() : sizeof( buffer ) - 1;
+  outwriter.writePadded( buffer, length, pad );
 }
 
-double square( double x ) { return x * x; }
+void writeStats( TextWriter &writer, const RunStatistics &stats, const RunPercentiles &percentiles,
+                 TimerBase::TimeUnit print_time_unit )
+{
+  if ( stats.count == 0 )
+  {
+    writer.write( "None of the runs had valid times!" );
+    return;
+  }
+  // Average
+  char buffer[2 * TimeBufferSize + 4];
+  TextWriter avg_writer( buffer, sizeof( buffer ));
+  writeTimeString( avg_writer, stats.mean, print_time_unit, 0 );
+  avg_writer.write( " +- ", 4 );
+  writeTimeString( avg_writer, sqrt( stats.variance ), print_time_unit, 0 );
+  writer.writePadded( buffer, avg_writer.size() < sizeof( buffer ) ? avg_writer.size() : sizeof( buffer ) - 1, 40 );
+  // Percentiles, unknown if the runs were only accumulated, see RunAccumulator
+  const long values[] = { percentiles.p50, percentiles.p90, percentiles.p99, percentiles.p999 };
+  for ( long value : values )
+  {
+    if ( value < 0 ) writer.writePadded( "-", 12 );
+    else writeTimeString( writer, value, print_time_unit, 12 );
+  }
+  // Longest
+  writeTimeString( writer, stats.max, print_time_unit, 16 );
+  // Shortest
+  writeTimeString( writer, stats.min, print_time_unit, 16 );
+  // Sum
+  writeTimeString( writer, stats.sum, print_time_unit, 16 );
+  if ( stats.count != stats.total_count )
+  {
+    writer.write( "\nWarning: Only " );
+    writer.writeUnsigned( stats.count );
+    writer.write( " of " );
+    writer.writeUnsigned( stats.total_count );
+    writer.write( " had valid times!" );
+  }
+}
+
+RunStatistics extrapolate( RunStatistics stats, unsigned sample_period )
+{
+  stats.count *= sample_period;
+  stats.total_count *= sample_period;
+  stats.sum *= sample_period;
+  return stats;
+}
+
+/*!
+ * Reused by every report of the thread, so reports of timers that store their runs in a vector only allocate if the
+ *  number of runs exceeds the largest number of runs reported by the thread before.
+ */
+std::vector<long> &scratchRunTimes()
+{
+  static thread_local std::vector<long> run_times;
+  return run_times;
+}
+}
+
+std::string TimerBase::formatTime( double time, TimeUnit print_time_unit )
+{
+  char buffer[TimeBufferSize];
+  TextWriter writer( buffer, sizeof( buffer ));
+  writeTime( writer, time, print_time_unit );
+  return std::string( buffer, writer.size() < sizeof( buffer ) ? writer.size() : sizeof( buffer ) - 1 );
+}
+
+void TimerBase::writeTime( TextWriter &writer, double time, TimeUnit print_time_unit )
+{
+  writeTimeString( writer, time, print_time_unit, 0 );
+}
+
+std::string TimerBase::formatCounters( const CounterValues &totals, size_t runs )
+{
+  return writeToString( [ & ]( TextWriter &writer ) { writeCounters( writer, totals, runs ); } );
+}
 
-void printStats( std::ostringstream &stream, const std::vector<long> &run_times, Timer::TimeUnit print_time_unit )
+void TimerBase::writeCounters( TextWriter &writer, const CounterValues &totals, size_t runs )
 {
-  long max = 0;
-  long min = INT64_MAX;
-  long long sum = 0;
-  size_t count = 0;
-  for ( long time : run_times )
+  if ( runs == 0 ) return;
+  writer.write( '\n' );
+  writer.writePadded( "Counters", 12 );
+  writer.writePadded( "IPC", 12 );
+  for ( int i = 0; i < CounterValues::CounterCount; ++i )
   {
-    if ( time == -1 ) continue;
-    sum += time;
-    ++count;
-    if ( time > max ) max = time;
-    if ( time < min ) min = time;
+    char header[64];
+    TextWriter header_writer( header, sizeof( header ));
+    header_writer.write( CounterValues::name( static_cast<CounterValues::Counter>(i)));
+    header_writer.write( "/run", 4 );
+    writer.writePadded( header, header_writer.size(), i == 0 ? 16 : 20 );
   }
-  double mean = (double) sum / count;
-  double var = 0;
-  for ( long time : run_times )
+  writer.write( '\n' );
+  writer.writePadded( "", 12 );
+  char buffer[TimeBufferSize];
+  TextWriter value_writer( buffer, sizeof( buffer ));
+  if ( totals[CounterValues::Cycles] != 0 )
+    value_writer.writeFixed( static_cast<double>(totals[CounterValues::Instructions]) / totals[CounterValues::Cycles], 3 );
+  else
+    value_writer.write( '-' );
+  writer.writePadded( buffer, value_writer.size(), 12 );
+  for ( int i = 0; i < CounterValues::CounterCount; ++i )
   {
-    if ( time == -1 ) continue;
-    var += square( time - mean );
+    value_writer = TextWriter( buffer, sizeof( buffer ));
+    value_writer.writeFixed( static_cast<double>(totals.values[i]) / runs, 1 );
+    writer.writePadded( buffer, value_writer.size(), i == 0 ? 16 : 20 );
   }
-  var /= (count - 1);
-  if ( count == 0 )
+}
+
+std::string TimerBase::formatAllocations( const AllocationCounts &totals, size_t runs )
+{
+  return writeToString( [ & ]( TextWriter &writer ) { writeAllocations( writer, totals, runs ); } );
+}
+
+void TimerBase::writeAllocations( TextWriter &writer, const AllocationCounts &totals, size_t runs )
+{
+  if ( runs == 0 ) return;
+  writer.write( '\n' );
+  writer.writePadded( "Heap", 12 );
+  writer.writePadded( "Allocs/run", 16 );
+  writer.writePadded( "Bytes/run", 16 );
+  writer.write( '\n' );
+  writer.writePadded( "", 12 );
+  char buffer[TimeBufferSize];
+  TextWriter value_writer( buffer, sizeof( buffer ));
+  value_writer.writeFixed( static_cast<double>(totals.count) / runs, 1 );
+  writer.writePadded( buffer, value_writer.size(), 16 );
+  value_writer = TextWriter( buffer, sizeof( buffer ));
+  value_writer.writeFixed( static_cast<double>(totals.bytes) / runs, 1 );
+  writer.writePadded( buffer, value_writer.size(), 16 );
+}
+
+void TimerBase::writeWindow( TextWriter &writer, const RollingWindow &window, const RunStatistics &window_stats,
+                             TimeUnit print_time_unit )
+{
+  if ( !window.enabled()) return;
+  writer.write( "\nWindow of the last " );
+  if ( window.mode() == RollingWindow::Time ) writeTimeString( writer, window.window(), print_time_unit );
+  else
+  {
+    writer.writeUnsigned( static_cast<unsigned long long>(window.window()));
+    writer.write( " run(s)" );
+  }
+  if ( window_stats.total_count == 0 )
   {
-    stream << "None of the runs had valid times!";
+    writer.write( ": no runs." );
     return;
   }
-  // Average
-  std::ostringstream avg_stream;
-  printTimeString( avg_stream, mean, print_time_unit, 0 );
-  avg_stream << " +- ";
-  printTimeString( avg_stream, sqrt( var ), print_time_unit, 0 );
-  printPaddedString( stream, avg_stream.str(), 40 );
-  // Longest
-  printTimeString( stream, max, print_time_unit, 16 );
-  // Shortest
-  printTimeString( stream, min, print_time_unit, 16 );
-  // Sum
-  printTimeString( stream, sum, print_time_unit, 16 );
-  if ( count != run_times.size())
+  writer.write( ": " );
+  writer.writeUnsigned( window_stats.total_count );
+  writer.write( " run(s)\n" );
+  writer.writePadded( "Window", 8 );
+  // Only the lifetime runs are stored individually, hence, there are no percentiles for the window
+  writeStats( writer, window_stats, RunPercentiles(), print_time_unit );
+}
+
+std::string TimerBase::formatWindow( const RollingWindow &window, const RunStatistics &window_stats,
+                                     TimeUnit print_time_unit )
+{
+  return writeToString( [ & ]( TextWriter &writer ) { writeWindow( writer, window, window_stats, print_time_unit ); } );
+}
+
+std::string TimerBase::formatBudget( long budget, size_t violations, TimeUnit print_time_unit )
+{
+  return writeToString( [ & ]( TextWriter &writer ) { writeBudget( writer, budget, violations, print_time_unit ); } );
+}
+
+void TimerBase::writeBudget( TextWriter &writer, long budget, size_t violations, TimeUnit print_time_unit )
+{
+  if ( budget == NoBudget ) return;
+  writer.write( "\nBudget: " );
+  writeTimeString( writer, budget, print_time_unit );
+  writer.write( ", exceeded by " );
+  writer.writeUnsigned( violations );
+  writer.write( " run(s)" );
+}
+
+size_t TimerBase::format( char *buffer, size_t size ) const
+{
+  TextWriter writer( buffer, size );
+  write( writer );
+  return writer.size();
+}
+
+void TimerBase::write( TextWriter &writer ) const
+{
+  if ( run_storage_ == VectorStorage )
   {
-    stream << std::endl << "Warning: Only " << count << " of " << run_times.size() << " had valid times!";
+    // Same as getRunTimes() and getCpuRunTimes() but without copying the runs into new vectors
+    std::vector<long> &run_times = scratchRunTimes();
+    run_times.assign( run_times_.begin(), run_times_.end());
+    long elapsed_time = getElapsedTime();
+    if ( elapsed_time != 0 ) run_times.push_back( elapsed_time );
+    RunStatistics run_stats = RunStatistics::fromRunTimes( run_times );
+    RunPercentiles run_percentiles = RunPercentiles::fromRunTimesInPlace( run_times );
+    run_times.assign( cpu_run_times_.begin(), cpu_run_times_.end());
+    if ( measures_cpu_time_ )
+    {
+      long elapsed_cpu_time = getElapsedCpuTime();
+      if ( elapsed_cpu_time > 0 ) run_times.push_back( elapsed_cpu_time );
+    }
+    RunStatistics cpu_run_stats = RunStatistics::fromRunTimes( run_times );
+    RunPercentiles cpu_run_percentiles = RunPercentiles::fromRunTimesInPlace( run_times );
+    internalWriteStatistics( writer, name(), run_stats, cpu_run_stats, run_percentiles, cpu_run_percentiles,
+                             print_time_unit_, sample_period_ );
   }
+  else
+  {
+    internalWriteStatistics( writer, name(), getRunStatistics(), getCpuRunStatistics(), getRunPercentiles(),
+                             getCpuRunPercentiles(), print_time_unit_, sample_period_ );
+  }
+  writeWindow( writer, rolling_window_, getWindowStatistics(), print_time_unit_ );
+  writeCounters( writer, counter_totals_, counter_runs_ );
+  writeAllocations( writer, allocation_totals_, allocation_runs_ );
+  writeBudget( writer, latency_budget_, budget_violations_, print_time_unit_ );
 }
+
+std::string TimerBase::toString() const
+{
+  return writeToString( [ this ]( TextWriter &writer ) { write( writer ); } );
 }
 
-std::string Timer::internalPrint( const std::string &name, const std::vector<long> &run_times,
+std::string TimerBase::internalPrint( const std::string &name, const std::vector<long> &run_times,
                                   const std::vector<long> &cpu_run_times, TimeUnit print_time_unit )
 {
-  std::ostringstream stringstream;
-  stringstream << "[Timer: " << name << "] " << run_times.size() << " run(s) took: ";
-  if ( run_times.empty())
+  return internalPrintStatistics( name, RunStatistics::fromRunTimes( run_times ),
+                                  RunStatistics::fromRunTimes( cpu_run_times ),
+                                  RunPercentiles::fromRunTimes( run_times ),
+                                  RunPercentiles::fromRunTimes( cpu_run_times ), print_time_unit );
+}
+
+std::string TimerBase::internalPrintStatistics( const std::string &name, const RunStatistics &run_stats,
+                                                const RunStatistics &cpu_run_stats,
+                                                const RunPercentiles &run_percentiles,
+                                                const RunPercentiles &cpu_run_percentiles, TimeUnit print_time_unit,
+                                                unsigned sample_period )
+{
+  return writeToString( [ & ]( TextWriter &writer )
   {
-    stringstream << "no time at all.";
+    internalWriteStatistics( writer, name, run_stats, cpu_run_stats, run_percentiles, cpu_run_percentiles,
+                             print_time_unit, sample_period );
+  } );
+}
+
+void TimerBase::internalWriteStatistics( TextWriter &writer, const std::string &name,
+                                         const RunStatistics &measured_run_stats,
+                                         const RunStatistics &measured_cpu_run_stats,
+                                         const RunPercentiles &run_percentiles,
+                                         const RunPercentiles &cpu_run_percentiles, TimeUnit print_time_unit,
+                                         unsigned sample_period )
+{
+  // Only the count and the sum are extrapolated, the other statistics are estimated by the measured runs
+  const RunStatistics run_stats = extrapolate( measured_run_stats, sample_period );
+  const RunStatistics cpu_run_stats = extrapolate( measured_cpu_run_stats, sample_period );
+  writer.write( "[Timer: " );
+  writer.write( name );
+  writer.write( "] " );
+  if ( sample_period > 1 ) writer.write( '~' );
+  writer.writeUnsigned( run_stats.total_count );
+  writer.write( " run(s) " );
+  if ( sample_period > 1 )
+  {
+    writer.write( "(sampled 1 in " );
+    writer.writeUnsigned( sample_period );
+    writer.write( ", " );
+    writer.writeUnsigned( measured_run_stats.total_count );
+    writer.write( " measured) " );
   }
-  else if ( run_times.size() == 1 )
+  writer.write( "took: " );
+  if ( run_stats.total_count == 0 )
   {
-    printTimeString( stringstream, run_times[0], print_time_unit, 0 );
-    if ( cpu_run_times[0] != -1 )
+    writer.write( "no time at all." );
+  }
+  else if ( run_stats.total_count == 1 )
+  {
+    writeTimeString( writer, run_stats.sum, print_time_unit, 0 );
+    if ( cpu_run_stats.count != 0 )
     {
 #ifdef _POSIX_THREAD_CPUTIME
-      printPaddedString( stringstream, " (Thread: ", 0 );
+      writer.write( " (Thread: " );
 #else
-      printPaddedString( stringstream, " (CPU: ", 0 );
+      writer.write( " (CPU: " );
 #endif
-      printTimeString( stringstream, cpu_run_times[0], print_time_unit, 0 );
-      stringstream << ")";
+      writeTimeString( writer, cpu_run_stats.sum, print_time_unit, 0 );
+      writer.write( ')' );
     }
-    stringstream << ".";
+    writer.write( '.' );
   }
   else
   {
-    stringstream << std::endl;
-    printPaddedString( stringstream, "Type", 8 );
-    printPaddedString( stringstream, "Mean (+/- stddev)", 40 );
-    printPaddedString( stringstream, "Longest", 16 );
-    printPaddedString( stringstream, "Shortest", 16 );
-    printPaddedString( stringstream, "Sum", 16 );
-    stringstream << std::endl;
-    printPaddedString( stringstream, "Real", 8 );
-    printStats( stringstream, run_times, print_time_unit );
-    stringstream << std::endl;
+    writer.write( '\n' );
+    writer.writePadded( "Type", 8 );
+    writer.writePadded( "Mean (+/- stddev)", 40 );
+    writer.writePadded( "Median", 12 );
+    writer.writePadded( "P90", 12 );
+    writer.writePadded( "P99", 12 );
+    writer.writePadded( "P99.9", 12 );
+    writer.writePadded( "Longest", 16 );
+    writer.writePadded( "Shortest", 16 );
+    writer.writePadded( "Sum", 16 );
+    writer.write( '\n' );
+    writer.writePadded( "Real", 8 );
+    writeStats( writer, run_stats, run_percentiles, print_time_unit );
+    // Timers that don't measure the cpu time have no cpu runs
+    if ( cpu_run_stats.total_count != 0 )
+    {
+      writer.write( '\n' );
 #ifdef _POSIX_THREAD_CPUTIME
-    printPaddedString( stringstream, "Thread", 8 );
+      writer.writePadded( "Thread", 8 );
 #else
-    printPaddedString(stringstream, "CPU", 8);
+      writer.writePadded( "CPU", 8 );
 #endif
-    printStats( stringstream, cpu_run_times, print_time_unit );
+      writeStats( writer, cpu_run_stats, cpu_run_percentiles, print_time_unit );
+    }
   }
-  return stringstream.str();
 }
 }
 
-std::ostream &operator<<( std::ostream &stream, const hector_timeit::Timer &timer )
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::TimerBase &timer )
 {
   return stream << timer.toString();
 }
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <signal.h>
+
+#include "hector_timeit/shared_memory.h"
+
+using namespace hector_timeit;
+
+namespace
+{
+volatile std::sig_atomic_t interrupted = 0;
+
+void onInterrupt( int )
+{
+  interrupted = 1;
+}
+
+void printUsage( const char *executable )
+{
+  std::cerr << "Usage: " << executable << " [-d SECONDS] [-n ITERATIONS] [PID]" << std::endl
+            << "Shows the live timer statistics of a process that exports them through shared memory." << std::endl
+            << "Start the process with HECTOR_TIMEIT_EXPORT=1 or call SharedMemoryExporter::instance().start()."
+            << std::endl
+            << "Without a PID, lists the processes that export their timers." << std::endl
+            << "  -d SECONDS     The delay between two refreshes (default: 1)." << std::endl
+            << "  -n ITERATIONS  Exits after the given number of refreshes." << std::endl;
+}
+
+//! Formats a time in nanoseconds using the largest unit that keeps at least one integer digit.
+std::string formatTime( double time )
+{
+  if ( time < 0 ) return "-";
+  char buffer[32];
+  if ( time < 1E3 ) std::snprintf( buffer, sizeof( buffer ), "%.0fns", time );
+  else if ( time < 1E6 ) std::snprintf( buffer, sizeof( buffer ), "%.2fus", time / 1E3 );
+  else if ( time < 1E9 ) std::snprintf( buffer, sizeof( buffer ), "%.2fms", time / 1E6 );
+  else std::snprintf( buffer, sizeof( buffer ), "%.2fs", time / 1E9 );
+  return buffer;
+}
+
+struct Row
+{
+  const shared_memory::Entry *entry;
+  double rate;
+  double interval_mean;
+};
+
+void printSnapshot( const SharedMemoryReader::Snapshot &snapshot,
+                    const std::unordered_map<uint64_t, shared_memory::Entry> &previous, double elapsed )
+{
+  std::vector<Row> rows;
+  rows.reserve( snapshot.entries.size());
+  for ( const shared_memory::Entry &entry : snapshot.entries )
+  {
+    Row row = { &entry, 0, -1 };
+    auto it = previous.find( entry.key );
+    // Without a previous snapshot or after a reset of the timer, the rate is unknown
+    if ( it != previous.end() && entry.count >= it->second.count && elapsed > 0 )
+    {
+      uint64_t runs = entry.count - it->second.count;
+      row.rate = static_cast<double>(runs) / elapsed;
+      if ( runs != 0 ) row.interval_mean = static_cast<double>(entry.sum - it->second.sum) / static_cast<double>(runs);
+    }
+    rows.push_back( row );
+  }
+  std::stable_sort( rows.begin(), rows.end(), []( const Row &a, const Row &b ) { return a.rate > b.rate; } );
+
+  // Clears the screen and moves the cursor to the top left like top
+  std::printf( "\033[H\033[2J" );
+  std::printf( "hector_timeit_top - PID %ld - %zu timer(s)", snapshot.pid, snapshot.timer_count );
+  if ( snapshot.timer_count > snapshot.entries.size())
+    std::printf( ", showing the first %zu", snapshot.entries.size());
+  std::printf( " - export period %s\n\n", formatTime( static_cast<double>(snapshot.period)).c_str());
+  std::printf( "%-40s %10s %9s %10s %10s %10s %10s %10s %10s %10s\n", "NAME", "RUNS", "RUNS/S", "MEAN(INT)", "MEAN",
+               "P50", "P99", "P99.9", "MAX", "CURRENT" );
+  for ( const Row &row : rows )
+  {
+    const shared_memory::Entry &entry = *row.entry;
+    double mean = entry.count == 0 ? -1 : static_cast<double>(entry.sum) / static_cast<double>(entry.count);
+    std::printf( "%-40.40s %10llu %9.1f %10s %10s %10s %10s %10s %10s %10s\n", entry.name,
+                 static_cast<unsigned long long>(entry.count), row.rate, formatTime( row.interval_mean ).c_str(),
+                 formatTime( mean ).c_str(), formatTime( static_cast<double>(entry.p50)).c_str(),
+                 formatTime( static_cast<double>(entry.p99)).c_str(),
+                 formatTime( static_cast<double>(entry.p999)).c_str(),
+                 formatTime( entry.count == 0 ? -1 : static_cast<double>(entry.max)).c_str(),
+                 formatTime( static_cast<double>(entry.current)).c_str());
+  }
+  std::printf( "\nMEAN(INT) and the percentiles cover the runs of the last export period.\n" );
+  std::fflush( stdout );
+}
+
+bool isAlive( long pid )
+{
+  return kill( static_cast<pid_t>(pid), 0 ) == 0 || errno == EPERM;
+}
+}
+
+int main( int argc, char **argv )
+{
+  double delay = 1;
+  long iterations = -1;
+  long pid = 0;
+  for ( int i = 1; i < argc; ++i )
+  {
+    std::string arg = argv[i];
+    if ((arg == "-d" || arg == "-n") && i + 1 < argc )
+    {
+      char *end = nullptr;
+      if ( arg == "-d" ) delay = std::strtod( argv[++i], &end );
+      else iterations = std::strtol( argv[++i], &end, 10 );
+      if ( *end == '\0' && delay > 0 ) continue;
+    }
+    else if ( arg[0] != '-' && pid == 0 )
+    {
+      char *end = nullptr;
+      pid = std::strtol( arg.c_str(), &end, 10 );
+      if ( *end == '\0' && pid > 0 ) continue;
+    }
+    printUsage( argv[0] );
+    return 1;
+  }
+
+  if ( pid == 0 )
+  {
+    std::vector<long> pids = SharedMemoryReader::list();
+    if ( pids.empty())
+    {
+      std::cout << "No process exports its timers. Start it with HECTOR_TIMEIT_EXPORT=1." << std::endl;
+      return 1;
+    }
+    for ( long exporting : pids ) std::cout << exporting << std::endl;
+    return 0;
+  }
+
+  SharedMemoryReader reader;
+  std::string error;
+  if ( !reader.open( pid, error ))
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+  std::signal( SIGINT, onInterrupt );
+  std::signal( SIGTERM, onInterrupt );
+
+  SharedMemoryReader::Snapshot snapshot;
+  // Keyed by the timer since different timers may have the same name
+  std::unordered_map<uint64_t, shared_memory::Entry> previous;
+  long long previous_time = 0;
+  for ( long iteration = 0; !interrupted && iteration != iterations; ++iteration )
+  {
+    if ( iteration != 0 )
+    {
+      std::this_thread::sleep_for( std::chrono::duration<double>( delay ));
+      if ( interrupted ) break;
+    }
+    // A failed read may also mean that the process died in the middle of an update
+    if ( !reader.read( snapshot ) || !isAlive( pid ))
+    {
+      if ( isAlive( pid )) continue;
+      std::cout << "Process " << pid << " exited." << std::endl;
+      return 0;
+    }
+    // Keeps showing the previous rates until the exporter updated the segment
+    if ( snapshot.update_time == previous_time ) continue;
+    // Rates use the update times of the exporter, so they are exact regardless of the refresh delay
+    double elapsed = static_cast<double>(snapshot.update_time - previous_time) / 1E9;
+    printSnapshot( snapshot, previous, previous_time == 0 ? 0 : elapsed );
+    previous.clear();
+    for ( const shared_memory::Entry &entry : snapshot.entries ) previous[entry.key] = entry;
+    previous_time = snapshot.update_time;
+  }
+  return 0;
+}
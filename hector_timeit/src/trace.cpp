@@ -0,0 +1,380 @@
+#include "hector_timeit/trace.h"
+#include "hector_timeit/trace_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#ifdef __linux__
+
+#include <sys/syscall.h>
+
+#endif
+
+#ifdef __unix__
+
+#include <unistd.h>
+
+#endif
+
+namespace hector_timeit
+{
+
+constexpr size_t Tracer::DefaultEventsPerThread;
+
+std::atomic<bool> Tracer::enabled_( false );
+
+namespace
+{
+size_t nextPowerOfTwo( size_t value )
+{
+  size_t result = 1;
+  while ( result < value ) result <<= 1;
+  return result;
+}
+
+long currentThreadId()
+{
+#ifdef __linux__
+  return static_cast<long>(syscall( SYS_gettid ));
+#else
+  return static_cast<long>(std::hash<std::thread::id>()( std::this_thread::get_id()) & 0x7FFFFFFF);
+#endif
+}
+
+long currentProcessId()
+{
+#ifdef __unix__
+  return static_cast<long>(getpid());
+#else
+  return 0;
+#endif
+}
+
+void writeJsonString( std::ostream &stream, const std::string &text )
+{
+  stream << '"';
+  for ( char c : text )
+  {
+    if ( c == '"' || c == '\\' ) stream << '\\' << c;
+    else if ( static_cast<unsigned char>(c) < 0x20 )
+    {
+      char buffer[8];
+      snprintf( buffer, sizeof( buffer ), "\\u%04x", c );
+      stream << buffer;
+    }
+    else stream << c;
+  }
+  stream << '"';
+}
+}
+
+TraceBuffer::TraceBuffer( size_t capacity, long thread_id, bool streaming )
+  : events_( nextPowerOfTwo( capacity == 0 ? 1 : capacity )), written_( 0 ), flushed_( 0 ), cleared_( 0 )
+    , dropped_( 0 ), dropped_cleared_( 0 ), streaming_( streaming ), finished_( false ), thread_id_( thread_id )
+{
+  mask_ = events_.size() - 1;
+}
+
+size_t TraceBuffer::begin( size_t written ) const
+{
+  size_t oldest = written - std::min( written, events_.size());
+  return std::max( oldest, std::min( written, cleared_.load( std::memory_order_relaxed )));
+}
+
+size_t TraceBuffer::size() const
+{
+  size_t written = writtenCount();
+  return written - begin( written );
+}
+
+size_t TraceBuffer::droppedCount() const
+{
+  size_t written = writtenCount();
+  size_t dropped = dropped_.load( std::memory_order_relaxed ) - dropped_cleared_.load( std::memory_order_relaxed );
+  if ( streaming_.load( std::memory_order_relaxed )) return dropped;
+  // In ring mode, the events that were neither flushed, cleared nor are still in the buffer were overwritten
+  size_t kept = std::max( flushedCount(), cleared_.load( std::memory_order_relaxed )) + events_.size();
+  return written <= kept ? dropped : dropped + written - kept;
+}
+
+void TraceBuffer::setStreaming( bool streaming )
+{
+  if ( streaming )
+  {
+    size_t written = writtenCount();
+    flushed_.store( begin( written ), std::memory_order_release );
+  }
+  streaming_.store( streaming, std::memory_order_release );
+}
+
+void TraceBuffer::clear()
+{
+  // The owning thread only advances written_ and dropped_, so the clear is recorded in the consumer's positions
+  size_t written = writtenCount();
+  cleared_.store( written, std::memory_order_relaxed );
+  dropped_cleared_.store( dropped_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+  // Frees the slots of the discarded events for the owning thread
+  if ( streaming_.load( std::memory_order_relaxed )) flushed_.store( written, std::memory_order_release );
+}
+
+bool TraceBuffer::drained() const
+{
+  if ( streaming_.load( std::memory_order_relaxed )) return flushedCount() == writtenCount();
+  return size() == 0;
+}
+
+std::vector<TraceEvent> TraceBuffer::events() const
+{
+  size_t written = writtenCount();
+  std::vector<TraceEvent> result;
+  result.reserve( written - begin( written ));
+  for ( size_t i = begin( written ); i < written; ++i ) result.push_back( events_[i & mask_] );
+  return result;
+}
+
+struct Tracer::LocalBufferOwner
+{
+  std::shared_ptr<TraceBuffer> buffer;
+
+  ~LocalBufferOwner()
+  {
+    thread_exiting = true;
+    // Timers destructed later by this thread must not record into a buffer the tracer may release
+    localBuffer() = nullptr;
+    if ( buffer != nullptr ) buffer->finish();
+  }
+
+  //! Set once the owner of the thread was destructed. Trivially destructible, hence, still valid afterwards.
+  static thread_local bool thread_exiting;
+};
+
+thread_local bool Tracer::LocalBufferOwner::thread_exiting = false;
+
+Tracer &Tracer::instance()
+{
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer()
+{
+  // Construct the registry first, so it is destroyed after the tracer which needs the names to write the trace on exit
+  NameRegistry::instance();
+}
+
+const std::string &TraceData::name( NameId id ) const
+{
+  static const std::string unknown = "unknown";
+  return id < names.size() ? names[id] : unknown;
+}
+
+void TraceData::writeChromeTrace( std::ostream &stream ) const
+{
+  bool first = true;
+  auto writeEvent = [&]( NameId name, char phase, long long timestamp, long long duration, long thread_id )
+  {
+    if ( !first ) stream << ",";
+    first = false;
+    stream << "\n{\"name\":";
+    writeJsonString( stream, this->name( name ));
+    // Timestamps are in microseconds
+    char buffer[32];
+    snprintf( buffer, sizeof( buffer ), "%lld.%03lld", timestamp / 1000, timestamp % 1000 );
+    stream << ",\"ph\":\"" << phase << "\",\"ts\":" << buffer;
+    if ( phase == 'X' )
+    {
+      snprintf( buffer, sizeof( buffer ), "%lld.%03lld", duration / 1000, duration % 1000 );
+      stream << ",\"dur\":" << buffer;
+    }
+    stream << ",\"pid\":" << process_id << ",\"tid\":" << thread_id << "}";
+  };
+
+  stream << "{\"traceEvents\":[";
+  for ( const Thread &thread : threads )
+  {
+    // Timers don't have to be nested, e.g., two timers can be started and stopped in the same order. Hence, begins and
+    //  ends are matched by name and written as complete events instead of begin and end events.
+    std::vector<std::vector<long long>> open_begins;
+    for ( const TraceEvent &event : thread.events )
+    {
+      if ( open_begins.size() <= event.name ) open_begins.resize( event.name + 1 );
+      std::vector<long long> &begins = open_begins[event.name];
+      if ( event.type == TraceEvent::Begin )
+      {
+        begins.push_back( event.timestamp );
+        continue;
+      }
+      if ( begins.empty()) continue;
+      writeEvent( event.name, 'X', begins.back(), event.timestamp - begins.back(), thread.thread_id );
+      begins.pop_back();
+    }
+    // Still running when the trace was written
+    for ( size_t name = 0; name < open_begins.size(); ++name )
+    {
+      for ( long long begin : open_begins[name] )
+        writeEvent( static_cast<NameId>(name), 'B', begin, 0, thread.thread_id );
+    }
+  }
+  stream << "\n],\"displayTimeUnit\":\"ns\"}" << std::endl;
+}
+
+Tracer::~Tracer()
+{
+  disable();
+  if ( !path_.empty()) writeChromeTrace( path_ );
+}
+
+void Tracer::enable( size_t events_per_thread, const std::string &path )
+{
+  {
+    std::lock_guard<std::mutex> lock( mutex_ );
+    events_per_thread_ = events_per_thread;
+    path_ = path;
+  }
+  // The events are timestamped using the TscClock
+  TscClock::calibrate();
+  enabled_.store( true );
+}
+
+bool Tracer::enableFile( const std::string &path, size_t events_per_thread, long flush_interval_ms )
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  if ( file_writer_ != nullptr ) return false;
+  std::unique_ptr<TraceFileWriter> writer( new TraceFileWriter());
+  if ( !writer->open( path )) return false;
+  file_writer_ = std::move( writer );
+  events_per_thread_ = events_per_thread;
+  for ( auto &buffer : buffers_ ) buffer->setStreaming( true );
+  {
+    std::lock_guard<std::mutex> flush_lock( flush_mutex_ );
+    stop_flushing_ = false;
+  }
+  flush_thread_ = std::thread( &Tracer::flushLoop, this, flush_interval_ms );
+  TscClock::calibrate();
+  enabled_.store( true );
+  return true;
+}
+
+void Tracer::disable()
+{
+  enabled_.store( false );
+  if ( !flush_thread_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> flush_lock( flush_mutex_ );
+    stop_flushing_ = true;
+  }
+  flush_condition_.notify_all();
+  flush_thread_.join();
+  std::lock_guard<std::mutex> lock( mutex_ );
+  for ( auto &buffer : buffers_ ) buffer->setStreaming( false );
+  file_writer_.reset();
+}
+
+void Tracer::flushLoop( long flush_interval_ms )
+{
+  std::unique_lock<std::mutex> flush_lock( flush_mutex_ );
+  while ( !stop_flushing_ )
+  {
+    flush_condition_.wait_for( flush_lock, std::chrono::milliseconds( flush_interval_ms ));
+    flush_lock.unlock();
+    flush();
+    flush_lock.lock();
+  }
+}
+
+void Tracer::flush()
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  if ( file_writer_ == nullptr ) return;
+  for ( auto &buffer : buffers_ )
+  {
+    size_t written = buffer->writtenCount();
+    size_t flushed = buffer->flushedCount();
+    if ( written == flushed ) continue;
+    file_writer_->writeEvents( *buffer, flushed, written );
+    buffer->setFlushedCount( written );
+  }
+  // After the events, so all names used by the events are interned
+  file_writer_->writeNames( NameRegistry::instance());
+  file_writer_->commit();
+  releaseFinishedBuffers();
+}
+
+void Tracer::clear()
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  for ( auto &buffer : buffers_ ) buffer->clear();
+  released_dropped_ = 0;
+  releaseFinishedBuffers();
+}
+
+size_t Tracer::eventCount() const
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  size_t result = 0;
+  for ( auto &buffer : buffers_ ) result += buffer->size();
+  return result;
+}
+
+size_t Tracer::droppedEventCount() const
+{
+  std::lock_guard<std::mutex> lock( mutex_ );
+  size_t result = released_dropped_;
+  for ( auto &buffer : buffers_ ) result += buffer->droppedCount();
+  return result;
+}
+
+TraceBuffer *Tracer::registerThread()
+{
+  if ( LocalBufferOwner::thread_exiting ) return nullptr;
+  static thread_local LocalBufferOwner owner;
+  std::lock_guard<std::mutex> lock( mutex_ );
+  releaseFinishedBuffers();
+  buffers_.emplace_back( std::make_shared<TraceBuffer>( events_per_thread_, currentThreadId(), file_writer_ != nullptr ));
+  owner.buffer = buffers_.back();
+  localBuffer() = owner.buffer.get();
+  return localBuffer();
+}
+
+void Tracer::releaseFinishedBuffers()
+{
+  auto end = std::remove_if( buffers_.begin(), buffers_.end(), [ this ]( const std::shared_ptr<TraceBuffer> &buffer )
+  {
+    if ( !buffer->finished() || !buffer->drained()) return false;
+    released_dropped_ += buffer->droppedCount();
+    return true;
+  } );
+  buffers_.erase( end, buffers_.end());
+}
+
+TraceData Tracer::data() const
+{
+  TraceData result;
+  result.process_id = currentProcessId();
+  {
+    std::lock_guard<std::mutex> lock( mutex_ );
+    for ( auto &buffer : buffers_ ) result.threads.push_back( TraceData::Thread{ buffer->threadId(), buffer->events() } );
+  }
+  NameRegistry &registry = NameRegistry::instance();
+  size_t count = registry.size();
+  result.names.reserve( count );
+  for ( size_t id = 0; id < count; ++id ) result.names.push_back( registry.name( static_cast<NameId>(id)));
+  return result;
+}
+
+void Tracer::writeChromeTrace( std::ostream &stream ) const
+{
+  data().writeChromeTrace( stream );
+}
+
+bool Tracer::writeChromeTrace( const std::string &path ) const
+{
+  std::ofstream stream( path );
+  if ( !stream ) return false;
+  writeChromeTrace( stream );
+  return static_cast<bool>(stream);
+}
+}
@@ -0,0 +1,55 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "hector_timeit/trace_file.h"
+
+void printUsage( const char *executable )
+{
+  std::cerr << "Usage: " << executable << " TRACE_FILE [--text | --json [OUTPUT_FILE]]" << std::endl
+            << "Converts a binary trace file written by Tracer::enableFile." << std::endl
+            << "  --text  Prints the timer report of every traced name (default)." << std::endl
+            << "  --json  Writes Chrome trace-event JSON to OUTPUT_FILE or stdout." << std::endl;
+}
+
+int main( int argc, char **argv )
+{
+  if ( argc < 2 || argc > 4 )
+  {
+    printUsage( argv[0] );
+    return 1;
+  }
+  std::string mode = argc > 2 ? argv[2] : "--text";
+  if ((mode != "--text" && mode != "--json") || (mode == "--text" && argc > 3))
+  {
+    printUsage( argv[0] );
+    return 1;
+  }
+
+  hector_timeit::TraceData data;
+  std::string error;
+  if ( !hector_timeit::readTraceFile( argv[1], data, error ))
+  {
+    std::cerr << "Failed to read " << argv[1] << ": " << error << std::endl;
+    return 1;
+  }
+
+  if ( mode == "--text" )
+  {
+    std::cout << hector_timeit::traceReport( data ) << std::endl;
+    return 0;
+  }
+  if ( argc < 4 )
+  {
+    data.writeChromeTrace( std::cout );
+    return 0;
+  }
+  std::ofstream stream( argv[3] );
+  if ( !stream )
+  {
+    std::cerr << "Could not open " << argv[3] << std::endl;
+    return 1;
+  }
+  data.writeChromeTrace( stream );
+  return stream ? 0 : 1;
+}
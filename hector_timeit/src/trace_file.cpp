@@ -0,0 +1,287 @@
+#include "hector_timeit/trace_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace hector_timeit
+{
+
+constexpr uint32_t TraceFileWriter::Version;
+constexpr size_t TraceFileWriter::HeaderSize;
+
+namespace
+{
+const char Magic[8] = { 'H', 'T', 'I', 'M', 'E', 'I', 'T', '\0' };
+constexpr size_t InitialFileSize = 1 << 20;
+constexpr size_t MaxVarintSize = 10;
+
+enum RecordType
+{
+  NameRecord = 1,
+  EventsRecord = 2
+};
+
+void writeLittleEndian( char *data, uint64_t value, size_t bytes )
+{
+  for ( size_t i = 0; i < bytes; ++i ) data[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+uint64_t readLittleEndian( const char *data, size_t bytes )
+{
+  uint64_t result = 0;
+  for ( size_t i = 0; i < bytes; ++i ) result |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+  return result;
+}
+
+inline uint64_t zigzag( long long value )
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline long long unzigzag( uint64_t value )
+{
+  return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+}
+
+TraceFileWriter::~TraceFileWriter()
+{
+  close();
+}
+
+bool TraceFileWriter::open( const std::string &path )
+{
+  close();
+  fd_ = ::open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+  if ( fd_ == -1 ) return false;
+  if ( ftruncate( fd_, InitialFileSize ) != 0 )
+  {
+    ::close( fd_ );
+    fd_ = -1;
+    return false;
+  }
+  void *data = mmap( nullptr, InitialFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+  if ( data == MAP_FAILED )
+  {
+    ::close( fd_ );
+    fd_ = -1;
+    return false;
+  }
+  data_ = static_cast<char *>(data);
+  capacity_ = InitialFileSize;
+  std::memset( data_, 0, HeaderSize );
+  std::memcpy( data_, Magic, sizeof( Magic ));
+  writeLittleEndian( data_ + 8, Version, 4 );
+  writeLittleEndian( data_ + 12, HeaderSize, 4 );
+  writeLittleEndian( data_ + 24, static_cast<uint64_t>(getpid()), 8 );
+  size_ = HeaderSize;
+  names_written_ = 0;
+  good_ = true;
+  commit();
+  return true;
+}
+
+bool TraceFileWriter::reserve( size_t bytes )
+{
+  if ( size_ + bytes <= capacity_ ) return true;
+  size_t capacity = std::max( 2 * capacity_, size_ + bytes );
+  if ( ftruncate( fd_, capacity ) != 0 ) return good_ = false;
+  // Map the grown file before unmapping the old mapping, so the old mapping stays valid if mapping fails
+  void *data = mmap( nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+  if ( data == MAP_FAILED ) return good_ = false;
+  munmap( data_, capacity_ );
+  data_ = static_cast<char *>(data);
+  capacity_ = capacity;
+  return true;
+}
+
+void TraceFileWriter::writeNames( const NameRegistry &registry )
+{
+  if ( !isOpen()) return;
+  NameId count = static_cast<NameId>(registry.size());
+  for ( ; names_written_ < count; ++names_written_ )
+  {
+    std::string name = registry.name( names_written_ );
+    if ( !reserve( 1 + 2 * MaxVarintSize + name.size())) return;
+    data_[size_++] = NameRecord;
+    writeVarint( names_written_ );
+    writeVarint( name.size());
+    std::memcpy( data_ + size_, name.data(), name.size());
+    size_ += name.size();
+  }
+}
+
+void TraceFileWriter::writeEvents( const TraceBuffer &buffer, size_t begin, size_t end )
+{
+  if ( !isOpen() || begin >= end ) return;
+  if ( !reserve( 1 + 3 * MaxVarintSize + (end - begin) * 2 * MaxVarintSize )) return;
+  data_[size_++] = EventsRecord;
+  writeVarint( static_cast<uint64_t>(buffer.threadId()));
+  writeVarint( end - begin );
+  long long previous = buffer.event( begin ).timestamp;
+  writeVarint( static_cast<uint64_t>(previous));
+  for ( size_t i = begin; i < end; ++i )
+  {
+    const TraceEvent &event = buffer.event( i );
+    writeVarint((zigzag( event.timestamp - previous ) << 1) | (event.type & 1));
+    writeVarint( event.name );
+    previous = event.timestamp;
+  }
+}
+
+void TraceFileWriter::commit()
+{
+  if ( !isOpen()) return;
+  writeLittleEndian( data_ + 16, size_ - HeaderSize, 8 );
+}
+
+void TraceFileWriter::close()
+{
+  if ( !isOpen()) return;
+  commit();
+  munmap( data_, capacity_ );
+  data_ = nullptr;
+  if ( ftruncate( fd_, size_ ) != 0 ) good_ = false;
+  ::close( fd_ );
+  fd_ = -1;
+  capacity_ = 0;
+}
+
+namespace
+{
+bool readVarint( const char *&data, const char *end, uint64_t &value )
+{
+  value = 0;
+  for ( int shift = 0; data < end && shift < 64; shift += 7 )
+  {
+    unsigned char byte = static_cast<unsigned char>(*data++);
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0 ) return true;
+  }
+  return false;
+}
+}
+
+bool readTraceFile( const std::string &path, TraceData &data, std::string &error )
+{
+  std::ifstream stream( path, std::ios::binary );
+  if ( !stream )
+  {
+    error = "Could not open " + path;
+    return false;
+  }
+  std::string content(( std::istreambuf_iterator<char>( stream )), std::istreambuf_iterator<char>());
+  if ( content.size() < TraceFileWriter::HeaderSize || std::memcmp( content.data(), Magic, sizeof( Magic )) != 0 )
+  {
+    error = "Not a hector_timeit trace file";
+    return false;
+  }
+  uint64_t version = readLittleEndian( content.data() + 8, 4 );
+  uint64_t header_size = readLittleEndian( content.data() + 12, 4 );
+  uint64_t data_size = readLittleEndian( content.data() + 16, 8 );
+  if ( version != TraceFileWriter::Version )
+  {
+    error = "Unsupported trace file version " + std::to_string( version );
+    return false;
+  }
+  if ( header_size < TraceFileWriter::HeaderSize || header_size + data_size > content.size())
+  {
+    error = "Trace file is truncated";
+    return false;
+  }
+
+  data = TraceData();
+  data.process_id = static_cast<long>(readLittleEndian( content.data() + 24, 8 ));
+  std::map<long, size_t> thread_indices;
+  const char *it = content.data() + header_size;
+  const char *end = it + data_size;
+  while ( it < end )
+  {
+    char type = *it++;
+    uint64_t a, b, c;
+    if ( type == NameRecord )
+    {
+      if ( !readVarint( it, end, a ) || !readVarint( it, end, b ) || b > static_cast<uint64_t>(end - it)) break;
+      if ( data.names.size() <= a ) data.names.resize( a + 1 );
+      data.names[a].assign( it, b );
+      it += b;
+    }
+    else if ( type == EventsRecord )
+    {
+      if ( !readVarint( it, end, a ) || !readVarint( it, end, b ) || !readVarint( it, end, c )) break;
+      long thread_id = static_cast<long>(a);
+      auto thread_it = thread_indices.find( thread_id );
+      if ( thread_it == thread_indices.end())
+      {
+        thread_it = thread_indices.insert( { thread_id, data.threads.size() } ).first;
+        data.threads.push_back( TraceData::Thread{ thread_id, {}} );
+      }
+      std::vector<TraceEvent> &events = data.threads[thread_it->second].events;
+      long long timestamp = static_cast<long long>(c);
+      for ( uint64_t i = 0; i < b; ++i )
+      {
+        uint64_t encoded, name;
+        if ( !readVarint( it, end, encoded ) || !readVarint( it, end, name ))
+        {
+          error = "Trace file is corrupted";
+          return false;
+        }
+        timestamp += unzigzag( encoded >> 1 );
+        events.push_back( TraceEvent{ timestamp, static_cast<NameId>(name), static_cast<uint32_t>(encoded & 1) } );
+      }
+    }
+    else
+    {
+      error = "Unknown record type " + std::to_string( static_cast<int>(type));
+      return false;
+    }
+  }
+  if ( it < end )
+  {
+    error = "Trace file is corrupted";
+    return false;
+  }
+  return true;
+}
+
+std::string traceReport( const TraceData &data, TimerBase::TimeUnit print_time_unit )
+{
+  std::vector<std::vector<long>> run_times( data.names.size());
+  std::vector<std::vector<long long>> open_begins( data.names.size());
+  for ( const TraceData::Thread &thread : data.threads )
+  {
+    for ( auto &begins : open_begins ) begins.clear();
+    for ( const TraceEvent &event : thread.events )
+    {
+      if ( event.name >= data.names.size()) continue;
+      std::vector<long long> &begins = open_begins[event.name];
+      if ( event.type == TraceEvent::Begin )
+      {
+        begins.push_back( event.timestamp );
+        continue;
+      }
+      if ( begins.empty()) continue;
+      run_times[event.name].push_back( static_cast<long>(event.timestamp - begins.back()));
+      begins.pop_back();
+    }
+  }
+  std::ostringstream stream;
+  bool first = true;
+  for ( size_t i = 0; i < data.names.size(); ++i )
+  {
+    if ( run_times[i].empty()) continue;
+    if ( !first ) stream << std::endl;
+    first = false;
+    stream << TimerBase::formatRuns( data.names[i], run_times[i], {}, print_time_unit );
+  }
+  return stream.str();
+}
+}
@@ -0,0 +1,72 @@
+// Linked against hector_timeit_alloc_hooks, so the real allocation functions are interposed and recorded.
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "hector_timeit/allocation_tracker.h"
+#include "hector_timeit/timer.h"
+
+using namespace hector_timeit;
+
+namespace
+{
+// Prevents the compiler from eliding allocations whose result is unused
+void *volatile escaped = nullptr;
+
+void escape( void *ptr ) { escaped = ptr; }
+}
+
+TEST(AllocHooks, RecordsHeapAllocations)
+{
+  // Enabled by the hooks library when it is loaded
+  ASSERT_TRUE(AllocationTracker::enabled());
+  Timer outer( "Outer", TimerBase::Default, false );
+  Timer inner( "Inner", TimerBase::Default, false );
+  for ( int i = 0; i < 4; ++i )
+  {
+    outer.start();
+    std::unique_ptr<char[]> outer_buffer( new char[64] );
+    escape( outer_buffer.get());
+    inner.start();
+    {
+      std::unique_ptr<int[]> array( new int[25] );
+      escape( array.get());
+      std::vector<int> vector( 10 );
+      escape( vector.data());
+      void *memory = std::calloc( 4, 8 );
+      escape( memory );
+      memory = std::realloc( memory, 64 );
+      escape( memory );
+      std::free( memory );
+      void *aligned = nullptr;
+      ASSERT_EQ(posix_memalign( &aligned, 64, 128 ), 0);
+      escape( aligned );
+      std::free( aligned );
+    }
+    // Runs without any elapsed time are not recorded
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+    inner.stop();
+    outer.stop();
+    // Storing the run times allocates, hence, the runs are finished when no timer is running
+    inner.reset( true );
+    outer.reset( true );
+  }
+  EXPECT_EQ(AllocationTracker::current(), nullptr);
+  // Allocations are only counted for the innermost running timer
+  EXPECT_EQ(outer.getAllocationRunCount(), 4U);
+  EXPECT_EQ(outer.getAllocationTotals().count, 4U);
+  EXPECT_EQ(outer.getAllocationTotals().bytes, 4U * 64);
+  EXPECT_EQ(inner.getAllocationRunCount(), 4U);
+  EXPECT_EQ(inner.getAllocationTotals().count, 4U * 5);
+  EXPECT_EQ(inner.getAllocationTotals().bytes, 4U * (100 + 40 + 32 + 64 + 128));
+}
+
+int main( int argc, char **argv )
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
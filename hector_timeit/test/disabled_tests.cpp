@@ -0,0 +1,55 @@
+// Compiles the instrumentation of this file away to check that disabled macros don't generate any code
+#define HECTOR_TIMEIT_LEVEL HECTOR_TIMEIT_LEVEL_NONE
+
+#include <gtest/gtest.h>
+
+#include "hector_timeit/live_reporter.h"
+#include "hector_timeit/scope_profiler.h"
+#include "hector_timeit/timer.h"
+
+// The preprocessed instrumentation is empty, hence, there is no static Timer, no name and no code.
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIME_BLOCK( DisabledBlock ))) == 1,
+               "Disabled blocks have to expand to nothing." );
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIME_BLOCK_SAMPLED( DisabledBlock, 10, Random ))) == 1,
+               "Disabled sampled blocks have to expand to nothing." );
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIME_BLOCK_BUDGET( DisabledBlock, 1000 ))) == 1,
+               "Disabled blocks with a budget have to expand to nothing." );
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIME_SECTION( DisabledSection, false ))) == 1,
+               "Disabled sections have to expand to nothing." );
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIME_SECTION_END_AND_PRINT( DisabledSection ))) == 1,
+               "Disabled section operations have to expand to nothing." );
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIME_SCOPE( DisabledScope ))) == 1,
+               "Disabled scopes have to expand to nothing." );
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIMEIT_AT_LEVEL( ESSENTIAL, int x ))) == 1,
+               "Instrumentation above HECTOR_TIMEIT_LEVEL has to expand to nothing." );
+
+#define HECTOR_TIMEIT_DISABLE_DisabledCategory
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIMEIT_IN_CATEGORY( DisabledCategory, int x ))) == 1,
+               "Instrumentation in a disabled category has to expand to nothing." );
+static_assert( sizeof( HECTOR_TIMEIT_STRINGIFY( HECTOR_TIMEIT_IN_CATEGORY( EnabledCategory, int x ))) == 6,
+               "Instrumentation in other categories has to be kept." );
+
+namespace
+{
+int disabledInstrumentation( int value )
+{
+  HECTOR_TIME_BLOCK( DisabledBlock );
+  HECTOR_TIME_SCOPE( DisabledScope );
+  HECTOR_TIME_SECTION( DisabledSection, false );
+  HECTOR_TIME_SECTION_NEW_RUN( DisabledSection );
+  value *= 2;
+  HECTOR_TIME_SECTION_END_RUN( DisabledSection );
+  HECTOR_TIME_SECTION_END_AND_PRINT( DisabledSection );
+  return value;
+}
+}
+
+TEST(Levels, DisabledInstrumentation)
+{
+  using namespace hector_timeit;
+  size_t timers = LiveReporter::instance().size();
+  size_t names = ScopeProfiler::instance().mergedTree().nodes().size();
+  EXPECT_EQ(disabledInstrumentation( 21 ), 42);
+  EXPECT_EQ(LiveReporter::instance().size(), timers);
+  EXPECT_EQ(ScopeProfiler::instance().mergedTree().nodes().size(), names);
+}
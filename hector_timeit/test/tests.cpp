@@ -4,7 +4,26 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "hector_timeit/accumulator.h"
+#include "hector_timeit/baseline.h"
+#include "hector_timeit/benchmark.h"
+#include "hector_timeit/live_reporter.h"
+#include "hector_timeit/shared_memory.h"
 #include "hector_timeit/timer.h"
+#include "hector_timeit/trace_file.h"
 
 using namespace hector_timeit;
 
@@ -59,6 +78,101 @@ TEST(TimerResult, NoCopies)
   EXPECT_EQ(1, Timer::time(std::function<CreationCounter(void)>([]() { return CreationCounter(); }))->result.GetCount());
 }
 
+TEST(TimerResult, Callable)
+{
+  {
+    auto result = Timer::time( []() { return CreationCounter(); } );
+    EXPECT_EQ(1, result.result.GetCount());
+    EXPECT_GE(result.time, 0);
+  }
+  EXPECT_EQ(0, CreationCounter::GetCount());
+
+  // Move-only results are moved out
+  auto pointer = Timer::time( []() { return std::unique_ptr<int>( new int( 42 )); } ).result;
+  EXPECT_EQ(42, *pointer);
+
+  // References are kept
+  int value = 1;
+  auto reference = Timer::time( [ &value ]() -> int & { return value; } );
+  static_assert( std::is_same<decltype( reference.result ), int &>::value, "Reference results should be kept." );
+  EXPECT_EQ(&value, &reference.result);
+
+  int calls = 0;
+  auto lambda = [ &calls ]() { ++calls; };
+  TimerBase::TimerResult<void> void_result = Timer::time( lambda );
+  EXPECT_EQ(1, calls);
+  EXPECT_NE(void_result.toString( "Void" ).find( "[Timer: Void] 1 run(s) took: " ), std::string::npos);
+}
+
+TEST(NameRegistry, StaticNames)
+{
+  static_assert( *detail::basename( "/some/path/file.cpp" ) == 'f', "The basename should be computed at compile time." );
+  EXPECT_STREQ("file.cpp", detail::basename( "C:\\some\\path/file.cpp" ));
+  EXPECT_STREQ("file.cpp", detail::basename( "file.cpp" ));
+
+  const NameDescriptor &anonymous = HECTOR_TIMEIT_ANONYMOUS_NAME; const int line = __LINE__;
+  EXPECT_EQ("anonymous timer at tests.cpp:" + std::to_string( line ), anonymous.name());
+  NameId id = anonymous.id();
+  EXPECT_EQ(id, anonymous.id());
+
+  Timer timer( HECTOR_TIMEIT_STATIC_NAME( "StaticName" ), TimerBase::Default, false );
+  Timer string_timer( std::string( "StaticName" ), TimerBase::Default, false );
+  EXPECT_EQ(timer.nameId(), string_timer.nameId());
+  EXPECT_EQ("StaticName", timer.name());
+  EXPECT_EQ("StaticName", NameRegistry::instance().name( timer.nameId()));
+
+  // Sections and the N times macros intern their names once, so repeated use does not add names
+  std::stringstream stream;
+  size_t names = 0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    HECTOR_TIME_SECTION( StaticSection, false );
+    EXPECT_EQ("StaticSection", __hector_timeit_timer_StaticSection.name());
+    HECTOR_TIMEN( (void)i, 2, "StaticTimeN", stream );
+    if ( i == 0 ) names = NameRegistry::instance().size();
+  }
+  EXPECT_EQ(names, NameRegistry::instance().size());
+  EXPECT_NE(stream.str().find( "[Timer: StaticTimeN]" ), std::string::npos);
+
+  // Other names are evaluated on every call
+  for ( int i = 0; i < 2; ++i )
+  {
+    std::string local_name = "LocalTimeN" + std::to_string( i );
+    HECTOR_TIMEN( (void)i, 2, local_name, stream );
+    HECTOR_TIMEN( (void)i, 2, "LoopTimeN" + std::to_string( i ), stream );
+    char buffer[32];
+    std::snprintf( buffer, sizeof( buffer ), "BufferTimeN%d", i );
+    HECTOR_TIMEN( (void)i, 2, buffer, stream );
+  }
+  for ( const char *name : { "LocalTimeN0", "LocalTimeN1", "LoopTimeN0", "LoopTimeN1", "BufferTimeN0", "BufferTimeN1" } )
+    EXPECT_NE(stream.str().find( std::string( "[Timer: " ) + name + "]" ), std::string::npos) << name;
+}
+
+TEST(NameRegistry, ConcurrentLookup)
+{
+  NameRegistry &registry = NameRegistry::instance();
+  std::atomic<bool> done( false );
+  std::thread writer( [ & ]()
+                      {
+                        for ( int i = 0; i < 1000; ++i ) registry.intern( "ConcurrentName" + std::to_string( i ));
+                        done = true;
+                      } );
+  NameId first = registry.intern( "ConcurrentName0" );
+  // Reads while the writer grows the registry, looked up names have to stay valid
+  while ( !done )
+  {
+    size_t size = registry.size();
+    EXPECT_EQ("ConcurrentName0", registry.name( first ));
+    if ( size != 0 )
+    {
+      EXPECT_NE("unknown", registry.name( static_cast<NameId>(size - 1)));
+    }
+  }
+  writer.join();
+  EXPECT_EQ("ConcurrentName999", registry.name( registry.intern( "ConcurrentName999" )));
+  EXPECT_EQ("unknown", registry.name( static_cast<NameId>(registry.size())));
+}
+
 TEST(Macros, TimeAndReturn)
 {
   std::stringstream stream;
@@ -66,6 +180,1073 @@ TEST(Macros, TimeAndReturn)
   EXPECT_EQ(1, HECTOR_TIME_AND_RETURN(const CreationCounter &, waitAndCreate(1000), "Name", stream).GetCount());
 }
 
+TEST(ShardedTimer, MergesThreads)
+{
+  ShardedTimer timer( "ShardedTimer" );
+  std::vector<std::thread> threads;
+  for ( int i = 0; i < 4; ++i )
+  {
+    threads.emplace_back( [&timer]() {
+      Timer &shard = timer.localShard();
+      EXPECT_EQ(&shard, &timer.localShard());
+      for ( int k = 0; k < 100; ++k )
+      {
+        TimeBlock block( shard );
+        usleep( 10 );
+      }
+    } );
+  }
+  for ( auto &thread : threads ) thread.join();
+  EXPECT_EQ(4U, timer.shardCount());
+  EXPECT_EQ(400U, timer.getRunTimes().size());
+  EXPECT_EQ(400U, timer.getCpuRunTimes().size());
+}
+
+TEST(ShardedTimer, HistogramStorageWithoutCpuClock)
+{
+  BasicShardedTimer<WallTimer> timer( "ShardedWallTimer", TimerBase::Default, false, TimerBase::HistogramStorage );
+  std::vector<std::thread> threads;
+  for ( int i = 0; i < 2; ++i )
+  {
+    threads.emplace_back( [&timer]() {
+      WallTimer &shard = timer.localShard();
+      for ( int k = 0; k < 10; ++k )
+      {
+        BasicTimeBlock<WallTimer> block( shard );
+        usleep( 10 );
+      }
+    } );
+  }
+  for ( auto &thread : threads ) thread.join();
+  EXPECT_NE(-1, timer.getRunPercentiles().p50);
+  EXPECT_EQ(-1, timer.getCpuRunPercentiles().p50);
+  std::string result;
+  ASSERT_NO_THROW(result = timer.toString());
+  EXPECT_NE(std::string::npos, result.find( "20 run(s)" ));
+}
+
+TEST(Histogram, BoundedRelativeError)
+{
+  Histogram histogram( Histogram::DefaultSignificantBits );
+  const double max_error = 1.0 / (1 << (Histogram::DefaultSignificantBits - 1));
+  for ( long value : { 0L, 1L, 127L, 128L, 129L, 1000L, 123456L, 987654321L, 1L << 40 } )
+  {
+    size_t index = histogram.bucketIndex( value );
+    ASSERT_LT(index, histogram.bucketCount());
+    EXPECT_LE(histogram.bucketLowerBound( index ), value);
+    EXPECT_GE(histogram.bucketUpperBound( index ), value);
+    EXPECT_LE(histogram.bucketUpperBound( index ) - histogram.bucketLowerBound( index ), value * max_error);
+  }
+  EXPECT_LT(histogram.bucketIndex( INT64_MAX ), histogram.bucketCount());
+}
+
+TEST(Histogram, ExactStatistics)
+{
+  Histogram histogram( Histogram::DefaultSignificantBits );
+  std::vector<long> values = { 1000, 5000, 1234567, 42, -1, 99999 };
+  for ( long value : values ) histogram.record( value );
+  RunStatistics expected = RunStatistics::fromRunTimes( values );
+  RunStatistics stats = histogram.statistics();
+  EXPECT_EQ(expected.count, stats.count);
+  EXPECT_EQ(expected.total_count, stats.total_count);
+  EXPECT_EQ(expected.sum, stats.sum);
+  EXPECT_EQ(expected.min, stats.min);
+  EXPECT_EQ(expected.max, stats.max);
+  EXPECT_NEAR(expected.variance, stats.variance, expected.variance * 1E-9);
+
+  // No or a single valid run must not divide by zero
+  Histogram empty( Histogram::DefaultSignificantBits );
+  empty.record( -1 );
+  EXPECT_EQ(0, empty.statistics().mean);
+  EXPECT_EQ(0, empty.statistics().variance);
+  empty.record( 1000 );
+  EXPECT_EQ(1000, empty.statistics().mean);
+  EXPECT_EQ(0, empty.statistics().variance);
+}
+
+TEST(Timer, HistogramStorageMatchesVectorStorage)
+{
+  Timer vector_timer( "Vector", Timer::Default, false );
+  Timer histogram_timer( "Histogram", Timer::Default, false, false, Timer::HistogramStorage );
+  for ( int i = 0; i < 20; ++i )
+  {
+    vector_timer.start();
+    histogram_timer.start();
+    usleep( 100 );
+    histogram_timer.stop();
+    vector_timer.stop();
+    vector_timer.reset( true );
+    histogram_timer.reset( true );
+  }
+  EXPECT_TRUE(histogram_timer.getRunTimes().empty());
+  RunStatistics stats = histogram_timer.getRunStatistics();
+  EXPECT_EQ(20U, stats.total_count);
+  EXPECT_EQ(20U, histogram_timer.getRunHistogram().count());
+  EXPECT_EQ(vector_timer.getRunStatistics().total_count, stats.total_count);
+  EXPECT_GE(stats.min, 100000);
+  EXPECT_NE(std::string::npos, histogram_timer.toString().find( "20 run(s) took:" ));
+
+  // A single run has no spread with either storage
+  Timer single_vector_timer( "SingleVector", Timer::Default, false );
+  Timer single_histogram_timer( "SingleHistogram", Timer::Default, false, false, Timer::HistogramStorage );
+  single_vector_timer.start();
+  single_histogram_timer.start();
+  usleep( 100 );
+  single_histogram_timer.stop();
+  single_vector_timer.stop();
+  single_vector_timer.reset( true );
+  single_histogram_timer.reset( true );
+  RunStatistics single_vector_stats = single_vector_timer.getRunStatistics();
+  RunStatistics single_histogram_stats = single_histogram_timer.getRunStatistics();
+  EXPECT_EQ(1U, single_vector_stats.count);
+  EXPECT_EQ(1U, single_histogram_stats.count);
+  EXPECT_EQ(0, single_vector_stats.variance);
+  EXPECT_EQ(0, single_histogram_stats.variance);
+  EXPECT_EQ(std::string::npos, single_vector_timer.toString().find( "nan" ));
+  EXPECT_EQ(std::string::npos, single_histogram_timer.toString().find( "nan" ));
+}
+
+TEST(Timer, Percentiles)
+{
+  std::vector<long> run_times;
+  for ( long i = 1000; i >= 1; --i ) run_times.push_back( i * 1000 );
+  run_times.push_back( -1 );
+  RunPercentiles percentiles = RunPercentiles::fromRunTimes( run_times );
+  EXPECT_EQ(500000, percentiles.p50);
+  EXPECT_EQ(900000, percentiles.p90);
+  EXPECT_EQ(990000, percentiles.p99);
+  EXPECT_EQ(999000, percentiles.p999);
+  EXPECT_EQ(1000, RunPercentiles::percentile( run_times, 0 ));
+  EXPECT_EQ(1000000, RunPercentiles::percentile( run_times, 100 ));
+  EXPECT_EQ(-1, RunPercentiles::percentile( { -1 }, 50 ));
+
+  Histogram histogram( Histogram::DefaultSignificantBits );
+  for ( long time : run_times ) histogram.record( time );
+  RunPercentiles histogram_percentiles = RunPercentiles::fromHistogram( histogram );
+  EXPECT_NEAR(percentiles.p50, histogram_percentiles.p50, percentiles.p50 / 64.0);
+  EXPECT_NEAR(percentiles.p99, histogram_percentiles.p99, percentiles.p99 / 64.0);
+  EXPECT_EQ(1000000, histogram.valueAtPercentile( 100 ));
+  EXPECT_EQ(1000, histogram.valueAtPercentile( 0 ));
+}
+
+TEST(Clocks, TscClockMatchesSteadyClock)
+{
+  // The first call calibrates the clock
+  TscClock::now();
+  auto steady_start = std::chrono::steady_clock::now();
+  auto tsc_start = TscClock::now();
+  usleep( 50000 );
+  auto tsc_end = TscClock::now();
+  auto steady_end = std::chrono::steady_clock::now();
+  long steady = std::chrono::duration_cast<std::chrono::nanoseconds>( steady_end - steady_start ).count();
+  long tsc = std::chrono::duration_cast<std::chrono::nanoseconds>( tsc_end - tsc_start ).count();
+  EXPECT_LE(tsc, steady);
+  EXPECT_NEAR(steady, tsc, steady * 0.01);
+  // Both use the CLOCK_MONOTONIC epoch
+  EXPECT_NEAR(steady_end.time_since_epoch().count(), tsc_end.time_since_epoch().count(), 1E6);
+}
+
+TEST(Clocks, TimerWithTsc)
+{
+  WallClock::setSource( WallClock::Tsc );
+  Timer timer( "TscTimer" );
+  usleep( 10000 );
+  timer.stop();
+  WallClock::setSource( WallClock::HighResolutionClock );
+  EXPECT_GE(timer.getElapsedTime(), 9E6);
+  EXPECT_LT(timer.getElapsedTime(), 1E9);
+}
+
+TEST(Timer, WallTimerPolicy)
+{
+  WallTimer timer( "WallTimer", Timer::Default, false );
+  for ( int i = 0; i < 5; ++i )
+  {
+    timer.start();
+    usleep( 1000 );
+    timer.stop();
+    timer.reset( true );
+  }
+  ASSERT_EQ(timer.getRunTimes().size(), 5U);
+  EXPECT_FALSE(timer.measuresCpuTime());
+  EXPECT_TRUE(timer.getCpuRunTimes().empty());
+  EXPECT_GE(timer.getRunStatistics().min, 9E5);
+  std::string output = timer.toString();
+  EXPECT_NE(output.find( "Real" ), std::string::npos);
+  EXPECT_EQ(output.find( "Thread" ), std::string::npos);
+
+  typedef BasicTimer<std::chrono::steady_clock, ThreadCpuClock, NoCompensation> SteadyTimer;
+  std::ostringstream stream;
+  {
+    HECTOR_TIME_SECTION_WITH(SteadyTimer, SteadySection);
+    usleep( 1000 );
+    HECTOR_TIME_SECTION_END_AND_PRINT(SteadySection, stream);
+  }
+  EXPECT_NE(stream.str().find( "SteadySection" ), std::string::npos);
+  EXPECT_NE(stream.str().find( "Thread" ), std::string::npos);
+}
+
+TEST(Timer, CalibratedCompensation)
+{
+  ClockOverhead overhead = CalibratedCompensation::overhead<WallClock, ThreadCpuClock>();
+  EXPECT_GT(overhead.wall, 0);
+  EXPECT_GE(overhead.cpu, 0);
+  EXPECT_LT(overhead.wall, 1E5);
+  EXPECT_EQ((NoCompensation::overhead<WallClock, ThreadCpuClock>().wall), 0);
+
+  // Empty runs should be close to zero after subtracting the overhead
+  CalibratedTimer timer( "Calibrated", Timer::Default, false );
+  for ( int i = 0; i < 1000; ++i )
+  {
+    timer.start();
+    timer.stop();
+    timer.reset( true );
+  }
+  EXPECT_LT(timer.getPercentile( 50 ), overhead.wall / 2 + 100);
+
+  timer.reset();
+  timer.start();
+  usleep( 1000 );
+  timer.stop();
+  EXPECT_GE(timer.getElapsedTime(), 9E5);
+}
+
+void scopeChild()
+{
+  HECTOR_TIME_SCOPE( ScopeTestChild );
+  usleep( 1000 );
+}
+
+TEST(ScopeProfiler, CallTree)
+{
+  ScopeProfiler &profiler = ScopeProfiler::instance();
+  ScopeId outer = profiler.intern( "ScopeTestOuter" );
+  ScopeId inner = profiler.intern( "ScopeTestInner" );
+  EXPECT_EQ(profiler.intern( "ScopeTestOuter" ), outer);
+  EXPECT_EQ(profiler.scopeName( inner ), "ScopeTestInner");
+
+  ScopeTree tree;
+  for ( int i = 0; i < 3; ++i )
+  {
+    ScopeGuard outer_guard( tree, outer );
+    usleep( 1000 );
+    for ( int k = 0; k < 2; ++k )
+    {
+      ScopeGuard inner_guard( tree, inner );
+      usleep( 1000 );
+    }
+  }
+  // The same scope at the top level is a different node
+  {
+    ScopeGuard inner_guard( tree, inner );
+  }
+  EXPECT_EQ(tree.depth(), 0U);
+  ASSERT_EQ(tree.nodes().size(), 4U);
+  uint32_t outer_node = tree.findChild( ScopeTree::Root, outer );
+  uint32_t inner_node = tree.findChild( outer_node, inner );
+  ASSERT_NE(outer_node, ScopeTree::InvalidNode);
+  ASSERT_NE(inner_node, ScopeTree::InvalidNode);
+  EXPECT_NE(tree.findChild( ScopeTree::Root, inner ), ScopeTree::InvalidNode);
+  EXPECT_EQ(tree.findChild( inner_node, outer ), ScopeTree::InvalidNode);
+  EXPECT_EQ(tree.nodes()[outer_node].count, 3U);
+  EXPECT_EQ(tree.nodes()[inner_node].count, 6U);
+  EXPECT_GE(tree.nodes()[inner_node].inclusive_time, 6E6);
+  EXPECT_GE(tree.selfTime( outer_node ), 3E6);
+  EXPECT_EQ(tree.selfTime( outer_node ), tree.nodes()[outer_node].inclusive_time - tree.nodes()[inner_node].inclusive_time);
+
+  std::string output = profiler.toString( tree );
+  size_t outer_pos = output.find( "\nScopeTestOuter" );
+  EXPECT_NE(outer_pos, std::string::npos);
+  EXPECT_NE(output.find( "\n  ScopeTestInner" ), std::string::npos);
+
+  // Many children force the table to grow
+  ScopeTree wide;
+  for ( int i = 0; i < 200; ++i )
+  {
+    ScopeGuard guard( wide, profiler.intern( "ScopeTestWide" + std::to_string( i )));
+  }
+  EXPECT_EQ(wide.nodes().size(), 201U);
+  for ( int i = 0; i < 200; ++i )
+    EXPECT_EQ(wide.findChild( ScopeTree::Root, profiler.intern( "ScopeTestWide" + std::to_string( i ))), i + 1U);
+}
+
+TEST(ScopeProfiler, MergesThreads)
+{
+  std::vector<std::thread> threads;
+  for ( int i = 0; i < 2; ++i )
+  {
+    threads.emplace_back( []()
+                          {
+                            HECTOR_TIME_SCOPE( ScopeTestParent );
+                            for ( int k = 0; k < 3; ++k ) scopeChild();
+                          } );
+  }
+  for ( auto &thread : threads ) thread.join();
+  ScopeProfiler &profiler = ScopeProfiler::instance();
+  ScopeTree merged = profiler.mergedTree();
+  uint32_t parent = merged.findChild( ScopeTree::Root, profiler.intern( "ScopeTestParent" ));
+  ASSERT_NE(parent, ScopeTree::InvalidNode);
+  uint32_t child = merged.findChild( parent, profiler.intern( "ScopeTestChild" ));
+  ASSERT_NE(child, ScopeTree::InvalidNode);
+  EXPECT_EQ(merged.nodes()[parent].count, 2U);
+  EXPECT_EQ(merged.nodes()[child].count, 6U);
+  EXPECT_GE(merged.nodes()[child].inclusive_time, 6E6);
+  profiler.setPrintOnExit( false );
+}
+
+TEST(Tracer, ChromeTrace)
+{
+  Tracer &tracer = Tracer::instance();
+  EXPECT_FALSE(Tracer::enabled());
+  tracer.enable( 1024 );
+  std::thread thread( []()
+                      {
+                        Timer timer( "TraceTestTimer" );
+                        HECTOR_TIME_SCOPE( TraceTestScope );
+                        timer.stop();
+                      } );
+  thread.join();
+  // Ring buffer that drops the oldest events
+  tracer.enable( 4 );
+  std::thread overflow_thread( []()
+                               {
+                                 Timer timer( "TraceTestOverflow", Timer::Default, false );
+                                 for ( int i = 0; i < 5; ++i )
+                                 {
+                                   timer.start();
+                                   timer.stop();
+                                 }
+                               } );
+  overflow_thread.join();
+  tracer.disable();
+  Timer untraced( "TraceTestUntraced" );
+  untraced.stop();
+
+  EXPECT_EQ(tracer.eventCount(), 8U);
+  EXPECT_EQ(tracer.droppedEventCount(), 6U);
+  std::ostringstream stream;
+  tracer.writeChromeTrace( stream );
+  std::string trace = stream.str();
+  EXPECT_EQ(trace.find( "{\"traceEvents\":[" ), 0U);
+  EXPECT_NE(trace.find( "{\"name\":\"TraceTestTimer\",\"ph\":\"X\"" ), std::string::npos);
+  EXPECT_NE(trace.find( "{\"name\":\"TraceTestScope\",\"ph\":\"X\"" ), std::string::npos);
+  EXPECT_NE(trace.find( "TraceTestOverflow" ), std::string::npos);
+  EXPECT_EQ(trace.find( "TraceTestUntraced" ), std::string::npos);
+  // The timer and the scope overlap without being nested. Events are written when they end.
+  EXPECT_LT(trace.find( "\"TraceTestTimer\"" ), trace.find( "\"TraceTestScope\"" ));
+  tracer.clear();
+  EXPECT_EQ(tracer.eventCount(), 0U);
+}
+
+TEST(Tracer, TraceFile)
+{
+  Tracer &tracer = Tracer::instance();
+  tracer.clear();
+  std::string path = testing::TempDir() + "hector_timeit_test.trace";
+  ASSERT_TRUE(tracer.enableFile( path, 64, 1 ));
+  EXPECT_FALSE(tracer.enableFile( path ));
+  std::vector<std::thread> threads;
+  for ( int i = 0; i < 2; ++i )
+  {
+    threads.emplace_back( []()
+                          {
+                            Timer timer( "TraceFileTimer", Timer::Default, false );
+                            // More events than the buffer can hold, so the flusher has to catch up
+                            for ( int k = 0; k < 100; ++k )
+                            {
+                              timer.start();
+                              timer.stop();
+                              if ( k % 25 == 0 ) usleep( 20000 );
+                            }
+                          } );
+  }
+  for ( auto &thread : threads ) thread.join();
+  tracer.disable();
+  size_t dropped = tracer.droppedEventCount();
+  EXPECT_EQ(dropped % 2, 0U);
+
+  TraceData data;
+  std::string error;
+  ASSERT_TRUE(readTraceFile( path, data, error )) << error;
+  size_t events = 0;
+  for ( const TraceData::Thread &thread : data.threads )
+  {
+    if ( thread.events.empty() || data.name( thread.events.front().name ) != "TraceFileTimer" ) continue;
+    events += thread.events.size();
+    for ( size_t i = 1; i < thread.events.size(); ++i )
+    {
+      EXPECT_GE(thread.events[i].timestamp, thread.events[i - 1].timestamp);
+      EXPECT_NE(thread.events[i].type, thread.events[i - 1].type);
+    }
+  }
+  EXPECT_EQ(events + dropped, 400U);
+  std::string report = traceReport( data );
+  EXPECT_NE(report.find( "[Timer: TraceFileTimer] " + std::to_string( events / 2 ) + " run(s)" ), std::string::npos);
+  EXPECT_EQ(report.find( "Thread" ), std::string::npos);
+  std::ostringstream json;
+  data.writeChromeTrace( json );
+  EXPECT_NE(json.str().find( "{\"name\":\"TraceFileTimer\",\"ph\":\"X\"" ), std::string::npos);
+  EXPECT_FALSE(readTraceFile( path + ".missing", data, error ));
+  std::remove( path.c_str());
+}
+
+TEST(Tracer, ClearWhileRecording)
+{
+  Tracer &tracer = Tracer::instance();
+  tracer.clear();
+  tracer.enable( 256 );
+  std::atomic<bool> done( false );
+  std::thread thread( [ & ]()
+                      {
+                        Timer timer( "TraceClearTimer", Timer::Default, false );
+                        while ( !done )
+                        {
+                          timer.start();
+                          timer.stop();
+                        }
+                      } );
+  for ( int i = 0; i < 100; ++i )
+  {
+    tracer.clear();
+    EXPECT_LE(tracer.eventCount(), 256U);
+    std::this_thread::yield();
+  }
+  done = true;
+  thread.join();
+  tracer.disable();
+  EXPECT_GT(tracer.eventCount(), 0U);
+  // The buffer of the exited thread is released once it was cleared
+  tracer.clear();
+  EXPECT_EQ(tracer.eventCount(), 0U);
+  EXPECT_EQ(tracer.droppedEventCount(), 0U);
+}
+
+TEST(LiveReporter, Snapshots)
+{
+  using namespace hector_timeit;
+  Timer timer( "LiveTimer", TimerBase::Default, false );
+  LiveReporter &reporter = LiveReporter::instance();
+  reporter.add( timer );
+  std::atomic<bool> done( false );
+  std::thread writer( [ & ]()
+                      {
+                        for ( int i = 0; i < 2000; ++i )
+                        {
+                          timer.reset( true );
+                          timer.start();
+                          timer.stop();
+                        }
+                        timer.reset( true );
+                        done = true;
+                      } );
+  size_t last_count = 0;
+  while ( !done )
+  {
+    LiveSnapshot snapshot = timer.liveSnapshot();
+    EXPECT_GE(snapshot.count, last_count);
+    if ( snapshot.count != 0 )
+    {
+      EXPECT_LE(snapshot.min, snapshot.max);
+      EXPECT_GE(snapshot.sum, static_cast<long long>(snapshot.min) * static_cast<long long>(snapshot.count));
+      EXPECT_LE(snapshot.sum, static_cast<long long>(snapshot.max) * static_cast<long long>(snapshot.count));
+    }
+    last_count = snapshot.count;
+  }
+  writer.join();
+  EXPECT_EQ(timer.liveSnapshot().count, timer.getRunStatistics().total_count);
+
+  std::mutex mutex;
+  std::vector<std::string> reports;
+  reporter.start( std::chrono::milliseconds( 5 ), [ & ]( const std::string &report )
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    reports.push_back( report );
+  } );
+  EXPECT_TRUE(reporter.isRunning());
+  std::this_thread::sleep_for( std::chrono::milliseconds( 50 ));
+  reporter.stop();
+  EXPECT_FALSE(reporter.isRunning());
+  ASSERT_FALSE(reports.empty());
+  EXPECT_NE(reports.front().find( "[Live: LiveTimer] " + std::to_string( timer.liveSnapshot().count ) + " run(s) (+" ),
+            std::string::npos);
+  EXPECT_NE(reporter.toString().find( "[Live: LiveTimer]" ), std::string::npos);
+
+  size_t size = reporter.size();
+  {
+    ShardedTimer sharded( "LiveShardedTimer" );
+    EXPECT_EQ(reporter.size(), size + 1);
+    std::thread( [ & ]()
+                 {
+                   Timer &shard = sharded.localShard();
+                   shard.start();
+                   std::this_thread::sleep_for( std::chrono::milliseconds( 1 ));
+                   shard.stop();
+                   shard.reset( true );
+                 } ).join();
+    EXPECT_EQ(sharded.liveSnapshot().count, 1U);
+  }
+  EXPECT_EQ(reporter.size(), size);
+}
+
+TEST(LiveReporter, SharedMemoryExport)
+{
+  using namespace hector_timeit;
+  SharedMemoryExporter &exporter = SharedMemoryExporter::instance();
+  ASSERT_TRUE(exporter.start( std::chrono::milliseconds( 5 )));
+  EXPECT_TRUE(exporter.isRunning());
+  std::vector<long> pids = SharedMemoryReader::list();
+  EXPECT_NE(std::find( pids.begin(), pids.end(), getpid()), pids.end());
+  {
+    ShardedTimer sharded( "ExportedTimer" );
+    // Timers with the same name are exported as separate entries
+    ShardedTimer duplicate( "ExportedTimer" );
+    std::thread( [ & ]()
+                 {
+                   Timer &shard = sharded.localShard();
+                   for ( int i = 0; i < 10; ++i )
+                   {
+                     shard.start();
+                     std::this_thread::sleep_for( std::chrono::microseconds( 100 ));
+                     shard.stop();
+                     shard.reset( true );
+                   }
+                 } ).join();
+
+    SharedMemoryReader reader;
+    std::string error;
+    ASSERT_TRUE(reader.open( getpid(), error )) << error;
+    SharedMemoryReader::Snapshot snapshot;
+    const shared_memory::Entry *entry = nullptr;
+    // Waits for an update after the runs
+    for ( int i = 0; i < 200 && entry == nullptr; ++i )
+    {
+      std::this_thread::sleep_for( std::chrono::milliseconds( 5 ));
+      ASSERT_TRUE(reader.read( snapshot ));
+      for ( const shared_memory::Entry &e : snapshot.entries )
+        if ( std::string( e.name ) == "ExportedTimer" && e.count == 10 ) entry = &e;
+    }
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(snapshot.pid, getpid());
+    size_t duplicates = 0;
+    for ( const shared_memory::Entry &e : snapshot.entries )
+    {
+      if ( std::string( e.name ) != "ExportedTimer" || &e == entry ) continue;
+      EXPECT_NE(e.key, entry->key);
+      EXPECT_EQ(e.count, 0U);
+      ++duplicates;
+    }
+    EXPECT_EQ(duplicates, 1U);
+    EXPECT_GE(entry->min, 100000);
+    EXPECT_LE(entry->min, entry->max);
+    EXPECT_GE(entry->sum, 10 * entry->min);
+    // The percentiles cover the runs since the previous update which may have been before the last runs finished
+    if ( entry->p50 != -1 )
+    {
+      EXPECT_GE(entry->p50, entry->min * 15 / 16);
+      EXPECT_LE(entry->p50, entry->p99);
+      EXPECT_LE(entry->p99, entry->max * 17 / 16);
+    }
+  }
+  exporter.stop();
+  EXPECT_FALSE(exporter.isRunning());
+  std::string error;
+  EXPECT_FALSE(SharedMemoryReader().open( getpid(), error ));
+
+  // A segment whose exporter died in the middle of an update must not block the reader forever
+  const long dead_pid = 0x7FFFFFF0;
+  std::string name = shared_memory::segmentName( dead_pid );
+  int fd = shm_open( name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600 );
+  ASSERT_NE(fd, -1);
+  size_t size = shared_memory::segmentSize( 1 );
+  ASSERT_EQ(ftruncate( fd, static_cast<off_t>(size)), 0);
+  void *memory = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+  ASSERT_NE(memory, MAP_FAILED);
+  auto *header = new( memory ) shared_memory::Header();
+  std::memcpy( header->magic, shared_memory::Magic, sizeof( shared_memory::Magic ));
+  header->version = shared_memory::Version;
+  header->header_size = sizeof( shared_memory::Header );
+  header->entry_size = sizeof( shared_memory::Entry );
+  header->capacity = 1;
+  header->sequence.store( 1 );
+  {
+    SharedMemoryReader reader;
+    ASSERT_TRUE(reader.open( dead_pid, error )) << error;
+    SharedMemoryReader::Snapshot snapshot;
+    EXPECT_FALSE(reader.read( snapshot ));
+    header->sequence.store( 2 );
+    EXPECT_TRUE(reader.read( snapshot ));
+  }
+  munmap( memory, size );
+  shm_unlink( name.c_str());
+}
+
+TEST(Sampler, Sampling)
+{
+  using namespace hector_timeit;
+  Sampler every_nth( 10 );
+  int sampled = 0;
+  for ( int i = 0; i < 1000; ++i )
+  {
+    if ( every_nth.sample())
+    {
+      EXPECT_EQ(i % 10, 0);
+      ++sampled;
+    }
+  }
+  EXPECT_EQ(sampled, 100);
+
+  Sampler random( 10, Sampler::Random );
+  sampled = 0;
+  for ( int i = 0; i < 100000; ++i )
+  {
+    if ( random.sample()) ++sampled;
+  }
+  EXPECT_GT(sampled, 9000);
+  EXPECT_LT(sampled, 11000);
+
+  Sampler all( 0 );
+  for ( int i = 0; i < 10; ++i ) EXPECT_TRUE(all.sample());
+
+  Timer timer( "SampledTimer", TimerBase::Default, false );
+  timer.setSamplePeriod( 10 );
+  Sampler sampler( 10 );
+  for ( int i = 0; i < 100; ++i )
+  {
+    SampledTimeBlock block( timer, sampler );
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+  }
+  EXPECT_EQ(timer.getRunStatistics().total_count, 10U);
+  EXPECT_NE(timer.toString().find( "[Timer: SampledTimer] ~100 run(s) (sampled 1 in 10, 10 measured) took:" ),
+            std::string::npos);
+}
+
+const ShardedTimerBase &sampledWallTimerBlock()
+{
+  HECTOR_TIME_BLOCK_SAMPLED_WITH(::hector_timeit::WallTimer, SampledWallBlock, 4);
+  return __block_timer_SampledWallBlock;
+}
+
+TEST(Sampler, SampledWallTimerBlock)
+{
+  const ShardedTimerBase *timer = nullptr;
+  for ( int i = 0; i < 40; ++i ) timer = &sampledWallTimerBlock();
+  std::string result;
+  // The block prints on exit, so printing must not throw without a cpu histogram
+  ASSERT_NO_THROW(result = timer->toString());
+  EXPECT_NE(result.find( "[Timer: SampledWallBlock] ~40 run(s) (sampled 1 in 4, 10 measured) took:" ),
+            std::string::npos);
+}
+
+TEST(Timer, PerfCounters)
+{
+  using namespace hector_timeit;
+  CountingTimer timer( "CountingTimer", TimerBase::Default, false );
+  EXPECT_TRUE(timer.measuresCounters());
+  for ( int i = 0; i < 10; ++i )
+  {
+    timer.start();
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+    timer.stop();
+    timer.reset( true );
+  }
+  EXPECT_EQ(timer.getRunStatistics().total_count, 10U);
+  if ( PerfCounterGroup::threadGroup().isOpen())
+  {
+    EXPECT_EQ(timer.getCounterRunCount(), 10U);
+    EXPECT_NE(timer.toString().find( "IPC" ), std::string::npos);
+  }
+  else
+  {
+    // Degrades to a normal timer if the kernel doesn't allow counting
+    EXPECT_EQ(timer.getCounterRunCount(), 0U);
+    EXPECT_EQ(timer.toString().find( "IPC" ), std::string::npos);
+  }
+  EXPECT_FALSE(Timer( "Timer" ).measuresCounters());
+
+  CounterValues totals;
+  totals.values[CounterValues::Cycles] = 2000;
+  totals.values[CounterValues::Instructions] = 3000;
+  totals.values[CounterValues::LLCMisses] = 50;
+  std::string counters = TimerBase::formatCounters( totals, 10 );
+  EXPECT_NE(counters.find( "1.500" ), std::string::npos);
+  EXPECT_NE(counters.find( "5.0" ), std::string::npos);
+  EXPECT_EQ(TimerBase::formatCounters( totals, 0 ), "");
+}
+
+TEST(Timer, AllocationTracking)
+{
+  using namespace hector_timeit;
+  // The hooks library isn't linked into these tests, hence, allocations are recorded manually. The hooks are tested in
+  //  alloc_hooks_tests.cpp.
+  bool enabled = AllocationTracker::enabled();
+  AllocationTracker::setEnabled( true );
+  Timer outer( "Outer", TimerBase::Default, false );
+  Timer inner( "Inner", TimerBase::Default, false );
+  for ( int i = 0; i < 4; ++i )
+  {
+    outer.start();
+    AllocationTracker::record( 100 );
+    inner.start();
+    AllocationTracker::record( 10 );
+    AllocationTracker::record( 20 );
+    // Runs without any elapsed time are not recorded
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+    inner.stop();
+    inner.reset( true );
+    outer.stop();
+    outer.reset( true );
+  }
+  AllocationTracker::record( 1000 );
+  AllocationTracker::setEnabled( enabled );
+  EXPECT_EQ(AllocationTracker::current(), nullptr);
+  EXPECT_EQ(outer.getAllocationRunCount(), 4U);
+  EXPECT_EQ(outer.getAllocationTotals().count, 4U);
+  EXPECT_EQ(outer.getAllocationTotals().bytes, 400U);
+  EXPECT_EQ(inner.getAllocationTotals().count, 8U);
+  EXPECT_EQ(inner.getAllocationTotals().bytes, 120U);
+  std::string result = inner.toString();
+  EXPECT_NE(result.find( "Allocs/run" ), std::string::npos);
+  EXPECT_NE(result.find( "30.0" ), std::string::npos);
+  inner.reset();
+  EXPECT_EQ(inner.getAllocationRunCount(), 0U);
+  EXPECT_EQ(Timer( "Untracked" ).toString().find( "Allocs/run" ), std::string::npos);
+}
+
+TEST(Benchmark, Run)
+{
+  BenchmarkOptions options;
+  options.warmup_time = 10000000;
+  options.min_sample_time = 100000;
+  options.time_budget = 500000000;
+  options.bootstrap_resamples = 200;
+  BenchmarkResult result = Benchmark::run( "Sum", []()
+  {
+    long sum = 0;
+    for ( long i = 0; i < 100; ++i ) sum += i * i;
+    doNotOptimize( sum );
+  }, options );
+  EXPECT_GE(result.samples.size(), options.min_samples);
+  EXPECT_EQ(result.outliers.size(), result.samples.size());
+  EXPECT_GT(result.batch_size, 1U);
+  EXPECT_GT(result.mean, 0);
+  EXPECT_LE(result.ci_lower, result.mean);
+  EXPECT_GE(result.ci_upper, result.mean);
+  // Every batch must take at least the minimum sample time
+  EXPECT_GE(*std::min_element( result.samples.begin(), result.samples.end()) * result.batch_size,
+            options.min_sample_time * 0.5);
+  if ( result.stop_reason == BenchmarkResult::TargetErrorReached )
+  {
+    EXPECT_LE(result.relativeError(), 2 * options.target_relative_error);
+  }
+  EXPECT_EQ(result.toString().find( "[Benchmark: Sum] " ), 0U);
+
+  options.max_samples = 12;
+  options.target_relative_error = 0;
+  size_t iterations = 0;
+  result = Benchmark::runBatches( "Batches", [ &iterations ]( size_t n )
+  {
+    iterations += n;
+    std::this_thread::sleep_for( std::chrono::microseconds( 200 ));
+  }, options );
+  EXPECT_EQ(result.samples.size(), 12U);
+  EXPECT_EQ(result.stop_reason, BenchmarkResult::MaxSamplesReached);
+  EXPECT_EQ(result.batch_size, 1U);
+}
+
+TEST(Benchmark, Scaling)
+{
+  ScalingOptions options;
+  options.max_threads = 3;
+  std::atomic<long> runs{ 0 };
+  ScalingResult result = Benchmark::runScaling( "Scaling", [ &runs ]()
+  {
+    runs.fetch_add( 1 );
+    // Runs without any elapsed time are not recorded
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+  }, 20, options );
+  ASSERT_EQ(result.steps.size(), 3U);
+  EXPECT_EQ(runs.load(), 20 * (1 + 2 + 3));
+  unsigned expected_threads[] = { 1, 2, 3 };
+  for ( size_t i = 0; i < result.steps.size(); ++i )
+  {
+    const ScalingStep &step = result.steps[i];
+    EXPECT_EQ(step.threads, expected_threads[i]);
+    EXPECT_EQ(step.thread_stats.size(), step.threads);
+    EXPECT_EQ(step.run_stats.total_count, 20U * step.threads);
+    EXPECT_GT(step.throughput(), 0);
+    EXPECT_FALSE(step.pinned);
+  }
+  EXPECT_DOUBLE_EQ(result.speedup( result.steps[0] ), 1);
+  EXPECT_DOUBLE_EQ(result.efficiency( result.steps[2] ), result.speedup( result.steps[2] ) / 3);
+  EXPECT_EQ(result.toString().find( "[Scaling: Scaling] 20 run(s) per thread took:" ), 0U);
+}
+
+TEST(Baseline, Comparison)
+{
+  std::mt19937_64 generator( 1 );
+  std::normal_distribution<double> distribution( 100000, 5000 );
+  std::vector<long> reference, same, slower;
+  for ( int i = 0; i < 500; ++i )
+  {
+    reference.push_back( static_cast<long>(distribution( generator )));
+    same.push_back( static_cast<long>(distribution( generator )));
+    slower.push_back( static_cast<long>(1.2 * distribution( generator )));
+  }
+  reference.push_back( -1 );
+  Baseline baseline( "Pipeline", reference );
+  EXPECT_EQ(baseline.size(), 500U);
+
+  std::string path = "/tmp/hector_timeit_test_baseline.bin";
+  ASSERT_TRUE(baseline.save( path ));
+  Baseline loaded;
+  std::string error;
+  ASSERT_TRUE(Baseline::load( path, loaded, error )) << error;
+  EXPECT_EQ(loaded.name(), "Pipeline");
+  EXPECT_EQ(loaded.runTimes(), baseline.runTimes());
+  std::remove( path.c_str());
+  EXPECT_FALSE(Baseline::load( path, loaded, error ));
+
+  // A corrupt run count is rejected instead of allocated
+  {
+    std::ofstream corrupt( path, std::ios::binary );
+    corrupt.write( "HTBASE\0\0", 8 );
+    for ( int i = 0; i < 4; ++i ) corrupt.put( static_cast<char>((Baseline::Version >> (8 * i)) & 0xFF));
+    // Name "x", one distinct value of 1 with a count of 2^62
+    corrupt.write( "\x01x\x01\x01", 4 );
+    corrupt.write( "\x80\x80\x80\x80\x80\x80\x80\x80\x40", 9 );
+  }
+  EXPECT_FALSE(Baseline::load( path, loaded, error ));
+  EXPECT_NE(error.find( "corrupt" ), std::string::npos) << error;
+  std::remove( path.c_str());
+
+  Comparison comparison = compare( loaded, same );
+  EXPECT_TRUE(comparison.passed()) << comparison.toString();
+  EXPECT_LT(std::abs( comparison.relative_change ), 0.02);
+  EXPECT_LE(comparison.ci_lower, comparison.relative_change);
+  EXPECT_GE(comparison.ci_upper, comparison.relative_change);
+
+  comparison = compare( loaded, slower );
+  EXPECT_TRUE(comparison.significant());
+  EXPECT_TRUE(comparison.regression()) << comparison.toString();
+  EXPECT_GT(comparison.z, 0);
+  EXPECT_NEAR(comparison.relative_change, 0.2, 0.03);
+  EXPECT_LT(comparison.ci_lower, 0.2);
+  EXPECT_GT(comparison.ci_upper, 0.2);
+  EXPECT_EQ(comparison.toString().find( "[Comparison: Pipeline] REGRESSION" ), 0U);
+
+  // Faster runs are significant but not a regression
+  comparison = compare( Baseline( "Pipeline", slower ), reference );
+  EXPECT_TRUE(comparison.significant());
+  EXPECT_TRUE(comparison.passed());
+
+  Timer timer( "Timer", Timer::Default, false );
+  for ( int i = 0; i < 3; ++i )
+  {
+    timer.start();
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+    timer.stop();
+    timer.reset( true );
+  }
+  // Only the finished runs are part of the baseline
+  timer.start();
+  std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+  EXPECT_EQ(Baseline::fromTimer( timer ).size(), 3U);
+  timer.stop();
+  EXPECT_EQ(compare( Baseline(), timer ).toString(), "[Comparison: ] no runs to compare (baseline: 0, current: 3).");
+}
+
+TEST(RunAccumulator, MatchesTimerStatistics)
+{
+  std::vector<long> run_times = { 1200, 3400, 800, 15000, 2200, 900 };
+  RunAccumulator accumulator;
+  for ( long time : run_times ) accumulator.add( time );
+  accumulator.add( -1 );
+  RunStatistics expected = RunStatistics::fromRunTimes( run_times );
+  RunStatistics stats = accumulator.statistics();
+  EXPECT_EQ(expected.count, stats.count);
+  EXPECT_EQ(expected.sum, stats.sum);
+  EXPECT_EQ(expected.min, stats.min);
+  EXPECT_EQ(expected.max, stats.max);
+  EXPECT_DOUBLE_EQ(expected.mean, stats.mean);
+  EXPECT_NEAR(expected.variance, stats.variance, 1E-6 * expected.variance);
+  std::string report = accumulator.toString( "Accumulator" );
+  EXPECT_EQ(0U, report.find( "[Timer: Accumulator] 6 run(s) took: " ));
+
+  ShardedAccumulatorArray array( "Joints", 3 );
+  std::vector<std::thread> threads;
+  for ( int t = 0; t < 4; ++t )
+  {
+    threads.emplace_back( [ &array ]()
+    {
+      RunAccumulator *accumulators = array.localShard();
+      EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(accumulators) % ShardedAccumulatorArray::CacheLineSize);
+      for ( int i = 0; i < 100; ++i )
+      {
+        accumulators[0].add( 1000 + i );
+        AccumulatorBlock block( accumulators[2] );
+        std::this_thread::sleep_for( std::chrono::microseconds( 1 ));
+      }
+    } );
+  }
+  for ( auto &thread : threads ) thread.join();
+  EXPECT_EQ(4U, array.shardCount());
+  EXPECT_EQ(400U, array.merged( 0 ).count());
+  EXPECT_EQ(1000, array.merged( 0 ).min());
+  EXPECT_EQ(1099, array.merged( 0 ).max());
+  EXPECT_EQ(0U, array.merged( 1 ).count());
+  EXPECT_EQ(400U, array.merged( 2 ).count());
+  std::string array_report = array.toString();
+  EXPECT_NE(array_report.find( "[Timer: Joints[0]] 400 run(s)" ), std::string::npos);
+  EXPECT_EQ(array_report.find( "Joints[1]" ), std::string::npos);
+}
+
+TEST(Timer, LatencyBudget)
+{
+  std::vector<BudgetViolation> violations;
+  Timer timer( "Budget", TimerBase::Default, false );
+  timer.setLatencyBudget( 1000000, [ &violations ]( const BudgetViolation &violation )
+  {
+    violations.push_back( violation );
+  } );
+  for ( int i = 0; i < 4; ++i )
+  {
+    timer.start();
+    std::this_thread::sleep_for( std::chrono::microseconds( i % 2 == 0 ? 10 : 2000 ));
+    timer.stop();
+    // Stopping a run again after it exceeded the budget must not report it twice
+    timer.start();
+    timer.stop();
+    timer.reset( true );
+  }
+  EXPECT_EQ(2U, timer.budgetViolations());
+  ASSERT_EQ(2U, violations.size());
+  EXPECT_EQ(timer.nameId(), violations[0].name);
+  EXPECT_GT(violations[0].duration, 1000000);
+  EXPECT_EQ(1000000, violations[0].budget);
+  EXPECT_NE(timer.toString().find( "\nBudget: 1000.000us, exceeded by 2 run(s)" ), std::string::npos);
+
+  // Without a callback, the violations are queued
+  BudgetViolation violation{};
+  while ( BudgetViolationQueue::instance().pop( violation )) { }
+  ShardedTimer sharded_timer( "ShardedBudget" );
+  sharded_timer.setLatencyBudget( 1000 );
+  std::thread thread( [ &sharded_timer ]()
+  {
+    TimeBlock block( sharded_timer.localShard());
+    std::this_thread::sleep_for( std::chrono::microseconds( 100 ));
+  } );
+  thread.join();
+  EXPECT_EQ(1U, sharded_timer.budgetViolations());
+  ASSERT_TRUE(BudgetViolationQueue::instance().pop( violation ));
+  EXPECT_EQ("ShardedBudget", NameRegistry::instance().name( violation.name ));
+  EXPECT_FALSE(BudgetViolationQueue::instance().pop( violation ));
+
+  BudgetViolationQueue queue( 4 );
+  for ( int i = 0; i < 5; ++i ) queue.push( BudgetViolation{ 0, i, 0, 0, 0 } );
+  EXPECT_EQ(1U, queue.dropped());
+  for ( int i = 0; i < 4; ++i )
+  {
+    ASSERT_TRUE(queue.pop( violation ));
+    EXPECT_EQ(i, violation.duration);
+  }
+  EXPECT_FALSE(queue.pop( violation ));
+}
+
+TEST(Timer, RollingWindow)
+{
+  RollingWindow runs = RollingWindow::lastRuns( 10, 5 );
+  for ( long i = 1; i <= 100; ++i ) runs.add( i, 0 );
+  RunStatistics stats = runs.statistics( 0 );
+  EXPECT_EQ(10U, stats.count);
+  EXPECT_EQ(91, stats.min);
+  EXPECT_EQ(100, stats.max);
+
+  RollingWindow time( RollingWindow::Time, 1000, 10 );
+  time.add( 1, 0 );
+  time.add( 2, 950 );
+  EXPECT_EQ(2U, time.statistics( 990 ).count);
+  EXPECT_EQ(1U, time.statistics( 1050 ).count);
+  EXPECT_EQ(2, time.statistics( 1050 ).min);
+  EXPECT_EQ(0U, time.statistics( 2000 ).count);
+
+  Timer timer( "Window", TimerBase::Default, false );
+  timer.setRollingWindow( RollingWindow::lastRuns( 4, 4 ));
+  for ( int i = 0; i < 10; ++i )
+  {
+    timer.start();
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+    timer.stop();
+    timer.reset( true );
+  }
+  EXPECT_EQ(10U, timer.getRunStatistics().count);
+  EXPECT_EQ(4U, timer.getWindowStatistics().count);
+  EXPECT_NE(timer.toString().find( "\nWindow of the last 4 run(s): 4 run(s)\n Window" ), std::string::npos);
+}
+
+TEST(Timer, Format)
+{
+  char buffer[512];
+  TextWriter writer( buffer, sizeof( buffer ));
+  writer.writeFixed( 1.0005, 3 );
+  writer.write( ' ' );
+  writer.writeFixed( -0.0001, 3 );
+  writer.write( ' ' );
+  writer.writeInteger( -42 );
+  writer.writePadded( "ab", 7 );
+  EXPECT_STREQ(buffer, "1.000 -0.000 -42  ab   ");
+  char expected[32];
+  for ( double value : { 0.0625, 2.5, 123456.789, 1E20, 7E-4 } )
+  {
+    TextWriter value_writer( buffer, sizeof( buffer ));
+    value_writer.writeFixed( value, 3 );
+    std::snprintf( expected, sizeof( expected ), "%.3f", value );
+    EXPECT_STREQ(buffer, expected);
+  }
+
+  Timer timer( "Format", Timer::Default, false );
+  for ( int i = 0; i < 5; ++i )
+  {
+    timer.start();
+    std::this_thread::sleep_for( std::chrono::microseconds( 10 ));
+    timer.stop();
+    timer.reset( true );
+  }
+  std::string report = timer.toString();
+  EXPECT_EQ(timer.format( buffer, sizeof( buffer )), report.size());
+  EXPECT_EQ(std::string( buffer ), report);
+  // Truncated reports are null terminated and return the full length
+  char small[16];
+  EXPECT_EQ(timer.format( small, sizeof( small )), report.size());
+  EXPECT_EQ(std::string( small ), report.substr( 0, sizeof( small ) - 1 ));
+}
+
+TEST(Timer, FormatLayout)
+{
+  // Golden output of the table layout before the reports were written without allocations
+  const std::vector<long> run_times = { 1200, 3400, 2500, -1, 98765, 4321 };
+  const std::vector<long> cpu_run_times = { 1100, 3000, 2400, -1, 50000, 4000 };
+  const std::string header =
+    "[Timer: Golden] 6 run(s) took: \n"
+    "  Type             Mean (+/- stddev)               Median       P90         P99        P99.9        Longest  "
+    "       Shortest          Sum       \n"
+    "  Real            22.037us +- 42.908us             3400ns     98.765us    98.765us    98.765us      98.765us   "
+    "      1200ns        110.186us    \n"
+    "Warning: Only 5 of 6 had valid times!";
+  EXPECT_EQ(header + "\n"
+                     " Thread           12.100us +- 21.213us             3000ns     50.000us    50.000us    50.000us      "
+                     "50.000us         1100ns         60.500us    \n"
+                     "Warning: Only 5 of 6 had valid times!",
+            TimerBase::formatRuns( "Golden", run_times, cpu_run_times ));
+  EXPECT_EQ(header, TimerBase::formatRuns( "Golden", run_times, {} ));
+  EXPECT_EQ("[Timer: Golden] 3 run(s) took: \n"
+            "  Type             Mean (+/- stddev)               Median       P90         P99        P99.9        "
+            "Longest         Shortest          Sum       \n"
+            "  Real          5333.333us +- 5795.113us         2500.000us 12000.000us 12000.000us 12000.000us   "
+            "12000.000us      1500.000us     16000.000us   ",
+            TimerBase::formatRuns( "Golden", { 1500000, 2500000, 12000000 }, {}, TimerBase::Microseconds ));
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest(&argc, argv);